@@ -32,6 +32,7 @@
  * probably with a verbosity level variable in each
  * class instance */
 #include <iostream>	/* std::cerr debugging */
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <stdlib.h>
@@ -237,18 +238,38 @@ public:
 	std::string read();
 	void write(const std::string& str);
 
+	/**
+	 * Read one line without copying it: the returned pointer refers
+	 * to the receive buffer, with the newline replaced by a NUL, and
+	 * is only valid until the next read from this socket.
+	 * \param len If not null, receives the line length.
+	 */
+	char* readLine(size_t* len = nullptr);
 
 private:
+	/* Initial receive buffer size, and the minimal free space we
+	 * ask the kernel to fill - LIST replies run into many KB */
+	static const size_t BUFFER_SIZE = 16384;
+	static const size_t READ_SIZE_MIN = 4096;
+
 	SOCKET _sock;
 	bool _debugConnect;
 	struct timeval	_tv;
-	std::string _buffer; /* Received buffer, string because data should be text only. */
+	/* Received data, consumed from _bufStart, valid up to _bufEnd.
+	 * Complete lines are handed out in place, and the remaining tail
+	 * is moved to the front only when more room is needed to read. */
+	std::vector<char> _buffer;
+	size_t _bufStart;
+	size_t _bufEnd;
 };
 
 Socket::Socket():
 _sock(INVALID_SOCKET),
 _debugConnect(false),
-_tv()
+_tv(),
+_buffer(BUFFER_SIZE),
+_bufStart(0),
+_bufEnd(0)
 {
 	_tv.tv_sec = -1;
 	_tv.tv_usec = 0;
@@ -570,7 +591,7 @@ void Socket::disconnect()
 		::closesocket(_sock);
 		_sock = INVALID_SOCKET;
 	}
-	_buffer.clear();
+	_bufStart = _bufEnd = 0;
 }
 
 bool Socket::isConnected()const
@@ -632,37 +653,68 @@ size_t Socket::write(const void* buf, size_t sz)
 	return static_cast<size_t>(res);
 }
 
-std::string Socket::read()
+char* Socket::readLine(size_t* len)
 {
-	std::string res;
-	char buff[256];
+	/* Where to continue looking for a newline, so that a line
+	 * arriving in many small reads is only scanned once */
+	size_t scanned = _bufStart;
 
 	while(true)
 	{
 		// Look at already read data in _buffer
-		if(!_buffer.empty())
+		char* start = _buffer.data() + _bufStart;
+		char* nl = static_cast<char*>(memchr(_buffer.data() + scanned, '\n', _bufEnd - scanned));
+		if(nl)
+		{
+			*nl = '\0';
+			if(len)
+			{
+				*len = static_cast<size_t>(nl - start);
+			}
+			_bufStart = static_cast<size_t>(nl - _buffer.data()) + 1;
+			if(_bufStart == _bufEnd)
+			{
+				_bufStart = _bufEnd = 0;
+			}
+			return start;
+		}
+		scanned = _bufEnd;
+
+		// Make room for new data: reclaim the consumed head first,
+		// and grow only if a single line does not fit
+		if(_buffer.size() - _bufEnd < READ_SIZE_MIN)
 		{
-			size_t idx = _buffer.find('\n');
-			if(idx!=std::string::npos)
+			if(_bufStart > 0)
+			{
+				memmove(_buffer.data(), _buffer.data() + _bufStart, _bufEnd - _bufStart);
+				_bufEnd -= _bufStart;
+				scanned -= _bufStart;
+				_bufStart = 0;
+			}
+			if(_buffer.size() - _bufEnd < READ_SIZE_MIN)
 			{
-				res += _buffer.substr(0, idx);
-				_buffer.erase(0, idx+1);
-				return res;
+				_buffer.resize(_buffer.size() * 2);
 			}
-			res += _buffer;
 		}
 
-		// Read new buffer
-		size_t sz = read(&buff, 256);
+		// Read new data
+		size_t sz = read(_buffer.data() + _bufEnd, _buffer.size() - _bufEnd);
 		if(sz==0)
 		{
 			disconnect();
 			throw nut::IOException("Server closed connection unexpectedly");
 		}
-		_buffer.assign(buff, sz);
+		_bufEnd += sz;
 	}
 }
 
+std::string Socket::read()
+{
+	size_t len;
+	char* line = readLine(&len);
+	return std::string(line, len);
+}
+
 void Socket::write(const std::string& str)
 {
 //	write(str.c_str(), str.size());
@@ -948,21 +1000,21 @@ std::vector<std::string> TcpClient::getDeviceVariableValue(const std::string& de
 
 std::map<std::string,std::vector<std::string> > TcpClient::getDeviceVariableValues(const std::string& dev)
 {
-
 	std::map<std::string,std::vector<std::string> >  map;
 
-	std::vector<std::vector<std::string> > res = list("VAR", dev);
-	for(size_t n=0; n<res.size(); ++n)
-	{
-		std::vector<std::string>& vals = res[n];
-		std::string var = vals[0];
-		vals.erase(vals.begin());
-		map[var] = vals;
-	}
+	fillDeviceVariableValues(dev, map);
 
 	return map;
 }
 
+size_t TcpClient::fillDeviceVariableValues(const std::string& dev, std::map<std::string,std::vector<std::string> >& values)
+{
+	std::vector<std::string> query;
+	query.push_back("LIST VAR " + dev);
+	sendAsyncQueries(query);
+	return parseVariableValues("VAR " + dev, values);
+}
+
 std::map<std::string,std::map<std::string,std::vector<std::string> > > TcpClient::getDevicesVariableValues(const std::set<std::string>& devs)
 {
 	std::map<std::string,std::map<std::string,std::vector<std::string> > > map;
@@ -987,15 +1039,8 @@ std::map<std::string,std::map<std::string,std::vector<std::string> > > TcpClient
 		try
 		{
 			std::map<std::string,std::vector<std::string> > map2;
-			std::vector<std::vector<std::string> > res = parseList("VAR " + *it);
-			for (std::vector<std::vector<std::string> >::iterator it2=res.begin(); it2!=res.end(); ++it2)
-			{
-				std::vector<std::string>& vals = *it2;
-				std::string var = vals[0];
-				vals.erase(vals.begin());
-				map2[var] = vals;
-			}
-			map[*it] = map2;
+			parseVariableValues("VAR " + *it, map2);
+			map[*it].swap(map2);
 		}
 		catch (NutException&)
 		{
@@ -1224,25 +1269,42 @@ std::vector<std::vector<std::string> > TcpClient::list
 std::vector<std::vector<std::string> > TcpClient::parseList
 	(const std::string& req)
 {
-	std::string res = _socket->read();
-	detectError(res);
-	if(res != ("BEGIN LIST " + req))
+	std::vector<std::vector<std::string> > arr;
+
+	parseListRows(req, [&arr](const std::vector<const char*>& tokens)
+	{
+		arr.push_back(std::vector<std::string>(tokens.begin(), tokens.end()));
+	});
+
+	return arr;
+}
+
+void TcpClient::parseListRows
+	(const std::string& req, const std::function<void(const std::vector<const char*>&)>& row)
+{
+	const std::string begin = "BEGIN LIST " + req, end = "END LIST " + req;
+	std::vector<const char*> tokens;
+	size_t len;
+
+	char* line = _socket->readLine(&len);
+	detectError(line, len);
+	if(len != begin.size() || memcmp(line, begin.data(), len) != 0)
 	{
 		throw NutException("Invalid response");
 	}
 
-	std::vector<std::vector<std::string> > arr;
 	while(true)
 	{
-		res = _socket->read();
-		detectError(res);
-		if(res == ("END LIST " + req))
+		line = _socket->readLine(&len);
+		detectError(line, len);
+		if(len == end.size() && memcmp(line, end.data(), len) == 0)
 		{
-			return arr;
+			return;
 		}
-		if(res.substr(0, req.size()) == req)
+		if(len >= req.size() && memcmp(line, req.data(), req.size()) == 0)
 		{
-			arr.push_back(explode(res, req.size()));
+			explodeInPlace(line, len, req.size(), tokens);
+			row(tokens);
 		}
 		else
 		{
@@ -1251,6 +1313,71 @@ std::vector<std::vector<std::string> > TcpClient::parseList
 	}
 }
 
+size_t TcpClient::parseVariableValues
+	(const std::string& req, std::map<std::string,std::vector<std::string> >& values)
+{
+	typedef std::map<std::string,std::vector<std::string> >::iterator iterator;
+
+	/* Steady-state polling only assigns into strings which already
+	 * have the capacity, so allocations are per call, not per row */
+	std::vector<iterator> seen;
+	std::string key;
+
+	seen.reserve(values.size());
+
+	parseListRows(req, [&](const std::vector<const char*>& tokens)
+	{
+		if(tokens.empty())
+		{
+			return;
+		}
+
+		key.assign(tokens[0]);
+		iterator it = values.find(key);
+		if(it == values.end())
+		{
+			it = values.insert(std::make_pair(key, std::vector<std::string>())).first;
+		}
+
+		std::vector<std::string>& vals = it->second;
+		vals.resize(tokens.size() - 1);
+		for(size_t n = 1; n < tokens.size(); ++n)
+		{
+			vals[n - 1].assign(tokens[n]);
+		}
+
+		seen.push_back(it);
+	});
+
+	// Forget variables which the device no longer reports
+	if(seen.size() != values.size())
+	{
+		std::sort(seen.begin(), seen.end(), [&values](const iterator& a, const iterator& b)
+		{
+			return values.key_comp()(a->first, b->first);
+		});
+
+		std::vector<iterator>::const_iterator s = seen.begin();
+		for(iterator it = values.begin(); it != values.end(); )
+		{
+			if(s != seen.end() && *s == it)
+			{
+				while(s != seen.end() && *s == it)
+				{
+					++s;
+				}
+				++it;
+			}
+			else
+			{
+				it = values.erase(it);
+			}
+		}
+	}
+
+	return values.size();
+}
+
 std::string TcpClient::sendQuery(const std::string& req)
 {
 	_socket->write(req);
@@ -1267,16 +1394,36 @@ void TcpClient::sendAsyncQueries(const std::vector<std::string>& req)
 
 void TcpClient::detectError(const std::string& req)
 {
-	if(req.substr(0,3)=="ERR")
+	detectError(req.c_str(), req.size());
+}
+
+void TcpClient::detectError(const char* line, size_t len)
+{
+	if(len >= 3 && memcmp(line, "ERR", 3) == 0)
 	{
-		throw NutException(req.substr(4));
+		throw NutException(len > 4 ? std::string(line + 4, len - 4) : std::string());
 	}
 }
 
 std::vector<std::string> TcpClient::explode(const std::string& str, size_t begin)
 {
-	std::vector<std::string> res;
-	std::string temp;
+	std::vector<char> buf(str.begin(), str.end());
+	std::vector<const char*> tokens;
+
+	buf.push_back('\0');
+	explodeInPlace(buf.data(), str.size(), begin, tokens);
+
+	return std::vector<std::string>(tokens.begin(), tokens.end());
+}
+
+size_t TcpClient::explodeInPlace(char* str, size_t len, size_t begin, std::vector<const char*>& tokens)
+{
+	/* Unescaped words are never longer than their source text, so they
+	 * are written back over it: "out" never overtakes the read position */
+	char* out = str + begin;
+	char* token = out;
+
+	tokens.clear();
 
 	enum STATE {
 		INIT,
@@ -1286,12 +1433,13 @@ std::vector<std::string> TcpClient::explode(const std::string& str, size_t begin
 		QUOTED_ESCAPE
 	} state = INIT;
 
-	for(size_t idx=begin; idx<str.size(); ++idx)
+	for(size_t idx=begin; idx<len; ++idx)
 	{
 		char c = str[idx];
 		switch(state)
 		{
 		case INIT:
+			token = out;
 			if(c==' ' /* || c=='\t' */)
 			{ /* Do nothing */ }
 			else if(c=='"')
@@ -1305,16 +1453,15 @@ std::vector<std::string> TcpClient::explode(const std::string& str, size_t begin
 			/* What about bad characters ? */
 			else
 			{
-				temp += c;
+				*out++ = c;
 				state = SIMPLE_STRING;
 			}
 			break;
 		case SIMPLE_STRING:
 			if(c==' ' /* || c=='\t' */)
 			{
-				/* if(!temp.empty()) : Must not occur */
-					res.push_back(temp);
-				temp.clear();
+				*out++ = '\0';
+				tokens.push_back(token);
 				state = INIT;
 			}
 			else if(c=='\\')
@@ -1323,15 +1470,15 @@ std::vector<std::string> TcpClient::explode(const std::string& str, size_t begin
 			}
 			else if(c=='"')
 			{
-				/* if(!temp.empty()) : Must not occur */
-					res.push_back(temp);
-				temp.clear();
+				*out++ = '\0';
+				tokens.push_back(token);
+				token = out;
 				state = QUOTED_STRING;
 			}
 			/* What about bad characters ? */
 			else
 			{
-				temp += c;
+				*out++ = c;
 			}
 			break;
 		case QUOTED_STRING:
@@ -1341,35 +1488,39 @@ std::vector<std::string> TcpClient::explode(const std::string& str, size_t begin
 			}
 			else if(c=='"')
 			{
-				res.push_back(temp);
-				temp.clear();
+				*out++ = '\0';
+				tokens.push_back(token);
 				state = INIT;
 			}
 			/* What about bad characters ? */
 			else
 			{
-				temp += c;
+				*out++ = c;
 			}
 			break;
 		case SIMPLE_ESCAPE:
 			if(c=='\\' || c=='"' || c==' ' /* || c=='\t'*/)
 			{
-				temp += c;
+				*out++ = c;
 			}
 			else
 			{
-				temp += '\\' + c; // Really do this ?
+				/* Not an escape sequence, keep it verbatim */
+				*out++ = '\\';
+				*out++ = c;
 			}
 			state = SIMPLE_STRING;
 			break;
 		case QUOTED_ESCAPE:
 			if(c=='\\' || c=='"')
 			{
-				temp += c;
+				*out++ = c;
 			}
 			else
 			{
-				temp += '\\' + c; // Really do this ?
+				/* Not an escape sequence, keep it verbatim */
+				*out++ = '\\';
+				*out++ = c;
 			}
 			state = QUOTED_STRING;
 			break;
@@ -1401,12 +1552,13 @@ std::vector<std::string> TcpClient::explode(const std::string& str, size_t begin
 		}
 	}
 
-	if(!temp.empty())
+	if(state != INIT && out != token)
 	{
-		res.push_back(temp);
+		*out = '\0';
+		tokens.push_back(token);
 	}
 
-	return res;
+	return tokens.size();
 }
 
 std::string TcpClient::escape(const std::string& str)
@@ -28,6 +28,8 @@
 #include <map>
 #include <set>
 #include <exception>
+#include <functional>
+#include <chrono>
 #include <cstdint>
 #include <ctime>
 
@@ -42,11 +44,14 @@ namespace nut
 namespace internal
 {
 class Socket;
+class AsyncLoop;
 } /* namespace internal */
 
 
 class Client;
 class TcpClient;
+class CachingClient;
+class AsyncClient;
 class Device;
 class Variable;
 class Command;
@@ -376,6 +381,8 @@ class TcpClient : public Client
 	 * generally, but still want covered with integration tests
 	 */
 	friend class NutActiveClientTest;
+	friend class NutClientTest;
+	friend class internal::AsyncLoop;
 
 public:
 	/**
@@ -481,10 +488,22 @@ public:
 	virtual bool isFeatureEnabled(const Feature& feature) override;
 	virtual void setFeature(const Feature& feature, bool status) override;
 
+	/**
+	 * Retrieve values of all variables of a device into a caller-provided
+	 * map, e.g. one kept across polls: entries of known variables are
+	 * updated in place (reusing their storage), new ones are added and
+	 * those the device no longer reports are removed.
+	 * \param dev Device name
+	 * \param values Variable values indexed by variable names.
+	 * \return Number of variables.
+	 */
+	size_t fillDeviceVariableValues(const std::string& dev, std::map<std::string,std::vector<std::string> >& values);
+
 protected:
 	std::string sendQuery(const std::string& req);
 	void sendAsyncQueries(const std::vector<std::string>& req);
 	static void detectError(const std::string& req);
+	static void detectError(const char* line, size_t len);
 	TrackingID sendTrackingQuery(const std::string& req);
 
 	std::vector<std::string> get(const std::string& subcmd, const std::string& params = "");
@@ -493,7 +512,25 @@ protected:
 
 	std::vector<std::vector<std::string> > parseList(const std::string& req);
 
+	/**
+	 * Read the reply to "LIST <req>", passing each row to the callback
+	 * as tokens which point into the receive buffer (valid during the
+	 * call only), so nothing is copied unless the callback wants it.
+	 */
+	void parseListRows(const std::string& req, const std::function<void(const std::vector<const char*>&)>& row);
+
+	/** Read the reply to "LIST VAR <dev>" into a map, see fillDeviceVariableValues() */
+	size_t parseVariableValues(const std::string& req, std::map<std::string,std::vector<std::string> >& values);
+
 	static std::vector<std::string> explode(const std::string& str, size_t begin=0);
+
+	/**
+	 * Split a protocol line into (unquoted, unescaped) words in place:
+	 * the results are NUL-terminated strings within "str", which must
+	 * have room for a NUL at str[len].
+	 * \return Number of words (same as tokens.size()).
+	 */
+	static size_t explodeInPlace(char* str, size_t len, size_t begin, std::vector<const char*>& tokens);
 	static std::string escape(const std::string& str);
 
 private:
@@ -503,6 +540,112 @@ private:
 	internal::Socket* _socket;
 };
 
+/**
+ * Caching decorator for any nut::Client.
+ *
+ * Variable reads are served from a per-device snapshot, which is fetched
+ * as a whole with one LIST VAR when it is older than the TTL. Device
+ * names are cached the same way. Everything else goes to the wrapped
+ * client directly. Setting a variable or running a command drops the
+ * snapshot of that device, and so does invalidate(). Callers that learn
+ * about changes elsewhere (e.g. upsmon NOTIFYCMD) can call invalidate()
+ * too.
+ *
+ * The wrapped client is not owned and must outlive the cache.
+ */
+class CachingClient : public Client
+{
+public:
+	/**
+	 * Cache effectiveness counters.
+	 */
+	struct Stats
+	{
+		uint64_t hits;		/**< Reads served from a snapshot */
+		uint64_t misses;	/**< Reads that needed the server */
+		uint64_t refreshes;	/**< Snapshots (re)loaded */
+		uint64_t invalidations;	/**< Snapshots dropped before expiry */
+	};
+
+	/**
+	 * \param client Client to forward requests to.
+	 * \param ttl Snapshot lifetime in seconds; 0 disables caching.
+	 */
+	CachingClient(Client* client, double ttl = 1.0);
+	~CachingClient() override;
+
+	CachingClient(const CachingClient&) = delete;
+	CachingClient& operator=(const CachingClient&) = delete;
+
+	void setTTL(double seconds);
+	double getTTL()const;
+
+	/**
+	 * Drop the snapshot of a device, so the next read reloads it.
+	 */
+	void invalidate(const std::string& dev);
+	/**
+	 * Drop all snapshots, including the device name list.
+	 */
+	void invalidate();
+
+	Stats getStats()const;
+	void resetStats();
+
+	virtual void authenticate(const std::string& user, const std::string& passwd) override;
+	virtual void logout() override;
+
+	virtual std::set<std::string> getDeviceNames() override;
+	virtual std::string getDeviceDescription(const std::string& name) override;
+
+	virtual std::set<std::string> getDeviceVariableNames(const std::string& dev) override;
+	virtual std::set<std::string> getDeviceRWVariableNames(const std::string& dev) override;
+	virtual bool hasDeviceVariable(const std::string& dev, const std::string& name) override;
+	virtual std::string getDeviceVariableDescription(const std::string& dev, const std::string& name) override;
+	virtual std::vector<std::string> getDeviceVariableValue(const std::string& dev, const std::string& name) override;
+	virtual std::map<std::string,std::vector<std::string> > getDeviceVariableValues(const std::string& dev) override;
+	virtual std::map<std::string,std::map<std::string,std::vector<std::string> > > getDevicesVariableValues(const std::set<std::string>& devs) override;
+	virtual TrackingID setDeviceVariable(const std::string& dev, const std::string& name, const std::string& value) override;
+	virtual TrackingID setDeviceVariable(const std::string& dev, const std::string& name, const std::vector<std::string>& values) override;
+
+	virtual std::set<std::string> getDeviceCommandNames(const std::string& dev) override;
+	virtual std::string getDeviceCommandDescription(const std::string& dev, const std::string& name) override;
+	virtual TrackingID executeDeviceCommand(const std::string& dev, const std::string& name, const std::string& param="") override;
+
+	virtual void deviceLogin(const std::string& dev) override;
+	virtual int deviceGetNumLogins(const std::string& dev) override;
+	virtual std::set<std::string> deviceGetClients(const std::string& dev) override;
+	virtual void deviceMaster(const std::string& dev) override;
+	virtual void devicePrimary(const std::string& dev) override;
+	virtual void deviceForcedShutdown(const std::string& dev) override;
+	virtual std::map<std::string, std::set<std::string>> listDeviceClients(void) override;
+
+	virtual TrackingResult getTrackingResult(const TrackingID& id) override;
+
+	virtual bool isFeatureEnabled(const Feature& feature) override;
+	virtual void setFeature(const Feature& feature, bool status) override;
+
+private:
+	struct Snapshot
+	{
+		std::chrono::steady_clock::time_point loaded;
+		std::map<std::string,std::vector<std::string> > values;
+	};
+
+	/** Return the fresh snapshot of a device, reloading it if needed */
+	Snapshot& snapshot(const std::string& dev);
+	bool fresh(const std::chrono::steady_clock::time_point& loaded)const;
+
+	Client* _client;
+	TcpClient* _tcpClient;	/* _client, if it can refresh in place */
+	std::chrono::steady_clock::duration _ttl;
+	std::map<std::string, Snapshot> _snapshots;
+	std::set<std::string> _deviceNames;
+	std::chrono::steady_clock::time_point _deviceNamesLoaded;
+	bool _haveDeviceNames;
+	Stats _stats;
+};
+
 /**
  * Device attached to a client.
  * Device is a lightweight class which can be copied easily.
@@ -823,6 +966,135 @@ private:
 	std::string _name;
 };
 
+/**
+ * Outcome of an AsyncClient request.
+ */
+enum class AsyncStatus
+{
+	OK,		/**< The value is valid */
+	SERVER_ERROR,	/**< The server replied with an error, see "error" */
+	TIMEOUT,	/**< No complete reply before the request deadline */
+	IO_ERROR,	/**< The connection failed or was lost, see "error" */
+	LOGIN_FAILED,	/**< The server refused USERNAME, PASSWORD or SET TRACKING
+			     on (re)connection, see "error" */
+	CANCELLED	/**< The host was removed or the client destroyed */
+};
+
+/**
+ * Result of an AsyncClient request, as passed to its callback.
+ */
+template<typename T>
+struct AsyncResult
+{
+	AsyncResult(AsyncStatus st, const std::string& err):status(st), error(err), value() {}
+
+	bool ok()const{return status == AsyncStatus::OK;}
+
+	AsyncStatus status;
+	std::string error;	/**< Server error code, or problem description */
+	T value;		/**< Valid only when ok() */
+};
+
+/**
+ * Event-driven client for polling many NUTD servers from a single thread.
+ *
+ * Requests are queued per host and pipelined over one connection each;
+ * their callbacks are invoked from poll() (or run()) once the reply is
+ * complete, the request deadline passes or the connection is lost.
+ * Connections are opened on demand, and re-opened with an increasing
+ * back-off after failures; requests not sent yet survive a reconnection.
+ * Results use the same types as the blocking Client methods.
+ *
+ * Callbacks may queue new requests, but should not throw.
+ */
+class AsyncClient
+{
+public:
+	typedef size_t HostID;
+
+	template<typename T>
+	using Callback = std::function<void(const AsyncResult<T>&)>;
+
+	AsyncClient();
+	~AsyncClient();
+
+	AsyncClient(const AsyncClient&) = delete;
+	AsyncClient& operator=(const AsyncClient&) = delete;
+
+	/**
+	 * Register a server; it is connected to when there is a request for it.
+	 * \return Host identifier for the request methods.
+	 */
+	HostID addHost(const std::string& host, uint16_t port = 3493);
+	/**
+	 * Log in with USERNAME/PASSWORD on every (re)connection to the host.
+	 * If the server refuses them, the requests queued for the host
+	 * complete as LOGIN_FAILED and the connection is closed.
+	 */
+	void setHostCredentials(HostID id, const std::string& user, const std::string& passwd);
+	/**
+	 * Ask for TRACKING IDs of SET VAR and INSTCMD on every (re)connection.
+	 */
+	void setHostTracking(HostID id, bool enable);
+	/**
+	 * Disconnect and forget a host; its requests complete as CANCELLED.
+	 */
+	void removeHost(HostID id);
+	/**
+	 * Test if a connection to the host is established.
+	 */
+	bool isConnected(HostID id)const;
+
+	/**
+	 * Set the default request deadline, in seconds since submission.
+	 */
+	void setTimeout(double seconds);
+	double getTimeout()const;
+	/**
+	 * Set the delay before reconnecting after a failure, in seconds:
+	 * it starts at "min" and doubles with each failure, up to "max".
+	 */
+	void setReconnectDelay(double min, double max);
+
+	/**
+	 * Request methods: the optional timeout (in seconds) overrides the
+	 * default deadline for this request.
+	 * \{
+	 */
+	void getDeviceNames(HostID id, const Callback<std::set<std::string> >& cb, double timeout = -1);
+	void getDeviceVariableValue(HostID id, const std::string& dev, const std::string& name,
+		const Callback<std::vector<std::string> >& cb, double timeout = -1);
+	void getDeviceVariableValues(HostID id, const std::string& dev,
+		const Callback<std::map<std::string,std::vector<std::string> > >& cb, double timeout = -1);
+	void getDeviceCommandNames(HostID id, const std::string& dev,
+		const Callback<std::set<std::string> >& cb, double timeout = -1);
+	void setDeviceVariable(HostID id, const std::string& dev, const std::string& name, const std::string& value,
+		const Callback<TrackingID>& cb, double timeout = -1);
+	void executeDeviceCommand(HostID id, const std::string& dev, const std::string& name, const std::string& param,
+		const Callback<TrackingID>& cb, double timeout = -1);
+	void getTrackingResult(HostID id, const TrackingID& tid,
+		const Callback<TrackingResult>& cb, double timeout = -1);
+	/** \} */
+
+	/**
+	 * Process network I/O, deadlines and reconnections, waiting at most
+	 * "timeout_ms" milliseconds (negative: until something completes).
+	 * \return Number of requests completed (callbacks invoked).
+	 */
+	size_t poll(int timeout_ms);
+	/**
+	 * Call poll() until no requests are pending.
+	 */
+	void run();
+	/**
+	 * Number of requests not completed yet.
+	 */
+	size_t pending()const;
+
+private:
+	internal::AsyncLoop* _loop;
+};
+
 } /* namespace nut */
 
 #endif /* __cplusplus */
@@ -0,0 +1,988 @@
+/* nutclientasync.cpp - event-driven nutclient for many servers
+
+   Copyright (C)
+	2026	Network UPS Tools developers
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "config.h"
+#include "nutclient.h"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+
+#include <errno.h>
+#include <string.h>
+
+#ifndef WIN32
+# include <sys/types.h>
+# include <sys/socket.h>
+# include <netinet/in.h>
+# include <unistd.h>
+# include <netdb.h>
+# include <fcntl.h>
+# include <poll.h>
+#endif	/* !WIN32 */
+
+namespace nut
+{
+
+namespace internal
+{
+
+typedef std::chrono::steady_clock Clock;
+
+/* Generic completion: single-line replies come in "reply", rows of
+ * LIST replies (split into words after the echoed request) in "rows" */
+typedef std::function<void(AsyncStatus, const std::string& error,
+	const std::string& reply, std::vector<std::vector<std::string> >& rows)> AsyncDone;
+
+struct AsyncRequest
+{
+	std::string line;	/* command, without the newline */
+	std::string listReq;	/* LIST commands: the part echoed in the reply */
+	bool internal;		/* login etc.; not counted as pending */
+	bool sent;
+	bool begun;		/* BEGIN LIST seen */
+	Clock::time_point deadline;
+	std::vector<std::vector<std::string> > rows;
+	AsyncDone done;
+};
+
+struct AsyncCompletion
+{
+	AsyncRequest req;
+	AsyncStatus status;
+	std::string error;
+	std::string reply;
+};
+
+struct AsyncHost
+{
+	enum State
+	{
+		IDLE,
+		CONNECTING,
+		CONNECTED
+	};
+
+	std::string host;
+	uint16_t port;
+	std::string user, passwd;
+	bool tracking;
+
+	int sock;
+	State state;
+	std::deque<AsyncRequest> queue;	/* sent requests first, in order */
+	std::string out;		/* data not written to the socket yet */
+	size_t outPos;
+	std::vector<char> in;		/* received data, see Socket::readLine() */
+	size_t inStart, inEnd;
+
+	Clock::time_point retryAt;
+	double backoff;
+	std::string lastError;
+
+	AsyncHost():
+		port(0), tracking(false), sock(-1), state(IDLE), outPos(0),
+		in(16384), inStart(0), inEnd(0), retryAt(), backoff(0)
+	{}
+};
+
+/**
+ * The event loop behind AsyncClient, kept out of the public header.
+ */
+class AsyncLoop
+{
+public:
+	AsyncLoop();
+	~AsyncLoop();
+
+	AsyncHost& getHost(AsyncClient::HostID id);
+	const AsyncHost& getHost(AsyncClient::HostID id)const;
+
+	void submit(AsyncClient::HostID id, const std::string& line, const std::string& listReq,
+		double timeout, const AsyncDone& done);
+	void complete(AsyncRequest& req, AsyncStatus status, const std::string& error, const std::string& reply = "");
+	size_t poll(int timeout_ms);
+	void removeHost(AsyncClient::HostID id);
+
+	static std::vector<std::string> explode(const std::string& str, size_t begin);
+	static std::string escape(const std::string& str) {return TcpClient::escape(str);}
+
+	std::map<AsyncClient::HostID, std::unique_ptr<AsyncHost> > hosts;
+	AsyncClient::HostID nextId;
+	double timeout;
+	double reconnectMin, reconnectMax;
+	size_t pending;
+
+private:
+	std::vector<AsyncCompletion> _completions;
+
+	Clock::time_point deadline(double seconds)const;
+	void connect(AsyncHost& h);
+	void connected(AsyncHost& h);
+	void disconnect(AsyncHost& h, const std::string& error, const AsyncRequest* timedOut = nullptr);
+	void flush(AsyncHost& h);
+	void receive(AsyncHost& h);
+	bool processLine(AsyncHost& h, char* line, size_t len);
+	void expire(AsyncHost& h, Clock::time_point now);
+	size_t dispatch();
+};
+
+AsyncLoop::AsyncLoop():
+	hosts(), nextId(1), timeout(10), reconnectMin(1), reconnectMax(60), pending(0), _completions()
+{
+}
+
+AsyncLoop::~AsyncLoop()
+{
+	std::vector<AsyncClient::HostID> ids;
+	for(auto it = hosts.begin(); it != hosts.end(); ++it)
+	{
+		ids.push_back(it->first);
+	}
+	/* Let callers release whatever they tied to the requests */
+	for(size_t n = 0; n < ids.size(); ++n)
+	{
+		removeHost(ids[n]);
+	}
+	poll(0);
+}
+
+AsyncHost& AsyncLoop::getHost(AsyncClient::HostID id)
+{
+	auto it = hosts.find(id);
+	if(it == hosts.end())
+	{
+		throw NutException("Unknown host");
+	}
+	return *it->second;
+}
+
+const AsyncHost& AsyncLoop::getHost(AsyncClient::HostID id)const
+{
+	auto it = hosts.find(id);
+	if(it == hosts.end())
+	{
+		throw NutException("Unknown host");
+	}
+	return *it->second;
+}
+
+Clock::time_point AsyncLoop::deadline(double seconds)const
+{
+	if(seconds < 0)
+	{
+		seconds = timeout;
+	}
+	return Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+std::vector<std::string> AsyncLoop::explode(const std::string& str, size_t begin)
+{
+	return TcpClient::explode(str, begin);
+}
+
+void AsyncLoop::submit(AsyncClient::HostID id, const std::string& line, const std::string& listReq,
+	double to, const AsyncDone& done)
+{
+	AsyncHost& h = getHost(id);
+	AsyncRequest req;
+
+	req.line = line;
+	req.listReq = listReq;
+	req.internal = false;
+	req.sent = false;
+	req.begun = false;
+	req.deadline = deadline(to);
+	req.done = done;
+
+	h.queue.push_back(req);
+	pending++;
+
+	if(h.state == AsyncHost::CONNECTED)
+	{
+		flush(h);
+	}
+}
+
+void AsyncLoop::complete(AsyncRequest& req, AsyncStatus status, const std::string& error, const std::string& reply)
+{
+	AsyncCompletion c;
+
+	if(!req.internal)
+	{
+		pending--;
+	}
+
+	c.req.done.swap(req.done);
+	c.req.rows.swap(req.rows);
+	c.req.internal = req.internal;
+	c.status = status;
+	c.error = error;
+	c.reply = reply;
+	_completions.push_back(std::move(c));
+}
+
+void AsyncLoop::removeHost(AsyncClient::HostID id)
+{
+	AsyncHost& h = getHost(id);
+
+	for(size_t n = 0; n < h.queue.size(); ++n)
+	{
+		complete(h.queue[n], AsyncStatus::CANCELLED, "Host removed");
+	}
+	h.queue.clear();
+
+#ifndef WIN32
+	if(h.sock >= 0)
+	{
+		::close(h.sock);
+	}
+#endif	/* !WIN32 */
+	hosts.erase(id);
+}
+
+#ifndef WIN32
+
+void AsyncLoop::connect(AsyncHost& h)
+{
+	struct addrinfo hints, *res = nullptr, *ai;
+	char sport[NI_MAXSERV];
+	int rc;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	snprintf(sport, sizeof(sport), "%hu", static_cast<unsigned short int>(h.port));
+
+	/* Name resolution itself still blocks; use addresses or a local
+	 * caching resolver when polling many hosts by name */
+	rc = getaddrinfo(h.host.c_str(), sport, &hints, &res);
+	if(rc != 0)
+	{
+		disconnect(h, std::string("Unknown host: ") + gai_strerror(rc));
+		return;
+	}
+
+	for(ai = res; ai != nullptr; ai = ai->ai_next)
+	{
+		int sock = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if(sock < 0)
+		{
+			continue;
+		}
+
+		fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+		fcntl(sock, F_SETFD, FD_CLOEXEC);
+
+		if(::connect(sock, ai->ai_addr, ai->ai_addrlen) == 0)
+		{
+			h.sock = sock;
+			freeaddrinfo(res);
+			connected(h);
+			return;
+		}
+
+		if(errno == EINPROGRESS)
+		{
+			h.sock = sock;
+			h.state = AsyncHost::CONNECTING;
+			freeaddrinfo(res);
+			return;
+		}
+
+		h.lastError = std::string("Cannot connect to host: ") + strerror(errno);
+		::close(sock);
+	}
+
+	freeaddrinfo(res);
+	disconnect(h, h.lastError.empty() ? std::string("Cannot connect to host") : h.lastError);
+}
+
+void AsyncLoop::connected(AsyncHost& h)
+{
+	std::vector<std::string> login;
+
+	h.state = AsyncHost::CONNECTED;
+	h.backoff = 0;
+	h.lastError.clear();
+
+	if(!h.user.empty())
+	{
+		login.push_back("USERNAME " + h.user);
+		login.push_back("PASSWORD " + h.passwd);
+	}
+	if(h.tracking)
+	{
+		login.push_back("SET TRACKING ON");
+	}
+
+	/* In front of everything queued while disconnected */
+	for(size_t n = login.size(); n > 0; --n)
+	{
+		AsyncRequest req;
+
+		req.line = login[n - 1];
+		req.internal = true;
+		req.sent = false;
+		req.begun = false;
+		req.deadline = deadline(-1);
+		h.queue.push_front(req);
+	}
+
+	flush(h);
+}
+
+void AsyncLoop::disconnect(AsyncHost& h, const std::string& error, const AsyncRequest* timedOut)
+{
+	if(h.sock >= 0)
+	{
+		::close(h.sock);
+		h.sock = -1;
+	}
+
+	h.state = AsyncHost::IDLE;
+	h.out.clear();
+	h.outPos = 0;
+	h.inStart = h.inEnd = 0;
+	h.lastError = error;
+
+	/* Replies to requests already sent are lost; the rest can wait
+	 * for the next connection (or their deadline) */
+	while(!h.queue.empty() && h.queue.front().sent)
+	{
+		AsyncRequest& req = h.queue.front();
+		if(&req == timedOut)
+		{
+			complete(req, AsyncStatus::TIMEOUT, "Timeout");
+		}
+		else if(!req.internal)
+		{
+			complete(req, AsyncStatus::IO_ERROR, error);
+		}
+		h.queue.pop_front();
+	}
+
+	h.backoff = (h.backoff <= 0) ? reconnectMin : std::min(h.backoff * 2, reconnectMax);
+	h.retryAt = deadline(h.backoff);
+}
+
+void AsyncLoop::flush(AsyncHost& h)
+{
+	for(size_t n = 0; n < h.queue.size(); ++n)
+	{
+		AsyncRequest& req = h.queue[n];
+		if(!req.sent)
+		{
+			h.out += req.line;
+			h.out += '\n';
+			req.sent = true;
+		}
+	}
+
+	while(h.outPos < h.out.size())
+	{
+#ifdef MSG_NOSIGNAL
+		ssize_t res = ::send(h.sock, h.out.data() + h.outPos, h.out.size() - h.outPos, MSG_NOSIGNAL);
+#else
+		ssize_t res = ::send(h.sock, h.out.data() + h.outPos, h.out.size() - h.outPos, 0);
+#endif
+		if(res < 0)
+		{
+			if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			{
+				return;	/* wait for POLLOUT */
+			}
+			disconnect(h, std::string("Error while writing on socket: ") + strerror(errno));
+			return;
+		}
+		h.outPos += static_cast<size_t>(res);
+	}
+
+	h.out.clear();
+	h.outPos = 0;
+}
+
+void AsyncLoop::receive(AsyncHost& h)
+{
+	if(h.in.size() - h.inEnd < 4096)
+	{
+		if(h.inStart > 0)
+		{
+			memmove(h.in.data(), h.in.data() + h.inStart, h.inEnd - h.inStart);
+			h.inEnd -= h.inStart;
+			h.inStart = 0;
+		}
+		if(h.in.size() - h.inEnd < 4096)
+		{
+			h.in.resize(h.in.size() * 2);
+		}
+	}
+
+	ssize_t res = ::recv(h.sock, h.in.data() + h.inEnd, h.in.size() - h.inEnd, 0);
+	if(res < 0)
+	{
+		if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+		{
+			disconnect(h, std::string("Error while reading on socket: ") + strerror(errno));
+		}
+		return;
+	}
+	if(res == 0)
+	{
+		disconnect(h, "Server closed connection unexpectedly");
+		return;
+	}
+
+	size_t scan = h.inEnd;
+	h.inEnd += static_cast<size_t>(res);
+
+	char* nl;
+	while((nl = static_cast<char*>(memchr(h.in.data() + scan, '\n', h.inEnd - scan))) != nullptr)
+	{
+		char* line = h.in.data() + h.inStart;
+		*nl = '\0';
+		h.inStart = static_cast<size_t>(nl - h.in.data()) + 1;
+		scan = h.inStart;
+
+		if(!processLine(h, line, static_cast<size_t>(nl - line)))
+		{
+			return;	/* disconnected */
+		}
+	}
+
+	if(h.inStart == h.inEnd)
+	{
+		h.inStart = h.inEnd = 0;
+	}
+}
+
+bool AsyncLoop::processLine(AsyncHost& h, char* line, size_t len)
+{
+	if(h.queue.empty() || !h.queue.front().sent)
+	{
+		disconnect(h, "Unexpected data from server");
+		return false;
+	}
+
+	AsyncRequest& req = h.queue.front();
+	bool isErr = (len >= 3 && memcmp(line, "ERR", 3) == 0);
+
+	if(isErr && req.internal)
+	{
+		/* The requests behind it would run without the session set up
+		 * as asked (e.g. anonymously), so fail them all with the reason */
+		std::string error = req.line.substr(0, req.line.find(' ')) + " failed: " + std::string(line, len);
+
+		h.queue.pop_front();
+		for(size_t n = 0; n < h.queue.size(); ++n)
+		{
+			if(!h.queue[n].internal)
+			{
+				complete(h.queue[n], AsyncStatus::LOGIN_FAILED, error);
+			}
+		}
+		h.queue.clear();
+		disconnect(h, error);
+		return false;
+	}
+
+	if(req.listReq.empty())
+	{
+		if(isErr)
+		{
+			complete(req, AsyncStatus::SERVER_ERROR, len > 4 ? std::string(line + 4, len - 4) : std::string());
+		}
+		else
+		{
+			complete(req, AsyncStatus::OK, std::string(), std::string(line, len));
+		}
+		h.queue.pop_front();
+		return true;
+	}
+
+	if(isErr)
+	{
+		complete(req, AsyncStatus::SERVER_ERROR, len > 4 ? std::string(line + 4, len - 4) : std::string());
+		h.queue.pop_front();
+		return true;
+	}
+
+	const std::string& lr = req.listReq;
+	if(!req.begun)
+	{
+		if(len == 11 + lr.size() && memcmp(line, "BEGIN LIST ", 11) == 0 && memcmp(line + 11, lr.data(), lr.size()) == 0)
+		{
+			req.begun = true;
+			return true;
+		}
+	}
+	else if(len == 9 + lr.size() && memcmp(line, "END LIST ", 9) == 0 && memcmp(line + 9, lr.data(), lr.size()) == 0)
+	{
+		complete(req, AsyncStatus::OK, std::string());
+		h.queue.pop_front();
+		return true;
+	}
+	else if(len >= lr.size() && memcmp(line, lr.data(), lr.size()) == 0)
+	{
+		std::vector<const char*> tokens;
+		TcpClient::explodeInPlace(line, len, lr.size(), tokens);
+		req.rows.push_back(std::vector<std::string>(tokens.begin(), tokens.end()));
+		return true;
+	}
+
+	disconnect(h, "Invalid response");
+	return false;
+}
+
+void AsyncLoop::expire(AsyncHost& h, Clock::time_point now)
+{
+	/* A late reply to a sent request would desynchronize the stream,
+	 * so its connection has to go; not yet sent ones just drop out */
+	for(size_t n = 0; n < h.queue.size(); ++n)
+	{
+		if(h.queue[n].sent && h.queue[n].deadline <= now)
+		{
+			disconnect(h, "Connection reset after a request timeout", &h.queue[n]);
+			break;
+		}
+	}
+
+	for(auto it = h.queue.begin(); it != h.queue.end(); )
+	{
+		if(!it->sent && it->deadline <= now)
+		{
+			complete(*it, AsyncStatus::TIMEOUT, h.lastError.empty() ? std::string("Timeout") : h.lastError);
+			it = h.queue.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+size_t AsyncLoop::poll(int timeout_ms)
+{
+	Clock::time_point now = Clock::now();
+	Clock::time_point wake = Clock::time_point::max();
+	std::vector<struct pollfd> fds;
+	std::vector<AsyncHost*> fdHosts;
+
+	for(auto it = hosts.begin(); it != hosts.end(); ++it)
+	{
+		AsyncHost& h = *it->second;
+
+		expire(h, now);
+
+		if(h.state == AsyncHost::IDLE && !h.queue.empty())
+		{
+			if(h.retryAt <= now)
+			{
+				connect(h);
+			}
+			else
+			{
+				wake = std::min(wake, h.retryAt);
+			}
+		}
+
+		for(size_t n = 0; n < h.queue.size(); ++n)
+		{
+			wake = std::min(wake, h.queue[n].deadline);
+		}
+
+		if(h.sock >= 0)
+		{
+			struct pollfd pfd;
+			pfd.fd = h.sock;
+			pfd.events = POLLIN;
+			if(h.state == AsyncHost::CONNECTING || h.outPos < h.out.size())
+			{
+				pfd.events |= POLLOUT;
+			}
+			pfd.revents = 0;
+			fds.push_back(pfd);
+			fdHosts.push_back(&h);
+		}
+	}
+
+	/* Something may have completed already (e.g. failed connections) */
+	if(!_completions.empty())
+	{
+		timeout_ms = 0;
+	}
+	else if(wake != Clock::time_point::max())
+	{
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count() + 1;
+		if(ms < 0)
+		{
+			ms = 0;
+		}
+		if(timeout_ms < 0 || ms < timeout_ms)
+		{
+			timeout_ms = static_cast<int>(std::min<long long>(ms, 86400000));
+		}
+	}
+	else if(fds.empty() && timeout_ms < 0)
+	{
+		return 0;	/* nothing to wait for */
+	}
+
+	int rc = ::poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout_ms);
+	if(rc < 0 && errno != EINTR)
+	{
+		throw SystemException();
+	}
+
+	for(size_t n = 0; rc > 0 && n < fds.size(); ++n)
+	{
+		AsyncHost& h = *fdHosts[n];
+		short ev = fds[n].revents;
+
+		if(!ev || h.sock != fds[n].fd)
+		{
+			continue;
+		}
+
+		if(h.state == AsyncHost::CONNECTING)
+		{
+			int err = 0;
+			socklen_t errlen = sizeof(err);
+
+			if(getsockopt(h.sock, SOL_SOCKET, SO_ERROR, &err, &errlen) < 0)
+			{
+				err = errno;
+			}
+			if(err)
+			{
+				disconnect(h, std::string("Cannot connect to host: ") + strerror(err));
+				continue;
+			}
+			connected(h);
+			continue;
+		}
+
+		if(ev & (POLLIN | POLLHUP | POLLERR))
+		{
+			receive(h);
+		}
+		if(h.state == AsyncHost::CONNECTED && (ev & POLLOUT))
+		{
+			flush(h);
+		}
+	}
+
+	return dispatch();
+}
+
+#else	/* WIN32 */
+
+/* The event loop relies on poll() and non-blocking POSIX sockets */
+size_t AsyncLoop::poll(int)
+{
+	for(auto it = hosts.begin(); it != hosts.end(); ++it)
+	{
+		for(size_t n = 0; n < it->second->queue.size(); ++n)
+		{
+			complete(it->second->queue[n], AsyncStatus::IO_ERROR, "AsyncClient is not implemented on this platform");
+		}
+		it->second->queue.clear();
+	}
+
+	return dispatch();
+}
+
+#endif	/* WIN32 */
+
+size_t AsyncLoop::dispatch()
+{
+	/* Callbacks last: they may queue requests or remove hosts */
+	std::vector<AsyncCompletion> done;
+	done.swap(_completions);
+
+	size_t count = 0;
+	for(size_t n = 0; n < done.size(); ++n)
+	{
+		AsyncCompletion& c = done[n];
+		if(c.req.done)
+		{
+			c.req.done(c.status, c.error, c.reply, c.req.rows);
+		}
+		if(!c.req.internal)
+		{
+			count++;
+		}
+	}
+
+	return count;
+}
+
+} /* namespace internal */
+
+
+/*
+ *
+ * AsyncClient implementation
+ *
+ */
+
+AsyncClient::AsyncClient():
+_loop(new internal::AsyncLoop())
+{
+}
+
+AsyncClient::~AsyncClient()
+{
+	delete _loop;
+}
+
+AsyncClient::HostID AsyncClient::addHost(const std::string& host, uint16_t port)
+{
+	std::unique_ptr<internal::AsyncHost> h(new internal::AsyncHost());
+	h->host = host;
+	h->port = port;
+
+	HostID id = _loop->nextId++;
+	_loop->hosts[id] = std::move(h);
+	return id;
+}
+
+void AsyncClient::setHostCredentials(HostID id, const std::string& user, const std::string& passwd)
+{
+	internal::AsyncHost& h = _loop->getHost(id);
+	h.user = user;
+	h.passwd = passwd;
+}
+
+void AsyncClient::setHostTracking(HostID id, bool enable)
+{
+	_loop->getHost(id).tracking = enable;
+}
+
+void AsyncClient::removeHost(HostID id)
+{
+	_loop->removeHost(id);
+}
+
+bool AsyncClient::isConnected(HostID id)const
+{
+	return _loop->getHost(id).state == internal::AsyncHost::CONNECTED;
+}
+
+void AsyncClient::setTimeout(double seconds)
+{
+	_loop->timeout = seconds;
+}
+
+double AsyncClient::getTimeout()const
+{
+	return _loop->timeout;
+}
+
+void AsyncClient::setReconnectDelay(double min, double max)
+{
+	_loop->reconnectMin = min;
+	_loop->reconnectMax = (max < min) ? min : max;
+}
+
+size_t AsyncClient::poll(int timeout_ms)
+{
+	return _loop->poll(timeout_ms);
+}
+
+void AsyncClient::run()
+{
+	while(_loop->pending > 0)
+	{
+		_loop->poll(-1);
+	}
+}
+
+size_t AsyncClient::pending()const
+{
+	return _loop->pending;
+}
+
+void AsyncClient::getDeviceNames(HostID id, const Callback<std::set<std::string> >& cb, double timeout)
+{
+	_loop->submit(id, "LIST UPS", "UPS", timeout,
+		[cb](AsyncStatus st, const std::string& err, const std::string&, std::vector<std::vector<std::string> >& rows)
+	{
+		AsyncResult<std::set<std::string> > res(st, err);
+		for(size_t n = 0; res.ok() && n < rows.size(); ++n)
+		{
+			if(!rows[n].empty())
+			{
+				res.value.insert(rows[n][0]);
+			}
+		}
+		if(cb) cb(res);
+	});
+}
+
+void AsyncClient::getDeviceVariableValue(HostID id, const std::string& dev, const std::string& name,
+	const Callback<std::vector<std::string> >& cb, double timeout)
+{
+	std::string req = "VAR " + dev + " " + name;
+
+	_loop->submit(id, "GET " + req, "", timeout,
+		[cb, req](AsyncStatus st, const std::string& err, const std::string& reply, std::vector<std::vector<std::string> >&)
+	{
+		AsyncResult<std::vector<std::string> > res(st, err);
+		if(res.ok())
+		{
+			if(reply.compare(0, req.size(), req) == 0)
+			{
+				res.value = internal::AsyncLoop::explode(reply, req.size());
+			}
+			else
+			{
+				res.status = AsyncStatus::SERVER_ERROR;
+				res.error = "Invalid response";
+			}
+		}
+		if(cb) cb(res);
+	});
+}
+
+void AsyncClient::getDeviceVariableValues(HostID id, const std::string& dev,
+	const Callback<std::map<std::string,std::vector<std::string> > >& cb, double timeout)
+{
+	_loop->submit(id, "LIST VAR " + dev, "VAR " + dev, timeout,
+		[cb](AsyncStatus st, const std::string& err, const std::string&, std::vector<std::vector<std::string> >& rows)
+	{
+		AsyncResult<std::map<std::string,std::vector<std::string> > > res(st, err);
+		for(size_t n = 0; res.ok() && n < rows.size(); ++n)
+		{
+			if(!rows[n].empty())
+			{
+				res.value[rows[n][0]].assign(rows[n].begin() + 1, rows[n].end());
+			}
+		}
+		if(cb) cb(res);
+	});
+}
+
+void AsyncClient::getDeviceCommandNames(HostID id, const std::string& dev,
+	const Callback<std::set<std::string> >& cb, double timeout)
+{
+	_loop->submit(id, "LIST CMD " + dev, "CMD " + dev, timeout,
+		[cb](AsyncStatus st, const std::string& err, const std::string&, std::vector<std::vector<std::string> >& rows)
+	{
+		AsyncResult<std::set<std::string> > res(st, err);
+		for(size_t n = 0; res.ok() && n < rows.size(); ++n)
+		{
+			if(!rows[n].empty())
+			{
+				res.value.insert(rows[n][0]);
+			}
+		}
+		if(cb) cb(res);
+	});
+}
+
+/* Same reply handling as TcpClient::sendTrackingQuery() */
+static void asyncTrackingReply(const AsyncClient::Callback<TrackingID>& cb,
+	AsyncStatus st, const std::string& err, const std::string& reply)
+{
+	AsyncResult<TrackingID> res(st, err);
+	if(res.ok())
+	{
+		std::vector<std::string> words = internal::AsyncLoop::explode(reply, 0);
+		if(words.size() == 3 && words[0] == "OK" && words[1] == "TRACKING")
+		{
+			res.value = words[2];
+		}
+		else if(words.size() != 1 || words[0] != "OK")
+		{
+			res.status = AsyncStatus::SERVER_ERROR;
+			res.error = "Unknown query result";
+		}
+	}
+	if(cb) cb(res);
+}
+
+void AsyncClient::setDeviceVariable(HostID id, const std::string& dev, const std::string& name, const std::string& value,
+	const Callback<TrackingID>& cb, double timeout)
+{
+	_loop->submit(id, "SET VAR " + dev + " " + name + " " + internal::AsyncLoop::escape(value), "", timeout,
+		[cb](AsyncStatus st, const std::string& err, const std::string& reply, std::vector<std::vector<std::string> >&)
+	{
+		asyncTrackingReply(cb, st, err, reply);
+	});
+}
+
+void AsyncClient::executeDeviceCommand(HostID id, const std::string& dev, const std::string& name, const std::string& param,
+	const Callback<TrackingID>& cb, double timeout)
+{
+	std::string line = "INSTCMD " + dev + " " + name;
+	if(!param.empty())
+	{
+		line += " " + param;
+	}
+
+	_loop->submit(id, line, "", timeout,
+		[cb](AsyncStatus st, const std::string& err, const std::string& reply, std::vector<std::vector<std::string> >&)
+	{
+		asyncTrackingReply(cb, st, err, reply);
+	});
+}
+
+void AsyncClient::getTrackingResult(HostID id, const TrackingID& tid,
+	const Callback<TrackingResult>& cb, double timeout)
+{
+	/* Same mapping as TcpClient::getTrackingResult(), where most
+	 * server errors are an answer rather than a failure */
+	internal::AsyncDone done = [cb](AsyncStatus st, const std::string& err, const std::string& reply, std::vector<std::vector<std::string> >&)
+	{
+		AsyncResult<TrackingResult> res(st, err);
+		if(st == AsyncStatus::SERVER_ERROR)
+		{
+			res.status = AsyncStatus::OK;
+			res.value = (err == "UNKNOWN") ? TrackingResult::UNKNOWN
+				: (err == "INVALID-ARGUMENT") ? TrackingResult::INVALID_ARGUMENT
+				: TrackingResult::FAILURE;
+		}
+		else if(st == AsyncStatus::OK)
+		{
+			res.value = (reply == "PENDING") ? TrackingResult::PENDING
+				: (reply == "SUCCESS") ? TrackingResult::SUCCESS
+				: TrackingResult::FAILURE;
+		}
+		if(cb) cb(res);
+	};
+
+	if(tid.empty())
+	{
+		/* Nothing to ask; still answer from poll() like any request */
+		internal::AsyncRequest req;
+		req.internal = false;
+		req.done = done;
+		_loop->getHost(id);
+		_loop->pending++;
+		_loop->complete(req, AsyncStatus::OK, std::string(), "SUCCESS");
+		return;
+	}
+
+	_loop->submit(id, "GET TRACKING " + tid, "", timeout, done);
+}
+
+} /* namespace nut */
@@ -0,0 +1,382 @@
+/* nutclientcache.cpp - caching decorator for nutclient
+
+   Copyright (C)
+	2026	Network UPS Tools developers
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "config.h"
+#include "nutclient.h"
+
+namespace nut
+{
+
+/*
+ *
+ * Caching client implementation
+ *
+ */
+
+CachingClient::CachingClient(Client* client, double ttl):
+Client(),
+_client(client),
+_tcpClient(dynamic_cast<TcpClient*>(client)),
+_ttl(),
+_snapshots(),
+_deviceNames(),
+_deviceNamesLoaded(),
+_haveDeviceNames(false),
+_stats()
+{
+	if(!client)
+	{
+		throw NutException("No client to cache");
+	}
+	setTTL(ttl);
+	resetStats();
+}
+
+CachingClient::~CachingClient()
+{
+}
+
+void CachingClient::setTTL(double seconds)
+{
+	if(seconds < 0)
+	{
+		seconds = 0;
+	}
+	_ttl = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+double CachingClient::getTTL()const
+{
+	return std::chrono::duration<double>(_ttl).count();
+}
+
+bool CachingClient::fresh(const std::chrono::steady_clock::time_point& loaded)const
+{
+	return std::chrono::steady_clock::now() - loaded < _ttl;
+}
+
+void CachingClient::invalidate(const std::string& dev)
+{
+	if(_snapshots.erase(dev) > 0)
+	{
+		_stats.invalidations++;
+	}
+}
+
+void CachingClient::invalidate()
+{
+	_stats.invalidations += _snapshots.size();
+	_snapshots.clear();
+	_deviceNames.clear();
+	_haveDeviceNames = false;
+}
+
+CachingClient::Stats CachingClient::getStats()const
+{
+	return _stats;
+}
+
+void CachingClient::resetStats()
+{
+	_stats.hits = 0;
+	_stats.misses = 0;
+	_stats.refreshes = 0;
+	_stats.invalidations = 0;
+}
+
+CachingClient::Snapshot& CachingClient::snapshot(const std::string& dev)
+{
+	std::map<std::string, Snapshot>::iterator it = _snapshots.find(dev);
+
+	if(it != _snapshots.end() && fresh(it->second.loaded))
+	{
+		_stats.hits++;
+		return it->second;
+	}
+
+	_stats.misses++;
+
+	if(it == _snapshots.end())
+	{
+		it = _snapshots.insert(std::make_pair(dev, Snapshot())).first;
+	}
+
+	try
+	{
+		if(_tcpClient)
+		{
+			/* Reuses the storage of the stale snapshot */
+			_tcpClient->fillDeviceVariableValues(dev, it->second.values);
+		}
+		else
+		{
+			it->second.values = _client->getDeviceVariableValues(dev);
+		}
+	}
+	catch(...)
+	{
+		_snapshots.erase(it);
+		throw;
+	}
+
+	it->second.loaded = std::chrono::steady_clock::now();
+	_stats.refreshes++;
+	return it->second;
+}
+
+void CachingClient::authenticate(const std::string& user, const std::string& passwd)
+{
+	_client->authenticate(user, passwd);
+}
+
+void CachingClient::logout()
+{
+	_client->logout();
+	invalidate();
+}
+
+std::set<std::string> CachingClient::getDeviceNames()
+{
+	if(_haveDeviceNames && fresh(_deviceNamesLoaded))
+	{
+		_stats.hits++;
+		return _deviceNames;
+	}
+
+	_stats.misses++;
+	_deviceNames = _client->getDeviceNames();
+	_deviceNamesLoaded = std::chrono::steady_clock::now();
+	_haveDeviceNames = true;
+	return _deviceNames;
+}
+
+std::string CachingClient::getDeviceDescription(const std::string& name)
+{
+	return _client->getDeviceDescription(name);
+}
+
+std::set<std::string> CachingClient::getDeviceVariableNames(const std::string& dev)
+{
+	if(_ttl == std::chrono::steady_clock::duration::zero())
+	{
+		_stats.misses++;
+		return _client->getDeviceVariableNames(dev);
+	}
+
+	const Snapshot& snap = snapshot(dev);
+	std::set<std::string> res;
+	for(std::map<std::string,std::vector<std::string> >::const_iterator it = snap.values.cbegin(); it != snap.values.cend(); ++it)
+	{
+		res.insert(res.end(), it->first);
+	}
+	return res;
+}
+
+std::set<std::string> CachingClient::getDeviceRWVariableNames(const std::string& dev)
+{
+	return _client->getDeviceRWVariableNames(dev);
+}
+
+bool CachingClient::hasDeviceVariable(const std::string& dev, const std::string& name)
+{
+	if(_ttl == std::chrono::steady_clock::duration::zero())
+	{
+		_stats.misses++;
+		return _client->hasDeviceVariable(dev, name);
+	}
+
+	const Snapshot& snap = snapshot(dev);
+	return snap.values.find(name) != snap.values.end();
+}
+
+std::string CachingClient::getDeviceVariableDescription(const std::string& dev, const std::string& name)
+{
+	return _client->getDeviceVariableDescription(dev, name);
+}
+
+std::vector<std::string> CachingClient::getDeviceVariableValue(const std::string& dev, const std::string& name)
+{
+	if(_ttl == std::chrono::steady_clock::duration::zero())
+	{
+		_stats.misses++;
+		return _client->getDeviceVariableValue(dev, name);
+	}
+
+	const Snapshot& snap = snapshot(dev);
+	std::map<std::string,std::vector<std::string> >::const_iterator it = snap.values.find(name);
+	if(it != snap.values.end())
+	{
+		return it->second;
+	}
+
+	/* Not listed: let the server report why */
+	return _client->getDeviceVariableValue(dev, name);
+}
+
+std::map<std::string,std::vector<std::string> > CachingClient::getDeviceVariableValues(const std::string& dev)
+{
+	if(_ttl == std::chrono::steady_clock::duration::zero())
+	{
+		_stats.misses++;
+		return _client->getDeviceVariableValues(dev);
+	}
+
+	return snapshot(dev).values;
+}
+
+std::map<std::string,std::map<std::string,std::vector<std::string> > > CachingClient::getDevicesVariableValues(const std::set<std::string>& devs)
+{
+	std::map<std::string,std::map<std::string,std::vector<std::string> > > res;
+	std::set<std::string> stale;
+
+	if(_ttl == std::chrono::steady_clock::duration::zero())
+	{
+		_stats.misses += devs.size();
+		return _client->getDevicesVariableValues(devs);
+	}
+
+	for(std::set<std::string>::const_iterator it = devs.cbegin(); it != devs.cend(); ++it)
+	{
+		std::map<std::string, Snapshot>::const_iterator snap = _snapshots.find(*it);
+		if(snap != _snapshots.end() && fresh(snap->second.loaded))
+		{
+			_stats.hits++;
+			res[*it] = snap->second.values;
+		}
+		else
+		{
+			_stats.misses++;
+			stale.insert(stale.end(), *it);
+		}
+	}
+
+	if(stale.empty())
+	{
+		return res;
+	}
+
+	/* Refresh all stale devices in one go, so that TcpClient can
+	 * pipeline their LIST VAR queries */
+	std::map<std::string,std::map<std::string,std::vector<std::string> > > fetched;
+	try
+	{
+		fetched = _client->getDevicesVariableValues(stale);
+	}
+	catch(NutException&)
+	{
+		if(res.empty())
+		{
+			throw;
+		}
+		/* Keep the answers we have, like TcpClient does for partial failures */
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	for(std::map<std::string,std::map<std::string,std::vector<std::string> > >::iterator it = fetched.begin(); it != fetched.end(); ++it)
+	{
+		Snapshot& snap = _snapshots[it->first];
+		res[it->first] = it->second;
+		snap.values.swap(it->second);
+		snap.loaded = now;
+		_stats.refreshes++;
+	}
+
+	return res;
+}
+
+TrackingID CachingClient::setDeviceVariable(const std::string& dev, const std::string& name, const std::string& value)
+{
+	invalidate(dev);
+	return _client->setDeviceVariable(dev, name, value);
+}
+
+TrackingID CachingClient::setDeviceVariable(const std::string& dev, const std::string& name, const std::vector<std::string>& values)
+{
+	invalidate(dev);
+	return _client->setDeviceVariable(dev, name, values);
+}
+
+std::set<std::string> CachingClient::getDeviceCommandNames(const std::string& dev)
+{
+	return _client->getDeviceCommandNames(dev);
+}
+
+std::string CachingClient::getDeviceCommandDescription(const std::string& dev, const std::string& name)
+{
+	return _client->getDeviceCommandDescription(dev, name);
+}
+
+TrackingID CachingClient::executeDeviceCommand(const std::string& dev, const std::string& name, const std::string& param)
+{
+	invalidate(dev);
+	return _client->executeDeviceCommand(dev, name, param);
+}
+
+void CachingClient::deviceLogin(const std::string& dev)
+{
+	_client->deviceLogin(dev);
+}
+
+int CachingClient::deviceGetNumLogins(const std::string& dev)
+{
+	return _client->deviceGetNumLogins(dev);
+}
+
+std::set<std::string> CachingClient::deviceGetClients(const std::string& dev)
+{
+	return _client->deviceGetClients(dev);
+}
+
+void CachingClient::deviceMaster(const std::string& dev)
+{
+	_client->deviceMaster(dev);
+}
+
+void CachingClient::devicePrimary(const std::string& dev)
+{
+	_client->devicePrimary(dev);
+}
+
+void CachingClient::deviceForcedShutdown(const std::string& dev)
+{
+	_client->deviceForcedShutdown(dev);
+}
+
+std::map<std::string, std::set<std::string>> CachingClient::listDeviceClients(void)
+{
+	return _client->listDeviceClients();
+}
+
+TrackingResult CachingClient::getTrackingResult(const TrackingID& id)
+{
+	return _client->getTrackingResult(id);
+}
+
+bool CachingClient::isFeatureEnabled(const Feature& feature)
+{
+	return _client->isFeatureEnabled(feature);
+}
+
+void CachingClient::setFeature(const Feature& feature, bool status)
+{
+	_client->setFeature(feature, status);
+}
+
+} /* namespace nut */
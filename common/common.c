@@ -2524,6 +2524,166 @@ double difftimespec(struct timespec x, struct timespec y)
 }
 #endif	/* HAVE_CLOCK_GETTIME && HAVE_CLOCK_MONOTONIC */
 
+void nut_latency_add(nut_latency_t *lat, double elapsed)
+{
+	uint64_t	usec;
+	size_t	bucket = 0;
+
+	if (!lat)
+		return;
+
+	usec = (elapsed > 0) ? (uint64_t)(elapsed * 1000000.0) : 0;
+
+	if (!lat->count || usec < lat->usec_min)
+		lat->usec_min = usec;
+	if (usec > lat->usec_max)
+		lat->usec_max = usec;
+
+	lat->count++;
+	lat->usec_total += usec;
+
+	while (usec && bucket < NUT_LATENCY_BUCKETS - 1) {
+		usec >>= 1;
+		bucket++;
+	}
+
+	lat->hist[bucket]++;
+}
+
+uint64_t nut_latency_percentile(const nut_latency_t *lat, unsigned int pct)
+{
+	uint64_t	want, seen = 0;
+	size_t	bucket;
+
+	if (!lat || !lat->count)
+		return 0;
+
+	want = (lat->count * pct + 99) / 100;
+
+	for (bucket = 0; bucket < NUT_LATENCY_BUCKETS - 1; bucket++) {
+		seen += lat->hist[bucket];
+		if (seen >= want)
+			break;
+	}
+
+	/* the histogram is coarse; never claim more than the real maximum */
+	if (((uint64_t)1 << bucket) > lat->usec_max)
+		return lat->usec_max;
+
+	return ((uint64_t)1 << bucket);
+}
+
+uint64_t nut_latency_avg(const nut_latency_t *lat)
+{
+	if (!lat || !lat->count)
+		return 0;
+
+	return lat->usec_total / lat->count;
+}
+
+#define NAMEIDX_NAME(idx, pos)	\
+	(*(const char **)((idx)->table + (pos) * (idx)->stride + (idx)->offset))
+
+size_t nut_strhash(const char *s, int casefold)
+{
+	uint32_t	h = 2166136261U;
+
+	for (; *s; s++) {
+		h ^= (uint32_t)(casefold ? tolower((unsigned char)*s) : (unsigned char)*s);
+		h *= 16777619U;
+	}
+
+	return (size_t)h;
+}
+
+static void nameidx_build(nut_nameidx_t *idx, void *table, size_t stride, size_t offset)
+{
+	size_t	count = 0, pos, slot;
+
+	nut_nameidx_free(idx);
+
+	idx->table = (char *)table;
+	idx->stride = stride;
+	idx->offset = offset;
+
+	while (NAMEIDX_NAME(idx, count))
+		count++;
+
+	/* keep the load factor at or below one half */
+	for (idx->size = 16; idx->size < count * 2; idx->size *= 2)
+		;
+
+	idx->slots = xcalloc(idx->size, sizeof(*idx->slots));
+	idx->next = xcalloc(count ? count : 1, sizeof(*idx->next));
+
+	for (pos = 0; pos < count; pos++) {
+		const char	*name = NAMEIDX_NAME(idx, pos);
+
+		for (slot = nut_strhash(name, 1) & (idx->size - 1); idx->slots[slot]; slot = (slot + 1) & (idx->size - 1)) {
+			size_t	tail = idx->slots[slot] - 1;
+
+			if (strcasecmp(NAMEIDX_NAME(idx, tail), name))
+				continue;
+
+			/* same name: chain it after the last one seen */
+			while (idx->next[tail])
+				tail = idx->next[tail] - 1;
+			idx->next[tail] = pos + 1;
+			break;
+		}
+
+		if (!idx->slots[slot])
+			idx->slots[slot] = pos + 1;
+	}
+
+	upsdebugx(5, "%s: indexed %" PRIuSIZE " entries in %" PRIuSIZE " slots",
+		__func__, count, idx->size);
+}
+
+void *nut_nameidx_find(nut_nameidx_t *idx, void *table, size_t stride, size_t offset, const char *name)
+{
+	size_t	slot;
+
+	if (!idx || !table || !name)
+		return NULL;
+
+	if (idx->table != (char *)table || idx->stride != stride || idx->offset != offset)
+		nameidx_build(idx, table, stride, offset);
+
+	for (slot = nut_strhash(name, 1) & (idx->size - 1); idx->slots[slot]; slot = (slot + 1) & (idx->size - 1)) {
+		size_t	pos = idx->slots[slot] - 1;
+
+		if (!strcasecmp(NAMEIDX_NAME(idx, pos), name))
+			return idx->table + pos * idx->stride;
+	}
+
+	return NULL;
+}
+
+void *nut_nameidx_next(const nut_nameidx_t *idx, const void *entry)
+{
+	size_t	pos;
+
+	if (!idx || !idx->table || !entry)
+		return NULL;
+
+	pos = (size_t)((const char *)entry - idx->table) / idx->stride;
+	if (!idx->next[pos])
+		return NULL;
+
+	return idx->table + (idx->next[pos] - 1) * idx->stride;
+}
+
+void nut_nameidx_free(nut_nameidx_t *idx)
+{
+	if (!idx)
+		return;
+
+	free(idx->slots);
+	free(idx->next);
+	memset(idx, 0, sizeof(*idx));
+}
+
 /* Help avoid cryptic "upsnotify: notify about state 4 with libsystemd:"
  * (with only numeric codes) below */
 const char *str_upsnotify_state(upsnotify_state_t state) {
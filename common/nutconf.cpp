@@ -245,6 +245,21 @@ std::string NutParser::parseSTRCHARS()
  * \return Token type.
  */
 NutParser::Token NutParser::parseToken()
+{
+	Token token;
+
+	parseToken(token);
+
+	return token;
+}
+
+/** Parse the next token into "token", reusing its string storage.
+ * Runs of plain characters are appended at once, rather than one
+ * character at a time: this is where loading large configurations
+ * spends most of its time.
+ * \return true if a token was found, like Token::operator bool().
+ */
+bool NutParser::parseToken(Token& token)
 {
 
 	/** Lexical parsing machine state enumeration.*/
@@ -256,37 +271,50 @@ NutParser::Token NutParser::parseToken()
 	} LEXPARSING_STATE_e;
 	LEXPARSING_STATE_e state = LEXPARSING_STATE_DEFAULT;
 
-	Token token;
+	const bool  colon = !hasOptions(OPTION_IGNORE_COLON);
+	const char* begin = _buffer.data();
+	const char* end   = begin + _buffer.size();
+	const char* p     = begin + (_pos < _buffer.size() ? _pos : _buffer.size());
+	const char* start = p;
+	const char* run;
 	bool escaped = false;
 
-	pushPos();
+	token.type = Token::TOKEN_NONE;
+	token.str.clear();
+
+	while (p < end) {
+		char c = *p++;
+
+		if (c == 0) {
+			/* Embedded NUL: ends the token like EOF (but is consumed) */
+			break;
+		}
 
-	for (char c = get(); c != 0 /*EOF*/; c = get()) {
 		switch (state) {
 			case LEXPARSING_STATE_DEFAULT: /* Wait for a non-space char */
 			{
 				if (c == ' ' || c == '\t') {
 					/* Space : do nothing */
 				} else if (c == '[') {
-					token = Token(Token::TOKEN_BRACKET_OPEN, c);
-					popPos();
-					return token;
+					token.type = Token::TOKEN_BRACKET_OPEN;
+					token.str.assign(1, c);
+					goto done;
 				} else if (c == ']') {
-					token = Token(Token::TOKEN_BRACKET_CLOSE, c);
-					popPos();
-					return token;
-				} else if (c == ':' && !hasOptions(OPTION_IGNORE_COLON)) {
-					token = Token(Token::TOKEN_COLON, c);
-					popPos();
-					return token;
+					token.type = Token::TOKEN_BRACKET_CLOSE;
+					token.str.assign(1, c);
+					goto done;
+				} else if (c == ':' && colon) {
+					token.type = Token::TOKEN_COLON;
+					token.str.assign(1, c);
+					goto done;
 				} else if (c == '=') {
-					token = Token(Token::TOKEN_EQUAL, c);
-					popPos();
-					return token;
+					token.type = Token::TOKEN_EQUAL;
+					token.str.assign(1, c);
+					goto done;
 				} else if (c == '\r' || c == '\n') {
-					token = Token(Token::TOKEN_EOL, c);
-					popPos();
-					return token;
+					token.type = Token::TOKEN_EOL;
+					token.str.assign(1, c);
+					goto done;
 				} else if (c == '#') {
 					token.type = Token::TOKEN_COMMENT;
 					state = LEXPARSING_STATE_COMMENT;
@@ -305,20 +333,31 @@ NutParser::Token NutParser::parseToken()
 					state = LEXPARSING_STATE_STRING;
 					token.str += c;
 				} else {
-					rewind();
-					return Token(Token::TOKEN_UNKNOWN);
+					_pos = static_cast<size_t>(start - begin);
+					token.type = Token::TOKEN_UNKNOWN;
+					return false;
 				}
 				break;
 			}
 			case LEXPARSING_STATE_QUOTED_STRING:
 			{
+				if (!escaped) {
+					/* Fast path: run of characters taken as they are */
+					for (run = p - 1; run < end && *run != '"' && *run != '\\'
+						&& (*run == ' ' || *run == '\t' || isgraph(*run)); ++run) {}
+					if (run >= p) {
+						token.str.append(p - 1, run);
+						p = run;
+						break;
+					}
+				}
+
 				if (c == '"') {
 					if (escaped) {
 						escaped = false;
 						token.str += '"';
 					} else {
-						popPos();
-						return token;
+						goto done;
 					}
 				} else if (c == '\\') {
 					if (escaped) {
@@ -331,12 +370,8 @@ NutParser::Token NutParser::parseToken()
 					token.str += c;
 				} else if (c == '\r' || c == '\n') /* EOL */{
 					/* WTF ? consider it as correct ? */
-					back();
-					popPos();
-					return token;
-				} else if (c == 0) /* EOF */ {
-					popPos();
-					return token;
+					--p;
+					goto done;
 				} else /* Bad character ?? */ {
 					/* WTF ? Keep, Ignore ? */
 				}
@@ -345,17 +380,28 @@ NutParser::Token NutParser::parseToken()
 			}
 			case LEXPARSING_STATE_STRING:
 			{
+				if (!escaped) {
+					/* Fast path: run of plain characters */
+					for (run = p - 1; run < end && *run != '\\' && isgraph(*run)
+						&& *run != '"' && *run != '#' && *run != '[' && *run != ']'
+						&& *run != '=' && !(*run == ':' && colon); ++run) {}
+					if (run >= p) {
+						token.str.append(p - 1, run);
+						p = run;
+						break;
+					}
+				}
+
 				if (c == ' ' || c == '\t' || c == '"' || c == '#' || c == '[' || c == ']'
-				||  (c == ':' && !hasOptions(OPTION_IGNORE_COLON))
+				||  (c == ':' && colon)
 				||  c == '='
 				) {
 					if (escaped) {
 						escaped = false;
 						token.str += c;
 					} else {
-						back();
-						popPos();
-						return token;
+						--p;
+						goto done;
 					}
 				} else if (c == '\\') {
 					if (escaped) {
@@ -365,13 +411,9 @@ NutParser::Token NutParser::parseToken()
 						escaped = true;
 					}
 				} else if (c == '\r' || c == '\n') /* EOL */{
-					back();
-					popPos();
-					return token;
-				} else if (c == 0) /* EOF */ {
-					popPos();
-					return token;
-				}else if (isgraph(c)) {
+					--p;
+					goto done;
+				} else if (isgraph(c)) {
 					token.str += c;
 				} else /* Bad character ?? */ {
 					/* WTF ? Keep, Ignore ? */
@@ -382,10 +424,13 @@ NutParser::Token NutParser::parseToken()
 			case LEXPARSING_STATE_COMMENT:
 			{
 				if (c == '\r' || c == '\n') {
-					return token;
-				} else {
-					token.str += c;
+					goto done;
 				}
+
+				/* The rest of the line, as is */
+				for (run = p; run < end && *run != '\r' && *run != '\n' && *run != 0; ++run) {}
+				token.str.append(p - 1, run);
+				p = run;
 				break;
 			}
 
@@ -415,8 +460,11 @@ NutParser::Token NutParser::parseToken()
 #endif
 		}
 	}
-	popPos();
-	return token;
+
+done:
+	_pos = static_cast<size_t>(p - begin);
+
+	return static_cast<bool>(token);
 }
 
 std::list<NutParser::Token> NutParser::parseLine()
@@ -525,8 +573,8 @@ void NutConfigParser::parseConfig()
 # pragma clang diagnostic ignored "-Wcovered-switch-default"
 #endif
 	while (1) {
-		tok = parseToken();
-		if (!tok)
+		/* Reuse the token storage, and hand strings over by swapping */
+		if (!parseToken(tok))
 			break;
 		switch (state) {
 			case CPS_DEFAULT:
@@ -540,7 +588,7 @@ void NutConfigParser::parseConfig()
 						break;
 					case Token::TOKEN_STRING:
 					case Token::TOKEN_QUOTED_STRING:
-						name = tok.str;
+						name.swap(tok.str);
 						state = CPS_DIRECTIVE_HAVE_NAME;
 						break;
 
@@ -560,7 +608,7 @@ void NutConfigParser::parseConfig()
 					case Token::TOKEN_STRING:
 					case Token::TOKEN_QUOTED_STRING:
 						/* Should occur ! */
-						name = tok.str;
+						name.swap(tok.str);
 						state = CPS_SECTION_HAVE_NAME;
 						break;
 					case Token::TOKEN_BRACKET_CLOSE:
@@ -680,7 +728,8 @@ void NutConfigParser::parseConfig()
 					case Token::TOKEN_STRING:
 					case Token::TOKEN_QUOTED_STRING:
 						/* Could occur ! */
-						values.push_back(tok.str);
+						values.push_back(std::string());
+						values.back().swap(tok.str);
 						state = CPS_DIRECTIVE_VALUES;
 						break;
 
@@ -716,7 +765,8 @@ void NutConfigParser::parseConfig()
 					case Token::TOKEN_STRING:
 					case Token::TOKEN_QUOTED_STRING:
 						/* Could occur ! */
-						values.push_back(tok.str);
+						values.push_back(std::string());
+						values.back().swap(tok.str);
 						state = CPS_DIRECTIVE_VALUES;
 						break;
 
@@ -826,10 +876,10 @@ void DefaultConfigParser::onParseDirective(
 	// Separator has no specific semantic in this context
 
 	// Save values
-	_section.entries[directiveName].name = directiveName;
-	_section.entries[directiveName].values = values;
+	GenericConfigSectionEntry& entry = _section.entries[directiveName];
 
-	// TODO Can probably be optimized.
+	entry.name   = directiveName;
+	entry.values = values;
 }
 
 void DefaultConfigParser::onParseEnd()
@@ -55,6 +55,9 @@ extern "C" {
 #include <dirent.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#ifndef WIN32
+# include <sys/mman.h>
+#endif	/* !WIN32 */
 
 /* Windows/Linux Socket compatibility layer, lifted from nutclient.cpp
  * (note we do not use wincompat.h here as it slightly conflicts, with
@@ -710,20 +713,42 @@ NutStream::status_t NutFile::getString(std::string & str)
 	if (nullptr == m_impl)
 		return NUTS_ERROR;
 
-	// Note that ::fgetc is used instead of ::fgets
+#ifndef WIN32
+	// The rest of a regular file is copied from a memory mapping
+	// in one go. The mapping only lives during this call, so the
+	// file being rewritten later can not bite us.
+	// (unwritten data of read-write streams has to hit the file first)
+	struct stat st;
+	off_t       pos = ::ftello(m_impl);
+
+	if (pos >= 0 && 0 == ::fflush(m_impl) && 0 == ::fstat(::fileno(m_impl), &st)
+	&&  S_ISREG(st.st_mode) && st.st_size > pos
+	) {
+		size_t len = static_cast<size_t>(st.st_size);
+		void * map = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, ::fileno(m_impl), 0);
+
+		if (MAP_FAILED != map) {
+			str.append(static_cast<const char *>(map) + pos, len - static_cast<size_t>(pos));
+			::munmap(map, len);
+
+			// Leave the stream at the end, as reading it would
+			// (and pick up anything appended since fstat() above)
+			if (0 != ::fseeko(m_impl, st.st_size, SEEK_SET))
+				return NUTS_ERROR;
+		}
+	}
+#endif	/* !WIN32 */
+
+	// Note that ::fread is used instead of ::fgets
 	// That's because of \0 char. support
 	for (;;) {
-		char ch;
-
-		status_t status = fgetcWrapper(m_impl, ch);
-
-		if (NUTS_ERROR == status)
-			return status;
+		char   buffer[4096];
+		size_t read_cnt = ::fread(buffer, 1, sizeof(buffer), m_impl);
 
-		if (NUTS_EOF == status)
-			return NUTS_OK;
+		str.append(buffer, read_cnt);
 
-		str += ch;
+		if (read_cnt < sizeof(buffer))
+			return ::ferror(m_impl) ? NUTS_ERROR : NUTS_OK;
 	}
 }
 
@@ -765,16 +790,16 @@ NutStream::status_t NutFile::putData(const std::string & data)
 		throw()
 #endif
 {
-	// Unfortunately, C FILE interface doesn't have non C-string
-	// put function (i.e. function for raw data output with size specifier
-	for (size_t i = 0; i < data.size(); ++i) {
-		status_t st = putChar(data.at(i));
+	if (nullptr == m_impl)
+		return NUTS_ERROR;
 
-		if (NUTS_ERROR == st)
-			return NUTS_ERROR;
-	}
+	// Unlike fputs(), fwrite() copes with embedded NUL characters
+	if (data.empty())
+		return NUTS_OK;
 
-	return NUTS_OK;
+	size_t write_cnt = ::fwrite(data.data(), 1, data.size(), m_impl);
+
+	return write_cnt == data.size() ? NUTS_OK : NUTS_ERROR;
 }
 
 
@@ -1100,7 +1125,9 @@ NutSocket::NutSocket(domain_t dom, type_t type, proto_t proto):
 	m_domain(dom),
 	m_type(type),
 	m_current_ch('\0'),
-	m_current_ch_valid(false)
+	m_current_ch_valid(false),
+	m_rbuf_pos(0),
+	m_rbuf_len(0)
 {
 	int cdom   = static_cast<int>(dom);
 	int ctype  = static_cast<int>(type);
@@ -1250,6 +1277,10 @@ bool NutSocket::close(int & err_code, std::string & err_msg)
 	if (0 == err_code) {
 		m_impl = -1;
 
+		/* Whatever was read ahead belonged to that connection */
+		m_current_ch_valid = false;
+		m_rbuf_pos = m_rbuf_len = 0;
+
 		return true;
 	}
 
@@ -1266,39 +1297,62 @@ NutSocket::~NutSocket() {
 }
 
 
-NutStream::status_t NutSocket::getChar(char & ch)
+NutStream::status_t NutSocket::fillBuffer()
 #if (defined __cplusplus) && (__cplusplus < 201100)
 		throw()
 #endif
 {
-	if (m_current_ch_valid) {
-		ch = m_current_ch;
-
+	if (m_rbuf_pos < m_rbuf_len)
 		return NUTS_OK;
+
+	m_rbuf_pos = m_rbuf_len = 0;
+
+	// Takes whatever is available (up to the buffer size),
+	// so this blocks no longer than a single-byte read would
+	for (;;) {
+		ssize_t read_cnt = sktread(m_impl, m_rbuf, sizeof(m_rbuf));
+
+		if (read_cnt > 0) {
+			m_rbuf_len = static_cast<size_t>(read_cnt);
+
+			return NUTS_OK;
+		}
+
+		if (0 == read_cnt)
+			return NUTS_EOF;
+
+		if (EINTR != errno)
+			break;
 	}
 
-	// TBD: Perhaps we should buffer more bytes at once
-	// However, buffering is already done in kernel space,
-	// so unless we need greater reading efficiency, char-by-char
-	// reading should be sufficient
+	// TODO: At least logging of the error (errno), if not propagation
+
+	return NUTS_ERROR;
+}
 
-	ssize_t read_cnt = ::read(m_impl, &ch, 1);
 
-	if (1 == read_cnt) {
-		m_current_ch       = ch;
-		m_current_ch_valid = true;
+NutStream::status_t NutSocket::getChar(char & ch)
+#if (defined __cplusplus) && (__cplusplus < 201100)
+		throw()
+#endif
+{
+	if (m_current_ch_valid) {
+		ch = m_current_ch;
 
 		return NUTS_OK;
 	}
 
-	if (0 == read_cnt)
-		return NUTS_EOF;
+	status_t status = fillBuffer();
 
-	assert(-1 == read_cnt);
+	if (NUTS_OK != status)
+		return status;
 
-	// TODO: At least logging of the error (errno), if not propagation
+	ch = m_rbuf[m_rbuf_pos++];
 
-	return NUTS_ERROR;
+	m_current_ch       = ch;
+	m_current_ch_valid = true;
+
+	return NUTS_OK;
 }
 
 
@@ -1321,18 +1375,35 @@ NutStream::status_t NutSocket::getString(std::string & str)
 
 	m_current_ch_valid = false;
 
-	char buffer[512];
+	// Drain the read-ahead buffer, then read the rest
+	// of the stream in big chunks directly into the string
+	str.append(m_rbuf + m_rbuf_pos, m_rbuf_len - m_rbuf_pos);
+	m_rbuf_pos = m_rbuf_len = 0;
+
+	size_t chunk = sizeof(m_rbuf);
 
 	for (;;) {
-		ssize_t read_cnt = sktread(m_impl, buffer, sizeof(buffer) / sizeof(buffer[0]));
+		size_t size = str.size();
+
+		str.resize(size + chunk);
+
+		ssize_t read_cnt = sktread(m_impl, &str[size], chunk);
+
+		str.resize(size + (read_cnt > 0 ? static_cast<size_t>(read_cnt) : 0));
+
+		if (read_cnt < 0) {
+			if (EINTR == errno)
+				continue;
 
-		if (read_cnt < 0)
 			return NUTS_ERROR;
+		}
 
 		if (0 == read_cnt)
 			return NUTS_OK;
 
-		str.append(buffer, static_cast<size_t>(read_cnt));
+		// Grow the chunk size while the stream keeps filling it
+		if (static_cast<size_t>(read_cnt) == chunk && chunk < 256 * 1024)
+			chunk *= 2;
 	}
 }
 
@@ -1366,22 +1437,30 @@ NutStream::status_t NutSocket::putString(const std::string & str)
 	if (0 == str_len)
 		return NUTS_OK;
 
-	ssize_t write_cnt = sktwrite(m_impl, str.data(), str_len);
-
-	// TODO: Under certain circumstances, less than the whole
-	// string might be written
+	// A blocking socket may still accept only a part of the data
+	// (e.g. when interrupted by a signal), so write the rest too.
 	// Review the code if async. I/O is supported (in which case
 	// the function shall have to implement the blocking using
 	// select/poll/epoll on its own (probably select for portability)
+	const char * data = str.data();
 
-	assert(write_cnt > 0);
+	while (str_len > 0) {
+		ssize_t write_cnt = sktwrite(m_impl, data, str_len);
 
-	if (static_cast<size_t>(write_cnt) == str_len)
-		return NUTS_OK;
+		if (write_cnt < 0) {
+			if (EINTR == errno)
+				continue;
 
-	// TODO: At least logging of the error (errno), if not propagation
+			// TODO: At least logging of the error (errno), if not propagation
 
-	return NUTS_ERROR;
+			return NUTS_ERROR;
+		}
+
+		data    += write_cnt;
+		str_len -= static_cast<size_t>(write_cnt);
+	}
+
+	return NUTS_OK;
 }
 
 }  // end of namespace nut
@@ -117,10 +117,10 @@ static void pconf_fatal(PCONF_CTX_t *ctx, const char *errtxt)
 	exit(EXIT_FAILURE);
 }
 
-static void add_arg_word(PCONF_CTX_t *ctx)
+/* append a complete word of wbuflen characters to the arglist */
+static void add_arg_word(PCONF_CTX_t *ctx, const char *word, size_t wbuflen)
 {
 	size_t	argpos;
-	size_t	wbuflen;
 
 	/* this is where the new value goes */
 	argpos = ctx->numargs;
@@ -149,8 +149,6 @@ static void add_arg_word(PCONF_CTX_t *ctx)
 		ctx->argsize[argpos] = 0;
 	}
 
-	wbuflen = strlen(ctx->wordbuf);
-
 	/* now see if the string itself grew compared to last time */
 	if (wbuflen >= ctx->argsize[argpos]) {
 		size_t	newlen;
@@ -168,18 +166,17 @@ static void add_arg_word(PCONF_CTX_t *ctx)
 		ctx->argsize[argpos] = newlen;
 	}
 
-	/* strncpy doesn't give us a trailing NULL, so prep the space */
-	memset(ctx->arglist[argpos], '\0', ctx->argsize[argpos]);
-
 	/* finally copy the new value into the provided space */
-	strncpy(ctx->arglist[argpos], ctx->wordbuf, wbuflen);
+	memcpy(ctx->arglist[argpos], word, wbuflen);
+	ctx->arglist[argpos][wbuflen] = '\0';
 }
 
 static void addchar(PCONF_CTX_t *ctx)
 {
 	size_t	wbuflen;
 
-	wbuflen = strlen(ctx->wordbuf);
+	/* no NUL gets past the check below, so this is strlen(wordbuf) */
+	wbuflen = (size_t)(ctx->wordptr - ctx->wordbuf);
 
 	/* CVE-2012-2944: only allow the subset of ASCII charset from Space to ~ */
 	if ((ctx->ch < 0x20) || (ctx->ch > 0x7f)) {
@@ -226,12 +223,29 @@ static void endofword(PCONF_CTX_t *ctx)
 		}
 	}
 
-	add_arg_word(ctx);
+	add_arg_word(ctx, ctx->wordbuf, (size_t)(ctx->wordptr - ctx->wordbuf));
 
 	ctx->wordptr = ctx->wordbuf;
 	*ctx->wordptr = '\0';
 }
 
+/* endofword() for a word taken straight from the input */
+static void fast_word(PCONF_CTX_t *ctx, const char *word, size_t len)
+{
+	if (ctx->arg_limit != 0) {
+		if (ctx->numargs >= ctx->arg_limit)
+			return;
+	}
+
+	/* addchar() stops appending at the limit */
+	if (ctx->wordlen_limit != 0) {
+		if (len > ctx->wordlen_limit)
+			len = ctx->wordlen_limit;
+	}
+
+	add_arg_word(ctx, word, len);
+}
+
 /* look for the beginning of a word */
 static int findwordstart(PCONF_CTX_t *ctx)
 {
@@ -378,6 +392,72 @@ static int collectliteral(PCONF_CTX_t *ctx)
 	return STATE_COLLECT;
 }
 
+/* characters the state machine would simply store with addchar() */
+#define FAST_PLAIN(c)	((c) > 0x20 && (c) <= 0x7f && (c) != '#' && (c) != '\\')
+#define FAST_SPACE(c)	((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\v' || (c) == '\f')
+
+/* Fast path: a line made only of plain words, "quoted strings" without
+ * escapes, spaces and '=' signs (no comments, continuations or characters
+ * addchar() rejects) is split here directly, the way the state machine
+ * would do it.
+ * Returns the state the machine would end in, or 0 if the line needs
+ * the state machine (then nothing is kept from this attempt).
+ */
+static int fast_line(PCONF_CTX_t *ctx, const char *line, size_t len)
+{
+	const unsigned char	*p = (const unsigned char *)line;
+	size_t	i = 0, start;
+
+	while (i < len) {
+		if (FAST_SPACE(p[i])) {
+			i++;
+			continue;
+		}
+
+		if (p[i] == '=') {
+			fast_word(ctx, &line[i], 1);
+			i++;
+			continue;
+		}
+
+		if (p[i] == '"') {
+			start = ++i;
+
+			/* the machine takes a space, but drops other controls */
+			while ((i < len) && (p[i] == ' '
+				|| (FAST_PLAIN(p[i]) && p[i] != '"'))
+			)
+				i++;
+
+			if ((i >= len) || (p[i] != '"'))
+				goto complex;
+
+			fast_word(ctx, &line[start], i - start);
+			i++;
+			continue;
+		}
+
+		if (!FAST_PLAIN(p[i]))
+			goto complex;
+
+		/* a " only opens a quoted word at the start */
+		start = i;
+		while ((i < len) && FAST_PLAIN(p[i]) && (p[i] != '='))
+			i++;
+
+		fast_word(ctx, &line[start], i - start);
+
+		if (i == len)
+			return STATE_COLLECT;
+	}
+
+	return STATE_FINDWORDSTART;
+
+complex:
+	ctx->numargs = 0;
+	return 0;
+}
+
 /* clean up memory before going back to the user */
 static void free_storage(PCONF_CTX_t *ctx)
 {
@@ -572,6 +652,26 @@ int pconf_line(PCONF_CTX_t *ctx, const char *line)
 
 	linelen = strlen(line);
 
+	/* plain lines skip the state machine */
+	if (ctx->wordptr == ctx->wordbuf) {
+		const char	*nl = memchr(line, '\n', linelen);
+		size_t	seglen = nl ? (size_t)(nl - line) : linelen;
+		int	state = fast_line(ctx, line, seglen);
+
+		if (state != 0) {
+			if (nl) {
+				ctx->ch = '\n';
+				ctx->state = STATE_ENDOFLINE;
+			} else {
+				if (seglen > 0)
+					ctx->ch = line[seglen - 1];
+				ctx->state = state;
+			}
+
+			return 1;
+		}
+	}
+
 	for (i = 0; i < linelen; i++) {
 		ctx->ch = line[i];
 
@@ -652,3 +752,52 @@ int pconf_char(PCONF_CTX_t *ctx, char ch)
 
 	return 0;
 }
+
+/* parse as much of buf as it takes to complete a line, like repeated
+ * pconf_char() calls would; *used tells how many bytes were consumed */
+int pconf_buffer(PCONF_CTX_t *ctx, const char *buf, size_t len, size_t *used)
+{
+	const char	*nl;
+	size_t	i;
+
+	*used = 0;
+
+	if (!check_magic(ctx))
+		return -1;
+
+	/* if the last call finished a line, clean stuff up for another */
+	if ((ctx->state == STATE_ENDOFLINE) || (ctx->state == STATE_PARSEERR)) {
+		ctx->numargs = 0;
+		ctx->state = STATE_FINDWORDSTART;
+	}
+
+	/* a whole plain line at hand: split it in one go */
+	if ((ctx->state == STATE_FINDWORDSTART) && (ctx->numargs == 0)
+		&& (ctx->wordptr == ctx->wordbuf)
+		&& ((nl = memchr(buf, '\n', len)) != NULL)
+		&& (fast_line(ctx, buf, (size_t)(nl - buf)) != 0)
+	) {
+		ctx->ch = '\n';
+		ctx->state = STATE_ENDOFLINE;
+		*used = (size_t)(nl - buf) + 1;
+		return 1;
+	}
+
+	for (i = 0; i < len; i++) {
+		ctx->ch = buf[i];
+		parse_char(ctx);
+
+		if (ctx->state == STATE_ENDOFLINE) {
+			*used = i + 1;
+			return 1;
+		}
+
+		if (ctx->state == STATE_PARSEERR) {
+			*used = i + 1;
+			return -1;
+		}
+	}
+
+	*used = len;
+	return 0;
+}
@@ -36,8 +36,175 @@
 #include "state.h"
 #include "parseconf.h"
 
+#include <stddef.h>	/* offsetof() */
+
 /* internal helpers */
 
+/* Variable names (and enum values) repeat across the trees of all
+ * devices served by one process, so only one reference-counted copy of
+ * each is kept in a shared table. Tree nodes come from slabs instead of
+ * one malloc() apiece. Like the rest of this file, none of this is
+ * thread-safe.
+ */
+
+typedef struct st_name_s {
+	struct st_name_s	*next;
+	size_t	hash;
+	size_t	refs;
+	char	name[1];	/* allocated to fit */
+} st_name_t;
+
+#define ST_NAMES_MINSIZE	256
+#define ST_NODE_SLAB	64
+#define ST_VAL_ROUNDUP	16
+
+static st_name_t	**st_names = NULL;
+static size_t	st_names_size = 0, st_names_count = 0;
+
+static st_tree_t	*st_node_free_list = NULL;
+static st_tree_t	**st_node_slabs = NULL;	/* so they stay reachable */
+static size_t	st_node_slabs_count = 0;
+
+static void st_names_grow(void)
+{
+	st_name_t	**table;
+	size_t	i, size = st_names_size ? st_names_size * 2 : ST_NAMES_MINSIZE;
+
+	table = xcalloc(size, sizeof(*table));
+
+	for (i = 0; i < st_names_size; i++) {
+		st_name_t	*item = st_names[i], *next;
+
+		for (; item; item = next) {
+			next = item->next;
+			item->next = table[item->hash % size];
+			table[item->hash % size] = item;
+		}
+	}
+
+	free(st_names);
+	st_names = table;
+	st_names_size = size;
+}
+
+/* return the shared copy of name, creating it if needed */
+static char *st_name_get(const char *name)
+{
+	st_name_t	*item;
+	size_t	hash = nut_strhash(name, 0), len;
+
+	if (st_names_size) {
+		for (item = st_names[hash % st_names_size]; item; item = item->next) {
+			if (item->hash == hash && !strcmp(item->name, name)) {
+				item->refs++;
+				return item->name;
+			}
+		}
+	}
+
+	if (st_names_count >= st_names_size) {
+		st_names_grow();
+	}
+
+	len = strlen(name);
+	item = xcalloc(1, offsetof(st_name_t, name) + len + 1);
+	memcpy(item->name, name, len + 1);
+	item->hash = hash;
+	item->refs = 1;
+	item->next = st_names[hash % st_names_size];
+	st_names[hash % st_names_size] = item;
+	st_names_count++;
+
+	return item->name;
+}
+
+/* drop a reference taken with st_name_get() */
+static void st_name_put(char *name)
+{
+	st_name_t	*item, **iptr;
+
+	if (!name) {
+		return;
+	}
+
+	item = (st_name_t *)(void *)(name - offsetof(st_name_t, name));
+
+	if (--item->refs > 0) {
+		return;
+	}
+
+	for (iptr = &st_names[item->hash % st_names_size]; *iptr; iptr = &(*iptr)->next) {
+		if (*iptr == item) {
+			*iptr = item->next;
+			break;
+		}
+	}
+
+	free(item);
+	st_names_count--;
+}
+
+static st_tree_t *st_tree_node_new(void)
+{
+	st_tree_t	*node;
+
+	if (!st_node_free_list) {
+		st_tree_t	*slab = xcalloc(ST_NODE_SLAB, sizeof(*slab));
+		size_t	i;
+
+		/* slabs are kept for reuse, never handed back */
+		st_node_slabs = xrealloc(st_node_slabs,
+			(st_node_slabs_count + 1) * sizeof(*st_node_slabs));
+		st_node_slabs[st_node_slabs_count++] = slab;
+
+		for (i = 0; i < ST_NODE_SLAB; i++) {
+			slab[i].left = st_node_free_list;
+			st_node_free_list = &slab[i];
+		}
+	}
+
+	node = st_node_free_list;
+	st_node_free_list = node->left;
+	memset(node, 0, sizeof(*node));
+
+	return node;
+}
+
+/* store val in node->raw, reusing the buffer when it fits */
+static size_t st_tree_node_setraw(st_tree_t *node, const char *val)
+{
+	size_t	len = strlen(val);
+
+	/* leave some room for the value to grow (e.g. 99 -> 100) */
+	if (node->rawsize < len + 1) {
+		node->rawsize = (len + ST_VAL_ROUNDUP) & ~((size_t)ST_VAL_ROUNDUP - 1);
+		node->raw = xrealloc(node->raw, node->rawsize);
+	}
+
+	memcpy(node->raw, val, len + 1);
+
+	return len;
+}
+
+/* characters pconf_encode() escapes */
+#define ST_VAL_ESCAPE	"#\\\""
+
+/* after raw changed: values with nothing to escape (the vast majority)
+ * are sent as they are, others only get encoded once somebody reads them
+ * with st_tree_node_getval() */
+static void val_update(st_tree_t *node, size_t len)
+{
+	/* pconf_encode() would also truncate long values */
+	if (len < ST_MAX_VALUE_LEN && !strpbrk(node->raw, ST_VAL_ESCAPE)) {
+		node->val = node->raw;
+		node->safe_dirty = 0;
+		return;
+	}
+
+	node->val = NULL;
+	node->safe_dirty = 1;
+}
+
 static void val_escape(st_tree_t *node)
 {
 	char	etmp[ST_MAX_VALUE_LEN];
@@ -69,7 +236,7 @@ static void st_tree_enum_free(enum_t *list)
 
 	st_tree_enum_free(list->next);
 
-	free(list->val);
+	st_name_put(list->val);
 	free(list);
 }
 
@@ -87,7 +254,7 @@ static void st_tree_range_free(range_t *list)
 /* free all memory associated with a node */
 static void st_tree_node_free(st_tree_t *node)
 {
-	free(node->var);
+	st_name_put(node->var);
 	free(node->raw);
 	free(node->safe);
 
@@ -99,8 +266,9 @@ static void st_tree_node_free(st_tree_t *node)
 	/* and the list of ranges */
 	st_tree_range_free(node->range_list);
 
-	/* now finally kill the node itself */
-	free(node);
+	/* now finally hand the node back to its slab */
+	node->left = st_node_free_list;
+	st_node_free_list = node;
 }
 
 /* add a subtree to another subtree */
@@ -307,29 +475,18 @@ int state_setinfo(st_tree_t **nptr, const char *var, const char *val)
 			return 0;	/* no change */
 		}
 
-		/* expand the buffer if the value grows */
-		if (node->rawsize < (strlen(val) + 1)) {
-			node->rawsize = strlen(val) + 1;
-			node->raw = xrealloc(node->raw, node->rawsize);
-		}
-
 		/* store the literal value for later comparisons */
-		snprintf(node->raw, node->rawsize, "%s", val);
-
-		val_escape(node);
+		val_update(node, st_tree_node_setraw(node, val));
 
 		return 1;	/* changed */
 	}
 
-	*nptr = xcalloc(1, sizeof(**nptr));
+	*nptr = st_tree_node_new();
 
-	(*nptr)->var = xstrdup(var);
-	(*nptr)->raw = xstrdup(val);
-	(*nptr)->rawsize = strlen(val) + 1;
+	(*nptr)->var = st_name_get(var);
+	val_update(*nptr, st_tree_node_setraw(*nptr, val));
 	st_tree_node_refresh_timestamp(*nptr);
 
-	val_escape(*nptr);
-
 	return 1;	/* added */
 }
 
@@ -348,7 +505,7 @@ static int st_tree_enum_add(enum_t **list, const char *enc)
 	}
 
 	item = xcalloc(1, sizeof(*item));
-	item->val = xstrdup(enc);
+	item->val = st_name_get(enc);
 	item->next = *list;
 
 	/* now we're done creating it, add it to the list */
@@ -454,6 +611,22 @@ int state_setaux(st_tree_t *root, const char *var, const char *auxs)
 	return 1;
 }
 
+/* the value escaped for the protocol, encoded on first use after a change */
+const char *st_tree_node_getval(const st_tree_t *node)
+{
+	if (!node)
+		return NULL;
+
+	if (node->safe_dirty) {
+		st_tree_t	*wnode = (st_tree_t *)node;
+
+		val_escape(wnode);
+		wnode->safe_dirty = 0;
+	}
+
+	return node->val;
+}
+
 const char *state_getinfo(st_tree_t *root, const char *var)
 {
 	st_tree_t	*sttmp;
@@ -465,7 +638,7 @@ const char *state_getinfo(st_tree_t *root, const char *var)
 		return NULL;
 	}
 
-	return sttmp->val;
+	return st_tree_node_getval(sttmp);
 }
 
 int state_getflags(st_tree_t *root, const char *var)
@@ -659,7 +832,7 @@ static int st_tree_del_enum(enum_t **list, const char *val)
 		/* we found it! */
 		*list = item->next;
 
-		free(item->val);
+		st_name_put(item->val);
 		free(item);
 
 		return 1;	/* deleted */
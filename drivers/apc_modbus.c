@@ -1034,9 +1034,19 @@ static void _apc_modbus_handle_error(modbus_t *ctx)
 
 static int _apc_modbus_read_registers(modbus_t *ctx, int addr, int nb, uint16_t *dest)
 {
+	int	rval;
+	struct timeval	start, stop;
+
 	_apc_modbus_interframe_delay();
 
-	if (modbus_read_registers(ctx, addr, nb, dest) > 0) {
+	gettimeofday(&start, NULL);
+	rval = modbus_read_registers(ctx, addr, nb, dest);
+	gettimeofday(&stop, NULL);
+
+	dstate_stats_io(difftimeval(stop, start),
+		(rval > 0) ? 1 : (errno == ETIMEDOUT) ? 0 : -1);
+
+	if (rval > 0) {
 		_apc_modbus_interframe_delay_reset();
 		return 1;
 	} else {
@@ -68,7 +68,7 @@ typedef struct pollfd {
 #include "nut_stdint.h"
 
 #define DRIVER_NAME	"apcupsd network client UPS driver"
-#define DRIVER_VERSION	"0.75"
+#define DRIVER_VERSION	"0.76"
 
 #define POLL_INTERVAL_MIN 10
 
@@ -84,17 +84,37 @@ upsdrv_info_t upsdrv_info = {
 static uint16_t	port = 3551;	/* apcupsd default port */
 static struct addrinfo	*host = NULL;
 
-static void process(char *item,char *data)
+/* NIS session with apcupsd, kept open between polls unless "oneshot"
+ * is set; after failures to connect, retries are spaced out */
+#define NIS_BACKOFF_MAX	120
+
+static TYPE_FD_SOCK	nis_fd = ERROR_FD_SOCK;
+#ifdef WIN32
+static HANDLE	nis_event = NULL;
+#endif	/* WIN32 */
+static int	nis_oneshot = 0;
+static time_t	nis_retry_at = 0;
+static time_t	nis_backoff = 0;
+
+/* Raw apcupsd value last applied to each nut_data[] entry, so the lines
+ * which did not change since the previous poll are not processed again */
+typedef struct {
+	char	*raw;
+	int	set;		/* the NUT variable was set from raw */
+	int	present;	/* the item was in the latest reply */
+} nis_last_t;
+
+static nis_last_t	nis_last[SIZEOF_ARRAY(nut_data)];
+
+/* Apply one apcupsd value to the nut_data[i] entry; returns 1 if that
+ * resulted in the NUT variable being set */
+static int process_entry(int i, char *data)
 {
-	int i;
+	int ret = 1;
 	char *p1;
 	char *p2;
 
-	for(i=0;nut_data[i].info_type;i++)if(!(nut_data[i].apcupsd_item))
-		dstate_setinfo(nut_data[i].info_type,"%s",
-			nut_data[i].default_value);
-	else if(!strcmp(nut_data[i].apcupsd_item,item))
-			switch(nut_data[i].drv_flags&~DU_FLAG_INIT)
+	switch(nut_data[i].drv_flags&~DU_FLAG_INIT)
 	{
 	case DU_FLAG_STATUS:
 		status_init();
@@ -140,6 +160,7 @@ static void process(char *item,char *data)
 			else dstate_setinfo(nut_data[i].info_type,"%s",p1+1);
 			*p1=' ';
 		}
+		else ret=0;
 		break;
 
 	case DU_FLAG_FW1:
@@ -163,7 +184,9 @@ static void process(char *item,char *data)
 			for(;*p1;p1++)if(p1[1]!=' ')break;
 			if(*p1&&p1[1])dstate_setinfo(nut_data[i].info_type,"%s",
 				p1+1);
+			else ret=0;
 		}
+		else ret=0;
 		break;
 
 	default:if(nut_data[i].info_flags&ST_FLAG_STRING)
@@ -181,127 +204,217 @@ static void process(char *item,char *data)
 		}
 		break;
 	}
+
+	return ret;
 }
 
-static int getdata(void)
+static void process(char *item,char *data)
 {
-	ssize_t x;
-	uint16_t n;
-	char *item;
-	char *data;
-	struct pollfd p;
-	char bfr[1024];
-	st_tree_timespec_t start;
-	int ret = -1;
+	int i;
+	char tmp[1024];
+
+	for(i=0;nut_data[i].info_type;i++)
+	{
+		if(!(nut_data[i].apcupsd_item)||strcmp(nut_data[i].apcupsd_item,item))
+			continue;
+
+		nis_last[i].present=1;
+
+		/* Same raw value as last time: the NUT variable is already
+		 * up to date (or was not set from it) */
+		if(nis_last[i].raw&&!strcmp(nis_last[i].raw,data))
+			continue;
+
+		free(nis_last[i].raw);
+		nis_last[i].raw=xstrdup(data);
+
+		/* process_entry() may modify it, and other entries can use
+		 * the same apcupsd item */
+		snprintf(tmp,sizeof(tmp),"%s",data);
+		if(process_entry(i,tmp))nis_last[i].set=1;
+		else if(nis_last[i].set)
+		{
+			nis_last[i].set=0;
+			if(!(nut_data[i].drv_flags & (DU_FLAG_INIT|DU_FLAG_PRESERVE)))
+				dstate_delinfo(nut_data[i].info_type);
+		}
+	}
+}
+
+static void nis_close(void)
+{
+	if (VALID_FD_SOCK(nis_fd)) {
+		close(nis_fd);
+		nis_fd = ERROR_FD_SOCK;
+	}
+#ifdef WIN32
+	if (nis_event != NULL) {
+		CloseHandle(nis_event);
+		nis_event = NULL;
+	}
+#endif	/* WIN32 */
+}
+
+/* Make sure there is a session with apcupsd, trying each address of the
+ * host in turn; after failures, wait progressively longer between tries */
+static int nis_open(void)
+{
+	struct addrinfo	*ai;
+	time_t	now;
 #ifndef WIN32
 	int fd_flags;
-#else	/* WIN32 */
-	/* Note: while the code below uses "pollfd" for simplicity as it is
-	 * available in mingw headers (although poll() method usually is not),
-	 * WIN32 builds use WaitForMultipleObjects(); see also similar code
-	 * in upsd.c for networking.
-	 */
-	HANDLE event = NULL;
-#endif	/* WIN32 */
+#endif	/* !WIN32 */
 
-	state_get_timestamp((st_tree_timespec_t *)&start);
+	if (VALID_FD_SOCK(nis_fd))
+		return 0;
 
-	if (INVALID_FD_SOCK( (p.fd = socket(host->ai_family, SOCK_STREAM, 0)) ))
-	{
-		upsdebugx(1,"socket error");
-		/* return -1; */
-		ret = -1;
-		goto getdata_return;
+	time(&now);
+	if (now < nis_retry_at) {
+		upsdebugx(1, "%s: not trying to reconnect to apcupsd for %" PRIiMAX " more sec",
+			__func__, (intmax_t)(nis_retry_at - now));
+		return -1;
 	}
 
-	if (connect(p.fd, host->ai_addr, host->ai_addrlen))
-	{
-		upsdebugx(1,"can't connect to apcupsd");
-		/* close(p.fd);
-		return -1; */
-		ret = -1;
-		goto getdata_return;
+	for (ai = host; ai; ai = ai->ai_next) {
+		if (INVALID_FD_SOCK( (nis_fd = socket(ai->ai_family, SOCK_STREAM, 0)) ))
+		{
+			upsdebugx(1,"socket error");
+			continue;
+		}
+
+		if (!connect(nis_fd, ai->ai_addr, ai->ai_addrlen))
+			break;
+
+		upsdebugx(1, "can't connect to apcupsd at %s", NUT_STRARG(inet_ntopAI(ai)));
+		nis_close();
+	}
+
+	if (INVALID_FD_SOCK(nis_fd)) {
+		nis_retry_at = now + nis_backoff;
+		nis_backoff = (nis_backoff ? nis_backoff * 2 : poll_interval);
+		if (nis_backoff > NIS_BACKOFF_MAX)
+			nis_backoff = NIS_BACKOFF_MAX;
+		return -1;
 	}
 
+	nis_retry_at = 0;
+	nis_backoff = 0;
+
 #ifndef WIN32
-	/* WSAEventSelect automatically sets the socket to nonblocking mode */
-	fd_flags = fcntl(p.fd, F_GETFL);
+	fd_flags = fcntl(nis_fd, F_GETFL);
 	if (fd_flags == -1) {
 		upsdebugx(1,"unexpected fcntl(fd, F_GETFL) failure");
-		/* close(p.fd);
-		return -1; */
-		ret = -1;
-		goto getdata_return;
+		nis_close();
+		return -1;
 	}
 	fd_flags |= O_NONBLOCK;
-	if(fcntl(p.fd, F_SETFL, fd_flags) == -1)
+	if(fcntl(nis_fd, F_SETFL, fd_flags) == -1)
 	{
 		upsdebugx(1,"unexpected fcntl(fd, F_SETFL, fd_flags|O_NONBLOCK) failure");
-		/* close(p.fd);
-		return -1; */
-		ret = -1;
-		goto getdata_return;
+		nis_close();
+		return -1;
 	}
 #else	/* WIN32 */
-	event = CreateEvent(
+	/* Note: while the code below uses "pollfd" for simplicity as it is
+	 * available in mingw headers (although poll() method usually is not),
+	 * WIN32 builds use WaitForMultipleObjects(); see also similar code
+	 * in upsd.c for networking.
+	 */
+	nis_event = CreateEvent(
 		NULL,  /* Security */
 		FALSE, /* auto-reset */
 		FALSE, /* initial state */
 		NULL); /* no name */
 
-	/* Associate socket event to the socket via its Event object */
-	WSAEventSelect( p.fd, event, FD_CONNECT );
+	/* Associate socket event to the socket via its Event object;
+	 * WSAEventSelect automatically sets the socket to nonblocking mode */
+	WSAEventSelect( nis_fd, nis_event, FD_READ | FD_CLOSE );
 #endif	/* WIN32 */
 
-	p.events=POLLIN;
+	upsdebugx(2, "%s: connected to apcupsd", __func__);
+	return 0;
+}
 
-	n=htons(6);
-	x=write(p.fd,(void*)&n,2);
-	x=write(p.fd,"status",6);
+/* Read exactly len bytes from apcupsd, waiting up to 15 sec for each part */
+static int nis_read(void *buf, size_t len)
+{
+	char	*p = buf;
+	ssize_t	x;
+#ifndef WIN32
+	struct pollfd	pfd;
 
-	/* TODO: double-check for poll() in configure script */
+	pfd.fd = nis_fd;
+	pfd.events = POLLIN;
+#endif	/* !WIN32 */
+
+	while (len > 0) {
+		/* TODO: double-check for poll() in configure script */
 #ifndef WIN32
-	while(poll(&p,1,15000)==1)
+		if (poll(&pfd, 1, 15000) != 1)
 #else	/* WIN32 */
-	while (WaitForMultipleObjects(1, &event, FALSE, 15000) == WAIT_TIMEOUT)
+		if (WaitForMultipleObjects(1, &nis_event, FALSE, 15000) != WAIT_OBJECT_0)
 #endif	/* WIN32 */
+			return -1;
+
+		if ((x = read(nis_fd, p, len)) <= 0)
+			return -1;
+
+		p += x;
+		len -= (size_t)x;
+	}
+
+	return 0;
+}
+
+/* Request the status over the current session and process the reply,
+ * which ends with an empty record. *records counts the ones received,
+ * so a session closed by apcupsd meanwhile can be told apart. */
+static int nis_status(int *records)
+{
+	size_t x;
+	uint16_t n;
+	char *item;
+	char *data;
+	char bfr[1024];
+	char req[8];
+
+	*records = 0;
+
+	n=htons(6);
+	memcpy(req, &n, 2);
+	memcpy(req + 2, "status", 6);
+	if(write(nis_fd,req,sizeof(req))!=(ssize_t)sizeof(req))
 	{
-		if(read(p.fd,(void*)&n,2)!=2)
+		upsdebugx(1,"apcupsd communication error");
+		return -1;
+	}
+
+	for(;;)
+	{
+		if(nis_read(&n,2))
 		{
-			upsdebugx(1,"apcupsd communication error");
-			ret = -1;
-			goto getdata_return;
+			if (*records)
+				upsdebugx(1,"apcupsd communication error");
+			else
+				upsdebugx(1,"unexpected connection close by apcupsd");
+			return -1;
 		}
 
 		if(!(x=ntohs(n)))
-		{
-			ret = 0;
-			goto getdata_return;
-		}
-		else if(x<0||x>=(int)sizeof(bfr))
-		/* Note: LGTM.com suggests "Comparison is always false because x >= 0"
-		 * for the line above, probably because ntohs() returns an uint type.
-		 * I am reluctant to fix this one, because googling for headers from
-		 * random OSes showed various types used as the return value (uint16_t,
-		 * unsigned_short, u_short, in_port_t...)
-		 */
+			return 0;
+
+		(*records)++;
+
+		if(x>=sizeof(bfr))
 		{
 			upsdebugx(1,"apcupsd communication error");
-			ret = -1;
-			goto getdata_return;
+			return -1;
 		}
 
-#ifndef WIN32
-		if(poll(&p,1,15000)!=1)break;
-#else	/* WIN32 */
-		if (WaitForMultipleObjects(1, &event, FALSE, 15000) != WAIT_OBJECT_0) break;
-#endif	/* WIN32 */
-
-		if(read(p.fd,bfr,(size_t)x)!=x)
+		if(nis_read(bfr,x))
 		{
 			upsdebugx(1,"apcupsd communication error");
-			ret = -1;
-			goto getdata_return;
+			return -1;
 		}
 
 		bfr[x]=0;
@@ -309,45 +422,73 @@ static int getdata(void)
 		if(!(item=strtok(bfr," \t:\r\n")))
 		{
 			upsdebugx(1,"apcupsd communication error");
-			ret = -1;
-			goto getdata_return;
+			return -1;
 		}
 
 		if(!(data=strtok(NULL,"\r\n")))
 		{
 			upsdebugx(1,"apcupsd communication error");
-			ret = -1;
-			goto getdata_return;
+			return -1;
 		}
 		while(*data==' '||*data=='\t'||*data==':')data++;
 
 		process(item,data);
 	}
+}
 
-	upsdebugx(1,"unexpected connection close by apcupsd");
-	ret = -1;
+static int getdata(void)
+{
+	int i, reused, records;
+	int ret = -1;
 
-getdata_return:
-	if (VALID_FD_SOCK(p.fd))
-		close(p.fd);
-#ifdef WIN32
-	if (event != NULL)
-		CloseHandle(event);
-#endif	/* WIN32 */
+	for(i=0;nut_data[i].info_type;i++)
+		nis_last[i].present=0;
+
+	reused = VALID_FD_SOCK(nis_fd);
+	if (!nis_open())
+	{
+		ret = nis_status(&records);
+
+		/* apcupsd may have dropped a session which was idle between
+		 * polls: retry at once over a fresh one */
+		if (ret && reused && !records)
+		{
+			upsdebugx(1, "apcupsd session lost, reconnecting");
+			nis_close();
+			if (!nis_open())
+				ret = nis_status(&records);
+		}
+	}
+
+	if (ret || nis_oneshot)
+		nis_close();
 
 	/* Remove any unprotected entries not refreshed in this run */
-	for(x=0;nut_data[x].info_type;x++)
-		if(!(nut_data[x].drv_flags & DU_FLAG_INIT) && !(nut_data[x].drv_flags & DU_FLAG_PRESERVE))
-			dstate_delinfo_olderthan(nut_data[x].info_type, &start);
+	for(i=0;nut_data[i].info_type;i++)
+		if(!nis_last[i].present && !(nut_data[i].drv_flags & (DU_FLAG_INIT|DU_FLAG_PRESERVE)))
+		{
+			if(nis_last[i].set)
+				dstate_delinfo(nut_data[i].info_type);
+			free(nis_last[i].raw);
+			nis_last[i].raw=NULL;
+			nis_last[i].set=0;
+		}
 
 	return ret;
 }
 
 void upsdrv_initinfo(void)
 {
+	int i;
+
 	if (!port || !host)
 		fatalx(EXIT_FAILURE,"invalid host or port specified!");
 
+	/* Entries not provided by apcupsd */
+	for(i=0;nut_data[i].info_type;i++)if(!(nut_data[i].apcupsd_item))
+		dstate_setinfo(nut_data[i].info_type,"%s",
+			nut_data[i].default_value);
+
 	if (getdata())
 		fatalx(EXIT_FAILURE,"can't communicate with apcupsd!");
 	else dstate_dataok();
@@ -387,6 +528,7 @@ void upsdrv_tweak_prognames(void)
 
 void upsdrv_makevartable(void)
 {
+	addvar(VAR_FLAG, "oneshot", "Connect to apcupsd anew for each poll");
 }
 
 void upsdrv_initups(void)
@@ -401,6 +543,8 @@ void upsdrv_initups(void)
 	atexit((void(*)(void))WSACleanup);
 #endif	/* WIN32 */
 
+	nis_oneshot = testvar("oneshot");
+
 	/* NOTE: in case of errors below we set "port" to 0,
 	 * and bail out with fatalx() in upsdrv_initinfo() */
 	if (device_path && *device_path)
@@ -468,13 +612,10 @@ void upsdrv_initups(void)
 
 	if (res)
 	{
-		/* TODO: loop, connect, retry?
-		 * See the more elaborate examples in NUT code (upsclient) or
-		 * https://man7.org/linux/man-pages/man3/getaddrinfo.3.html
-		 */
+		/* nis_open() tries them all in turn */
 		if (res->ai_next) {
-			upslogx(LOG_WARNING, "%s: Host %s does not map to a unique address; "
-				"we only tried the first hit", __func__, NUT_STRARG(namestart));
+			upsdebugx(1, "%s: Host %s does not map to a unique address; "
+				"will try them in turn", __func__, NUT_STRARG(namestart));
 		}
 	}
 
@@ -492,6 +633,15 @@ void upsdrv_initups(void)
 
 void upsdrv_cleanup(void)
 {
+	size_t	i;
+
+	nis_close();
+
+	for (i = 0; i < SIZEOF_ARRAY(nis_last); i++) {
+		free(nis_last[i].raw);
+		nis_last[i].raw = NULL;
+	}
+
 	if (host)
 		freeaddrinfo(host);
 }
@@ -66,6 +66,37 @@
 	double			previous_battery_charge_value = -1.0;
 	st_tree_timespec_t	previous_battery_charge_timestamp;
 
+	/* driver.stats.* accounting */
+	static nut_latency_t	stats_update, stats_io;
+	static uint64_t	stats_update_overruns = 0, stats_io_failed = 0,
+				stats_io_timeouts = 0, stats_stale = 0;
+	static time_t	stats_published = 0;
+	static time_t	stats_interval = 0;	/* delay before the next update */
+
+	/* descriptors the driver asked dstate_poll_fds() to watch */
+	typedef struct {
+		TYPE_FD	fd;
+		void	(*handler)(void *arg);
+		void	*arg;
+	} dstate_watch_t;
+	static dstate_watch_t	*watch_list = NULL;
+	static size_t	watch_count = 0, watch_allocs = 0;
+
+	/* set while dstate_wait_fd() answers clients from within a driver
+	 * exchange with the device: requests which may call back into the
+	 * driver are kept for the main loop instead */
+	static int	nested_service = 0;
+	/* set while the main loop handles client requests, which must not
+	 * be re-entered by dstate_wait_fd() from a driver handler */
+	static int	serving_clients = 0;
+	typedef struct deferred_cmd_s {
+		conn_t	*conn;
+		size_t	numarg;
+		char	**arg;
+		struct deferred_cmd_s	*next;
+	} deferred_cmd_t;
+	static deferred_cmd_t	*deferred_head = NULL, *deferred_tail = NULL;
+
 #ifndef WIN32
 /* this may be a frequent stumbling point for new users, so be verbose here */
 static void sock_fail(const char *fn)
@@ -232,8 +263,51 @@ static TYPE_FD sock_open(const char *fn)
 	return fd;
 }
 
+static void deferred_free(deferred_cmd_t *d)
+{
+	size_t	i;
+
+	for (i = 0; i < d->numarg; i++) {
+		free(d->arg[i]);
+	}
+
+	free(d->arg);
+	free(d);
+}
+
+/* forget requests held for a connection which is going away */
+static void deferred_drop_conn(const conn_t *conn)
+{
+	deferred_cmd_t	*d, *dnext, *dprev = NULL;
+
+	for (d = deferred_head; d; d = dnext) {
+		dnext = d->next;
+
+		if (d->conn != conn) {
+			dprev = d;
+			continue;
+		}
+
+		if (dprev) {
+			dprev->next = dnext;
+		} else {
+			deferred_head = dnext;
+		}
+
+		if (deferred_tail == d) {
+			deferred_tail = dprev;
+		}
+
+		deferred_free(d);
+	}
+
+	serving_clients = 0;
+}
+
 static void sock_disconnect(conn_t *conn)
 {
+	deferred_drop_conn(conn);
+
 #ifndef WIN32
 	upsdebugx(3, "%s: disconnecting socket %d", __func__, (int)conn->fd);
 	close(conn->fd);
@@ -635,7 +709,7 @@ static int st_tree_dump_conn_one_node(st_tree_t *node, conn_t *conn)
 	enum_t	*etmp;
 	range_t	*rtmp;
 
-	if (!send_to_one(conn, "SETINFO %s \"%s\"\n", node->var, node->val)) {
+	if (!send_to_one(conn, "SETINFO %s \"%s\"\n", node->var, st_tree_node_getval(node))) {
 		return 0;	/* write failed, bail out */
 	}
 
@@ -730,6 +804,31 @@ static void send_tracking(conn_t *conn, const char *id, int value)
 	send_to_one(conn, "TRACKING %s %i\n", id, value);
 }
 
+/* keep a copy of a request to be handled by the main loop */
+static void sock_defer(conn_t *conn, size_t numarg, char **arg)
+{
+	deferred_cmd_t	*d = xcalloc(1, sizeof(*d));
+	size_t	i;
+
+	d->conn = conn;
+	d->numarg = numarg;
+	d->arg = xcalloc(numarg, sizeof(*d->arg));
+
+	for (i = 0; i < numarg; i++) {
+		d->arg[i] = xstrdup(arg[i]);
+	}
+
+	if (deferred_tail) {
+		deferred_tail->next = d;
+	} else {
+		deferred_head = d;
+	}
+	deferred_tail = d;
+
+	upsdebugx(3, "%s: %s will be handled after the current exchange with the device",
+		__func__, arg[0]);
+}
+
 static int sock_arg(conn_t *conn, size_t numarg, char **arg)
 {
 #ifdef WIN32
@@ -743,6 +842,19 @@ static int sock_arg(conn_t *conn, size_t numarg, char **arg)
 		return 0;
 	}
 
+	/* Only answer from the data tree while the driver is busy talking
+	 * to the device; anything else may need the driver (and device) */
+	if (nested_service
+	 && strcasecmp(arg[0], "DUMPALL")
+	 && strcasecmp(arg[0], "DUMPSTATUS")
+	 && strcasecmp(arg[0], "DUMPVALUE")
+	 && strcasecmp(arg[0], "PING")
+	 && strcasecmp(arg[0], "GETPID")
+	) {
+		sock_defer(conn, numarg, arg);
+		return 1;
+	}
+
 	if (!strcasecmp(arg[0], "LOGOUT")) {
 		send_to_one(conn, "OK Goodbye\n");
 #ifndef WIN32
@@ -976,9 +1088,31 @@ static int sock_arg(conn_t *conn, size_t numarg, char **arg)
 	return 0;
 }
 
+/* handle the requests which came in during dstate_wait_fd() */
+static void sock_run_deferred(void)
+{
+	serving_clients = 1;
+
+	while (deferred_head) {
+		deferred_cmd_t	*d = deferred_head;
+
+		deferred_head = d->next;
+		if (!deferred_head) {
+			deferred_tail = NULL;
+		}
+
+		if (!d->conn->closing && !sock_arg(d->conn, d->numarg, d->arg)) {
+			upslogx(LOG_INFO, "Unknown command on socket: %s", d->arg[0]);
+		}
+
+		deferred_free(d);
+	}
+}
+
 static void sock_read(conn_t *conn)
 {
-	ssize_t	ret, i;
+	ssize_t	ret;
+	size_t	i, used;
 	int	ret_arg = -1;
 
 #ifndef WIN32
@@ -1051,9 +1185,9 @@ static void sock_read(conn_t *conn)
 	}
 #endif	/* WIN32 */
 
-	for (i = 0; i < ret; i++) {
+	for (i = 0; ret > 0 && i < (size_t)ret; i += used) {
 
-		switch(pconf_char(&conn->ctx, buf[i]))
+		switch(pconf_buffer(&conn->ctx, buf + i, (size_t)ret - i, &used))
 		{
 		case 0: /* nothing to parse yet */
 			continue;
@@ -1070,7 +1204,7 @@ static void sock_read(conn_t *conn)
 				}
 			} else if (ret_arg == 2) {
 				/* closed by LOGOUT processing, conn is free()'d */
-				if (i < ret)
+				if (i + used < (size_t)ret)
 					upsdebugx(1, "%s: returning early, socket may be not valid anymore", __func__);
 				return;
 			}
@@ -1170,8 +1304,11 @@ int dstate_poll_fds(struct timeval timeout, TYPE_FD arg_extrafd)
 
 #ifndef WIN32
 	int	ret;
+	size_t	i;
 	fd_set	rfds;
 
+	sock_run_deferred();
+
 	FD_ZERO(&rfds);
 	FD_SET(sockfd, &rfds);
 
@@ -1193,6 +1330,14 @@ int dstate_poll_fds(struct timeval timeout, TYPE_FD arg_extrafd)
 		}
 	}
 
+	for (i = 0; i < watch_count; i++) {
+		FD_SET(watch_list[i].fd, &rfds);
+
+		if (watch_list[i].fd > maxfd) {
+			maxfd = watch_list[i].fd;
+		}
+	}
+
 	gettimeofday(&now, NULL);
 
 	/* number of microseconds should always be positive */
@@ -1231,6 +1376,8 @@ int dstate_poll_fds(struct timeval timeout, TYPE_FD arg_extrafd)
 		return overrun;
 	}
 
+	serving_clients = 1;
+
 	if (FD_ISSET(sockfd, &rfds)) {
 		sock_connect(sockfd);
 	}
@@ -1251,6 +1398,18 @@ int dstate_poll_fds(struct timeval timeout, TYPE_FD arg_extrafd)
 		}
 	}
 
+	/* walk backwards: a handler may unwatch its own descriptor */
+	for (i = watch_count; i > 0; i--) {
+		if (i <= watch_count && FD_ISSET(watch_list[i - 1].fd, &rfds)) {
+			dstate_watch_t	w = watch_list[i - 1];
+
+			FD_CLR(w.fd, &rfds);
+			w.handler(w.arg);
+		}
+	}
+
+	serving_clients = 0;
+
 	/* tell the caller if that fd woke up */
 	if (VALID_FD(arg_extrafd) && (FD_ISSET(arg_extrafd, &rfds))) {
 		return 1;
@@ -1262,6 +1421,8 @@ int dstate_poll_fds(struct timeval timeout, TYPE_FD arg_extrafd)
 	HANDLE	rfds[32];
 	DWORD	timeout_ms;
 
+	sock_run_deferred();
+
 	/* FIXME: Should such table (and limit) be used in reality? */
 	NUT_UNUSED_VARIABLE(arg_extrafd);
 /*
@@ -1351,6 +1512,145 @@ int dstate_poll_fds(struct timeval timeout, TYPE_FD arg_extrafd)
 	return overrun;
 }
 
+/* Wait up to d_sec + d_usec for fd (a device the driver talks to) to
+ * become readable, answering data requests from driver socket clients
+ * (upsd) meanwhile instead of leaving them hanging until the exchange
+ * is over. Returns like select() on fd: >0 when readable, 0 on timeout
+ * and <0 on error. */
+int dstate_wait_fd(TYPE_FD fd, time_t d_sec, suseconds_t d_usec)
+{
+#ifndef WIN32
+	struct timeval	deadline, now, tv;
+	fd_set	rfds;
+	conn_t	*conn, *cnext;
+	int	ret, maxfd;
+
+	gettimeofday(&deadline, NULL);
+	deadline.tv_sec += d_sec + d_usec / 1000000;
+	deadline.tv_usec += d_usec % 1000000;
+	if (deadline.tv_usec >= 1000000) {
+		deadline.tv_sec++;
+		deadline.tv_usec -= 1000000;
+	}
+
+	for (;;) {
+		FD_ZERO(&rfds);
+		FD_SET(fd, &rfds);
+		maxfd = fd;
+
+		/* not before dstate_init(), nor from within a client request */
+		if (VALID_FD(sockfd) && !nested_service && !serving_clients) {
+			FD_SET(sockfd, &rfds);
+			if (sockfd > maxfd) {
+				maxfd = sockfd;
+			}
+
+			for (conn = connhead; conn; conn = conn->next) {
+				FD_SET(conn->fd, &rfds);
+				if (conn->fd > maxfd) {
+					maxfd = conn->fd;
+				}
+			}
+		}
+
+		gettimeofday(&now, NULL);
+		tv.tv_sec = deadline.tv_sec - now.tv_sec;
+		tv.tv_usec = deadline.tv_usec - now.tv_usec;
+		if (tv.tv_usec < 0) {
+			tv.tv_sec--;
+			tv.tv_usec += 1000000;
+		}
+		if (tv.tv_sec < 0) {
+			tv.tv_sec = 0;
+			tv.tv_usec = 0;
+		}
+
+		ret = select(maxfd + 1, &rfds, NULL, NULL, &tv);
+
+		if (ret < 1) {
+			return ret;
+		}
+
+		if (FD_ISSET(fd, &rfds)) {
+			return ret;
+		}
+
+		nested_service = 1;
+
+		if (VALID_FD(sockfd) && FD_ISSET(sockfd, &rfds)) {
+			sock_connect(sockfd);
+		}
+
+		for (conn = connhead; conn; conn = cnext) {
+			cnext = conn->next;
+
+			if (FD_ISSET(conn->fd, &rfds)) {
+				sock_read(conn);
+			}
+		}
+
+		for (conn = connhead; conn; conn = cnext) {
+			cnext = conn->next;
+
+			if (conn->closing) {
+				sock_disconnect(conn);
+			}
+		}
+
+		nested_service = 0;
+	}
+#else	/* WIN32 */
+	/* FIXME: client pipes are overlapped I/O here, and serial reads
+	 * use their own timeouts; callers use select_read() directly */
+	NUT_UNUSED_VARIABLE(fd);
+	NUT_UNUSED_VARIABLE(d_sec);
+	NUT_UNUSED_VARIABLE(d_usec);
+	return -1;
+#endif	/* WIN32 */
+}
+
+/* have dstate_poll_fds() call handler(arg) whenever fd is readable,
+ * without returning to the main loop; used by drivers which proxy
+ * other drivers' sockets (one registration per descriptor) */
+void dstate_watch_fd(TYPE_FD fd, void (*handler)(void *arg), void *arg)
+{
+	if (INVALID_FD(fd) || !handler) {
+		return;
+	}
+
+#ifdef WIN32
+	/* FIXME: like extrafd, not waited upon with WaitForMultipleObjects()
+	 * yet; drivers must keep servicing these in upsdrv_updateinfo() */
+#endif	/* WIN32 */
+
+	dstate_unwatch_fd(fd);
+
+	if (watch_count >= watch_allocs) {
+		watch_allocs = watch_allocs ? watch_allocs * 2 : 8;
+		watch_list = xrealloc(watch_list, watch_allocs * sizeof(*watch_list));
+	}
+
+	watch_list[watch_count].fd = fd;
+	watch_list[watch_count].handler = handler;
+	watch_list[watch_count].arg = arg;
+	watch_count++;
+}
+
+void dstate_unwatch_fd(TYPE_FD fd)
+{
+	size_t	i;
+
+	for (i = 0; i < watch_count; i++) {
+		if (watch_list[i].fd == fd) {
+			/* keep the order, dstate_poll_fds() may be walking it */
+			memmove(&watch_list[i], &watch_list[i + 1],
+				(watch_count - i - 1) * sizeof(*watch_list));
+			watch_count--;
+			return;
+		}
+	}
+}
+
 /******************************************************************
  * COMMON
  ******************************************************************/
@@ -1756,6 +2056,10 @@ void dstate_free(void)
 	state_cmdfree(cmdhead);
 	cmdhead = NULL;
 
+	free(watch_list);
+	watch_list = NULL;
+	watch_count = watch_allocs = 0;
+
 	sock_close();
 }
 
@@ -1781,6 +2085,7 @@ void dstate_datastale(void)
 {
 	if (stale == 0) {
 		stale = 1;
+		stats_stale++;
 		send_to_all("DATASTALE\n");
 	}
 }
@@ -1790,6 +2095,89 @@ int dstate_is_stale(void)
 	return stale;
 }
 
+void dstate_stats_update(double elapsed, time_t interval)
+{
+	nut_latency_add(&stats_update, elapsed);
+	stats_interval = interval;
+
+	if (interval > 0 && elapsed > (double)interval) {
+		stats_update_overruns++;
+		upsdebugx(1, "%s: update cycle took %.3f sec, longer than the poll interval (%" PRIdMAX ")",
+			__func__, elapsed, (intmax_t)interval);
+	}
+}
+
+void dstate_stats_io(double elapsed, ssize_t result)
+{
+	nut_latency_add(&stats_io, elapsed);
+
+	if (result < 0) {
+		stats_io_failed++;
+	} else if (result == 0) {
+		stats_io_timeouts++;
+	}
+}
+
+/* percentage of "part" in "whole", capped at 100 */
+static uint64_t stats_percent(uint64_t part, uint64_t whole)
+{
+	if (!whole)
+		return 0;
+
+	if (part >= whole)
+		return 100;
+
+	return part * 100 / whole;
+}
+
+void dstate_stats_publish(int force)
+{
+	time_t	now;
+	uint64_t	interval_usec;
+
+	time(&now);
+
+	if (!force && stats_published
+	 && difftime(now, stats_published) < DSTATE_STATS_INTERVAL
+	) {
+		return;
+	}
+
+	stats_published = now;
+	interval_usec = (stats_interval > 0) ? (uint64_t)stats_interval * 1000000 : 0;
+
+	/* one upsdrv_updateinfo() cycle, in microseconds */
+	dstate_setinfo("driver.stats.update.count", "%" PRIu64, stats_update.count);
+	dstate_setinfo("driver.stats.update.min", "%" PRIu64, stats_update.usec_min);
+	dstate_setinfo("driver.stats.update.avg", "%" PRIu64, nut_latency_avg(&stats_update));
+	dstate_setinfo("driver.stats.update.max", "%" PRIu64, stats_update.usec_max);
+	dstate_setinfo("driver.stats.update.p99", "%" PRIu64, nut_latency_percentile(&stats_update, 99));
+	dstate_setinfo("driver.stats.update.overruns", "%" PRIu64, stats_update_overruns);
+
+	/* how much of the poll interval in use the updates take, in percent */
+	dstate_setinfo("driver.stats.update.load", "%" PRIu64,
+		stats_percent(nut_latency_avg(&stats_update), interval_usec));
+	dstate_setinfo("driver.stats.update.load.max", "%" PRIu64,
+		stats_percent(stats_update.usec_max, interval_usec));
+
+	/* bus transfers reported by the serial/USB/SNMP/Modbus helpers */
+	if (stats_io.count) {
+		dstate_setinfo("driver.stats.io.count", "%" PRIu64, stats_io.count);
+		dstate_setinfo("driver.stats.io.failed", "%" PRIu64, stats_io_failed);
+		dstate_setinfo("driver.stats.io.timeouts", "%" PRIu64, stats_io_timeouts);
+		dstate_setinfo("driver.stats.io.min", "%" PRIu64, stats_io.usec_min);
+		dstate_setinfo("driver.stats.io.avg", "%" PRIu64, nut_latency_avg(&stats_io));
+		dstate_setinfo("driver.stats.io.max", "%" PRIu64, stats_io.usec_max);
+		dstate_setinfo("driver.stats.io.p99", "%" PRIu64, nut_latency_percentile(&stats_io, 99));
+
+		/* share of the update cycles spent waiting for the device */
+		dstate_setinfo("driver.stats.io.share", "%" PRIu64,
+			stats_percent(stats_io.usec_total, stats_update.usec_total));
+	}
+
+	dstate_setinfo("driver.stats.stale", "%" PRIu64, stats_stale);
+}
+
 /* ups.status management functions - reducing duplication in the drivers */
 
 /* clean out the temp space for a new pass */
@@ -1864,7 +2252,7 @@ void status_commit(void)
 	while (ignorelb) {
 		const char	*val, *low;
 
-		val = dstate_battery_charge_entry ? dstate_battery_charge_entry->val : NULL;
+		val = st_tree_node_getval(dstate_battery_charge_entry);
 		low = dstate_getinfo("battery.charge.low");
 
 		if (val && low && (strtol(val, NULL, 10) < strtol(low, NULL, 10))) {
@@ -1886,11 +2274,11 @@ void status_commit(void)
 		break;
 	}
 
-	if (dstate_battery_charge_entry && dstate_battery_charge_entry->val) {
+	if (dstate_battery_charge_entry && st_tree_node_getval(dstate_battery_charge_entry)) {
 		double	current_battery_charge_value = -1.0;
 
 		if (previous_battery_charge_value >= 0.0
-		 && str_to_double(dstate_battery_charge_entry->val, &current_battery_charge_value, 10)
+		 && str_to_double(st_tree_node_getval(dstate_battery_charge_entry), &current_battery_charge_value, 10)
 		 && current_battery_charge_value >= 0
 		 && current_battery_charge_value < 100.0
 		 && (!(d_equal(previous_battery_charge_value, current_battery_charge_value)))
@@ -2346,7 +2734,7 @@ static int dstate_tree_dump(const st_tree_t *node)
 		}
 	}
 
-	printf("%s: %s\n", node->var, node->val);
+	printf("%s: %s\n", node->var, st_tree_node_getval(node));
 
 	if (node->right) {
 		return dstate_tree_dump(node->right);
@@ -63,6 +63,9 @@ typedef struct conn_s {
 /* close socket after read()ing zero bytes this many times in a row */
 #define DSTATE_CONN_READZERO_THROTTLE_MAX	5
 
+/* how often (seconds) to refresh the driver.stats.* data points */
+#define DSTATE_STATS_INTERVAL	60
+
 #include "main.h"	/* for set_exit_flag(); uses conn_t itself */
 
 	extern	struct	ups_handler	upsh;
@@ -77,6 +80,9 @@ typedef struct conn_s {
 
 char * dstate_init(const char *prog, const char *devname);
 int dstate_poll_fds(struct timeval timeout, TYPE_FD extrafd);
+void dstate_watch_fd(TYPE_FD fd, void (*handler)(void *arg), void *arg);
+void dstate_unwatch_fd(TYPE_FD fd);
+int dstate_wait_fd(TYPE_FD fd, time_t d_sec, suseconds_t d_usec);
 int vdstate_setinfo(const char *var, const char *fmt, va_list ap);
 int dstate_setinfo(const char *var, const char *fmt, ...)
 	__attribute__ ((__format__ (__printf__, 2, 3)));
@@ -109,6 +115,16 @@ void dstate_datastale(void);
 
 int dstate_is_stale(void);
 
+/* driver.stats.* accounting: the driver core times each update cycle
+ * against the delay before the next one (pollinterval, or the current
+ * adaptive delay), shared bus I/O helpers report each transfer with its
+ * outcome (negative = failed, zero = timed out, positive = done) */
+void dstate_stats_update(double elapsed, time_t interval);
+void dstate_stats_io(double elapsed, ssize_t result);
+/* publish the driver.stats.* tree, at most every DSTATE_STATS_INTERVAL
+ * seconds unless forced */
+void dstate_stats_publish(int force);
+
 /* clean out the temp space for a new pass */
 void status_init(void);
 
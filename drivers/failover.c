@@ -52,6 +52,12 @@ static int arg_check_runtime       = DEFAULT_CHECK_RUNTIME;
 static int init_time_elapsed;
 static int primaries_gone;
 
+/* something which matters to the primary election changed since it last
+ * ran, and when that was first noticed (for the switchover latency) */
+static int election_pending;
+static struct timeval election_pending_time;
+static nut_latency_t switchover_stats;
+
 static time_t drv_startup_time;
 static time_t primaries_gone_time;
 
@@ -71,6 +77,7 @@ static void handle_arguments(void);
 static void parse_port_argument(void);
 static void parse_status_filters(void);
 static void handle_connections(void);
+static void handle_election(void);
 static void export_driver_state(void);
 
 static void handle_no_primaries(void);
@@ -78,6 +85,7 @@ static int handle_init_time(const ups_device_t *primary_candidate);
 
 static int ups_connect(ups_device_t *ups);
 static int ups_read_data(ups_device_t *ups);
+static void ups_read_event(void *arg);
 static void ups_disconnect(ups_device_t *ups);
 static int ups_parse_protocol(ups_device_t *ups, size_t numargs, char **arg);
 
@@ -86,6 +94,7 @@ static void ups_is_alive(ups_device_t *ups);
 static void ups_is_dead(ups_device_t *ups);
 static void ups_is_online(ups_device_t *ups);
 static void ups_is_offline(ups_device_t *ups);
+static void ups_changed(void);
 
 static ups_device_t *get_primary_candidate(void);
 static int ups_passes_status_filters(const ups_device_t *ups);
@@ -99,13 +108,17 @@ static int ups_get_cmd_pos(const ups_device_t *ups, const char *cmd);
 static int ups_add_cmd(ups_device_t *ups, const char *val);
 static int ups_del_cmd(ups_device_t *ups, const char *val);
 
-static int ups_get_var_pos(const ups_device_t *ups, const char *key);
+static ups_var_t *ups_get_var(const ups_device_t *ups, const char *key);
+static void ups_var_hash_add(ups_device_t *ups, ups_var_t *var);
+static void ups_var_hash_del(ups_device_t *ups, const ups_var_t *var);
+static void ups_var_dirty(ups_device_t *ups, ups_var_t *var);
 static int ups_set_var(ups_device_t *ups, const char *key, const char *value);
 static int ups_del_var(ups_device_t *ups, const char *key);
 static int ups_set_var_flags(ups_device_t *ups, const char *key, const int flag);
 static int ups_set_var_aux(ups_device_t *ups, const char *key, const long aux);
 static int ups_add_range(ups_device_t *ups, const char *varkey, const int min, const int max);
 static int ups_del_range(ups_device_t *ups, const char *varkey, const int min, const int max);
+static char *ups_find_enum(const ups_var_t *var, const char *enumval);
 static int ups_add_enum(ups_device_t *ups, const char *varkey, const char *enumval);
 static int ups_del_enum(ups_device_t *ups, const char *varkey, const char *enumval);
 
@@ -174,9 +187,14 @@ void upsdrv_initinfo(void)
 
 void upsdrv_updateinfo(void)
 {
-	ups_device_t *primary_candidate = NULL;
-
 	handle_connections();
+	handle_election();
+	election_pending = 0;
+}
+
+static void handle_election(void)
+{
+	ups_device_t *primary_candidate = NULL;
 
 	primary_candidate = get_primary_candidate();
 
@@ -486,7 +504,7 @@ static int setvar(const char *varname, const char *val)
 		return STAT_SET_FAILED;
 	}
 
-	if(ups_get_var_pos(primary_ups, varname) >= 0) {
+	if(ups_get_var(primary_ups, varname)) {
 		const char *var = NULL;
 		char msgbuf[SMALLBUF];
 		struct timeval tv;
@@ -656,12 +674,15 @@ static void handle_connections(void)
 			continue;
 		}
 
-		if (ups_read_data(ups) < 0 ) {
+#ifdef WIN32
+		/* Elsewhere ups_read_event() is called as data arrives */
+		if (ups_read_data(ups) == -1) {
 			/* Socket failure... warrants immediate disconnect */
 			upslog_with_errno(LOG_ERR, "%s: [%s]: connection to UPS driver was lost (socket failure)",
 				__func__, ups->socketname);
 			ups_disconnect(ups);
 		}
+#endif	/* WIN32 */
 	}
 }
 
@@ -672,6 +693,13 @@ static void export_driver_state(void)
 	dstate_setinfo("driver.stats.primary_drivers", "%" PRIuSIZE, ups_primary_count);
 	dstate_setinfo("driver.stats.total_drivers", "%" PRIuSIZE, ups_count);
 
+	if (switchover_stats.count) {
+		dstate_setinfo("driver.stats.switchover.count", "%" PRIu64, switchover_stats.count);
+		dstate_setinfo("driver.stats.switchover.min", "%" PRIu64, switchover_stats.usec_min);
+		dstate_setinfo("driver.stats.switchover.avg", "%" PRIu64, nut_latency_avg(&switchover_stats));
+		dstate_setinfo("driver.stats.switchover.max", "%" PRIu64, switchover_stats.usec_max);
+	}
+
 	if (primary_ups) {
 		dstate_setinfo("driver.primary.socketname", "%s", primary_ups->socketname);
 		dstate_setinfo("driver.primary.priority", "%d", primary_ups->priority);
@@ -839,6 +867,7 @@ static int ups_connect(ups_device_t *ups)
 	if (conn) {
 		pconf_init(&ups->parse_ctx, NULL);
 		ups->conn = conn;
+		dstate_watch_fd(conn->sockfd, ups_read_event, ups);
 
 		upslogx(LOG_NOTICE, "%s: [%s]: connection is now established",
 			__func__, ups->socketname);
@@ -851,6 +880,7 @@ static int ups_connect(ups_device_t *ups)
 			ups->runtime_low = -1;
 
 			ups_is_alive(ups);
+			ups_changed();
 			time(&ups->last_heard_time);
 
 			ups->failure_count = 0;
@@ -890,13 +920,20 @@ static int ups_connect(ups_device_t *ups)
 	return ret;
 }
 
+/* Returns the amount of data read and parsed, 0 if the driver closed the
+ * connection, -1 on a read or parse error, -2 if there was nothing to read */
 static int ups_read_data(ups_device_t *ups)
 {
 	int	i = 0;
 	ssize_t	ret;
 	struct timeval tv;
 
+#ifndef WIN32
+	/* Only called for a readable socket */
+	tv.tv_sec = 0;
+#else	/* WIN32 */
 	tv.tv_sec = CONN_READ_TIMEOUT;
+#endif	/* WIN32 */
 	tv.tv_usec = 0;
 
 	ret = upsdrvquery_read_timeout(ups->conn, tv);
@@ -909,10 +946,11 @@ static int ups_read_data(ups_device_t *ups)
 	}
 
 	if (ret == -2) {
-		upsdebug_with_errno(2, "%s: [%s]: read from UPS driver has timed out",
+		/* Not a failure: is_ups_alive() pings quiet drivers */
+		upsdebugx(5, "%s: [%s]: nothing to read from UPS driver",
 			__func__, ups->socketname);
 
-		return ret;
+		return -2;
 	}
 
 	for (i = 0; i < ret; ++i) {
@@ -938,14 +976,40 @@ static int ups_read_data(ups_device_t *ups)
 	return ret;
 }
 
+/* Called by dstate_poll_fds() as soon as a UPS driver sent something,
+ * so that a failing primary is replaced without waiting for pollinterval */
+static void ups_read_event(void *arg)
+{
+	ups_device_t *ups = (ups_device_t *)arg;
+	int	ret = ups_read_data(ups);
+
+	/* End of file or a failure means the driver went away; a wakeup
+	 * with nothing to read (-2) is harmless */
+	if (ret == 0 || ret == -1) {
+		upslog_with_errno(LOG_ERR, "%s: [%s]: connection to UPS driver was lost (socket failure)",
+			__func__, ups->socketname);
+		ups_disconnect(ups);
+	}
+
+	if (election_pending && (init_time_elapsed || get_primary_candidate())) {
+		handle_election();
+		election_pending = 0;
+	}
+	else if (primary_ups == ups && ups->dirty_count) {
+		ups_export_dstate(ups);
+	}
+}
+
 static void ups_disconnect(ups_device_t *ups)
 {
 	ups_is_dead(ups);
+	ups_changed();
 	pconf_finish(&ups->parse_ctx);
 
 	ups->flags = UPS_FLAG_NONE;
 
 	if (ups->conn) {
+		dstate_unwatch_fd(ups->conn->sockfd);
 		upsdrvquery_close(ups->conn);
 		free(ups->conn);
 		ups->conn = NULL;
@@ -976,7 +1040,10 @@ static int ups_parse_protocol(ups_device_t *ups, size_t numargs, char **arg)
 		upsdebugx(6, "%s: [%s]: got DUMPDONE from UPS driver",
 			__func__, ups->socketname);
 
-		ups_set_flag(ups, UPS_FLAG_DUMPED);
+		if (!ups_has_flag(ups, UPS_FLAG_DUMPED)) {
+			ups_set_flag(ups, UPS_FLAG_DUMPED);
+			ups_changed();
+		}
 
 		return 1;
 	}
@@ -985,7 +1052,10 @@ static int ups_parse_protocol(ups_device_t *ups, size_t numargs, char **arg)
 		upsdebugx(6, "%s: [%s]: got DATASTALE from UPS driver",
 			__func__, ups->socketname);
 
-		ups_clear_flag(ups, UPS_FLAG_DATA_OK);
+		if (ups_has_flag(ups, UPS_FLAG_DATA_OK)) {
+			ups_clear_flag(ups, UPS_FLAG_DATA_OK);
+			ups_changed();
+		}
 
 		return 1;
 	}
@@ -994,7 +1064,10 @@ static int ups_parse_protocol(ups_device_t *ups, size_t numargs, char **arg)
 		upsdebugx(6, "%s: [%s]: got DATAOK from UPS driver",
 			__func__, ups->socketname);
 
-		ups_set_flag(ups, UPS_FLAG_DATA_OK);
+		if (!ups_has_flag(ups, UPS_FLAG_DATA_OK)) {
+			ups_set_flag(ups, UPS_FLAG_DATA_OK);
+			ups_changed();
+		}
 
 		return 1;
 	}
@@ -1137,8 +1210,13 @@ static int ups_parse_protocol(ups_device_t *ups, size_t numargs, char **arg)
 
 		if (!strcmp(arg[1], "ups.status")) {
 			if (ups->status) {
+				if (strcmp(ups->status, arg[2])) {
+					ups_changed();
+				}
 				free(ups->status);
 				ups->status = NULL;
+			} else {
+				ups_changed();
 			}
 			ups->status = xstrdup(arg[2]);
 
@@ -1149,6 +1227,7 @@ static int ups_parse_protocol(ups_device_t *ups, size_t numargs, char **arg)
 			}
 		}
 
+		/* Runtimes only break ties, re-check when the election runs */
 		if (!strcmp(arg[1], "battery.runtime")) {
 			if (!str_to_int(arg[2], &ups->runtime, 10)) {
 				ups->runtime = -1;
@@ -1319,6 +1398,15 @@ static void ups_is_offline(ups_device_t *ups) {
 	}
 }
 
+/* Note a change which may alter the outcome of the primary election */
+static void ups_changed(void)
+{
+	if (!election_pending) {
+		election_pending = 1;
+		gettimeofday(&election_pending_time, NULL);
+	}
+}
+
 static ups_device_t *get_primary_candidate(void)
 {
 	time_t now;
@@ -1545,6 +1633,16 @@ static void ups_promote_primary(ups_device_t *ups)
 		return;
 	}
 
+	if (election_pending && (primary_ups || last_primary_ups)) {
+		struct timeval now;
+
+		gettimeofday(&now, NULL);
+		nut_latency_add(&switchover_stats, difftimeval(now, election_pending_time));
+
+		upsdebugx(2, "%s: [%s]: switchover took %.6fs since the triggering change",
+			__func__, ups->socketname, difftimeval(now, election_pending_time));
+	}
+
 	if (primary_ups) {
 		ups_demote_primary(primary_ups);
 	}
@@ -1580,6 +1678,8 @@ static void ups_demote_primary(ups_device_t *ups)
 static void ups_export_dstate(ups_device_t *ups)
 {
 	size_t i = 0;
+	size_t count = 0;
+	ups_var_t **vars = NULL;
 
 	if (ups->force_dstate_export) {
 		status_init();
@@ -1599,59 +1699,66 @@ static void ups_export_dstate(ups_device_t *ups)
 		}
 	}
 
-	for (i = 0; i < ups->var_count; ++i) {
-		ups_var_t *var = ups->var_list[i];
+	/* Only the variables which changed, unless everything is due */
+	if (ups->force_dstate_export) {
+		vars = ups->var_list;
+		count = ups->var_count;
+	} else {
+		vars = ups->dirty_list;
+		count = ups->dirty_count;
+	}
 
-		if (var->needs_export || ups->force_dstate_export) {
-			size_t j = 0;
+	for (i = 0; i < count; ++i) {
+		ups_var_t *var = vars[i];
+		const char *val = NULL;
+		size_t j = 0;
 
-			if (!strcmp(var->key, "ups.alarm")) {
-				alarm_init();
-				alarm_set(var->value);
-				alarm_commit();
-				status_commit(); /* publish ALARM */
-				upsdebugx(5, "%s: [%s]: exported UPS alarm to dstate: [%s] : [%s]",
-					__func__, ups->socketname, var->key, var->value);
-			}
-			else if (!strcmp(var->key, "ups.status")) {
-				status_init();
-				status_set(var->value);
-				status_commit();
-				upsdebugx(5, "%s: [%s]: exported UPS status to dstate: [%s] : [%s]",
-					__func__, ups->socketname, var->key, var->value);
-			}
-			else {
-				dstate_setinfo(var->key, "%s", var->value);
-				upsdebugx(5, "%s: [%s]: exported variable to dstate: [%s] : [%s]",
-					__func__, ups->socketname, var->key, var->value);
-			}
-
-			if (var->flags) {
-				dstate_setflags(var->key, var->flags);
-				upsdebugx(5, "%s: [%s]: exported variable flags to dstate: [%s] : [%d]",
-					__func__, ups->socketname, var->key, var->flags);
-			}
+		if (!strcmp(var->key, "ups.alarm")) {
+			alarm_init();
+			alarm_set(var->value);
+			alarm_commit();
+			status_commit(); /* publish ALARM */
+			upsdebugx(5, "%s: [%s]: exported UPS alarm to dstate: [%s] : [%s]",
+				__func__, ups->socketname, var->key, var->value);
+		}
+		else if (!strcmp(var->key, "ups.status")) {
+			status_init();
+			status_set(var->value);
+			status_commit();
+			upsdebugx(5, "%s: [%s]: exported UPS status to dstate: [%s] : [%s]",
+				__func__, ups->socketname, var->key, var->value);
+		}
+		else {
+			dstate_setinfo(var->key, "%s", var->value);
+			upsdebugx(5, "%s: [%s]: exported variable to dstate: [%s] : [%s]",
+				__func__, ups->socketname, var->key, var->value);
+		}
 
-			if (var->aux) {
-				dstate_setaux(var->key, var->aux);
-				upsdebugx(5, "%s: [%s]: exported variable aux to dstate: [%s] : [%ld]",
-					__func__, ups->socketname, var->key, var->aux);
-			}
+		if (var->flags) {
+			dstate_setflags(var->key, var->flags);
+			upsdebugx(5, "%s: [%s]: exported variable flags to dstate: [%s] : [%d]",
+				__func__, ups->socketname, var->key, var->flags);
+		}
 
-			for (j = 0; j < var->enum_count; ++j) {
-				dstate_addenum(var->key, "%s", var->enum_list[j]);
-				upsdebugx(5, "%s: [%s]: exported variable enum to dstate: [%s] : [%s]",
-					__func__, ups->socketname, var->key, var->enum_list[j]);
-			}
+		if (var->aux) {
+			dstate_setaux(var->key, var->aux);
+			upsdebugx(5, "%s: [%s]: exported variable aux to dstate: [%s] : [%ld]",
+				__func__, ups->socketname, var->key, var->aux);
+		}
 
-			for (j = 0; j < var->range_count; ++j) {
-				dstate_addrange(var->key, var->range_list[j]->min, var->range_list[j]->max);
-				upsdebugx(5, "%s: [%s]: exported variable range to dstate: [%s] : min=[%d] : max=[%d]",
-					__func__, ups->socketname, var->key, var->range_list[j]->min, var->range_list[j]->max);
-			}
+		for (j = 0, val = var->enum_buf; j < var->enum_count; ++j, val += strlen(val) + 1) {
+			dstate_addenum(var->key, "%s", val);
+			upsdebugx(5, "%s: [%s]: exported variable enum to dstate: [%s] : [%s]",
+				__func__, ups->socketname, var->key, val);
+		}
 
-			var->needs_export = 0;
+		for (j = 0; j < var->range_count; ++j) {
+			dstate_addrange(var->key, var->range_list[j].min, var->range_list[j].max);
+			upsdebugx(5, "%s: [%s]: exported variable range to dstate: [%s] : min=[%d] : max=[%d]",
+				__func__, ups->socketname, var->key, var->range_list[j].min, var->range_list[j].max);
 		}
+
+		var->needs_export = 0;
 	}
 
 	if (ups->force_dstate_export) {
@@ -1659,6 +1766,8 @@ static void ups_export_dstate(ups_device_t *ups)
 		status_commit();
 	}
 
+	ups->dirty_count = 0;
+
 	ups->force_dstate_export = 0;
 }
 
@@ -1772,31 +1881,89 @@ static int ups_del_cmd(ups_device_t *ups, const char *val)
 	return 0;
 }
 
-static int ups_get_var_pos(const ups_device_t *ups, const char *key)
+static ups_var_t *ups_get_var(const ups_device_t *ups, const char *key)
 {
-	size_t i = 0;
+	ups_var_t *var = NULL;
 
-	for (i = 0; i < ups->var_count; ++i) {
-		if (!strcmp(ups->var_list[i]->key, key)) {
-			return i;
+	if (!ups->var_hash_size) {
+		return NULL;
+	}
+
+	for (var = ups->var_hash[nut_strhash(key, 0) & (ups->var_hash_size - 1)]; var; var = var->hnext) {
+		if (!strcmp(var->key, key)) {
+			return var;
 		}
 	}
 
-	return -1;
+	return NULL;
+}
+
+static void ups_var_hash_add(ups_device_t *ups, ups_var_t *var)
+{
+	size_t slot = 0;
+
+	if (ups->var_count > ups->var_hash_size) {
+		size_t i = 0;
+		size_t size = ups->var_hash_size ? ups->var_hash_size * 2 : VAR_HASH_MIN_SIZE;
+
+		/* rebuild from var_list, which already holds the new variable */
+		free(ups->var_hash);
+		ups->var_hash = xcalloc(size, sizeof(*ups->var_hash));
+		ups->var_hash_size = size;
+
+		for (i = 0; i < ups->var_count; ++i) {
+			slot = nut_strhash(ups->var_list[i]->key, 0) & (size - 1);
+			ups->var_list[i]->hnext = ups->var_hash[slot];
+			ups->var_hash[slot] = ups->var_list[i];
+		}
+
+		return;
+	}
+
+	slot = nut_strhash(var->key, 0) & (ups->var_hash_size - 1);
+	var->hnext = ups->var_hash[slot];
+	ups->var_hash[slot] = var;
+}
+
+static void ups_var_hash_del(ups_device_t *ups, const ups_var_t *var)
+{
+	ups_var_t **pvar = &ups->var_hash[nut_strhash(var->key, 0) & (ups->var_hash_size - 1)];
+
+	for (; *pvar; pvar = &(*pvar)->hnext) {
+		if (*pvar == var) {
+			*pvar = var->hnext;
+			return;
+		}
+	}
+}
+
+static void ups_var_dirty(ups_device_t *ups, ups_var_t *var)
+{
+	if (var->needs_export) {
+		return; /* already queued */
+	}
+
+	if (ups->dirty_count >= ups->dirty_allocs) {
+		ups->dirty_list = xrealloc(ups->dirty_list, sizeof(*ups->dirty_list) * (ups->dirty_allocs + VAR_ALLOC_BATCH));
+		ups->dirty_allocs = ups->dirty_allocs + VAR_ALLOC_BATCH;
+	}
+
+	ups->dirty_list[ups->dirty_count] = var;
+	ups->dirty_count++;
+
+	var->needs_export = 1;
 }
 
 static int ups_set_var(ups_device_t *ups, const char *key, const char *value)
 {
 	ups_var_t *new_var = NULL;
-	int var_pos = ups_get_var_pos(ups, key);
-
-	if (var_pos >= 0) {
-		ups_var_t *var = ups->var_list[var_pos];
+	ups_var_t *var = ups_get_var(ups, key);
 
+	if (var) {
 		if (strcmp(var->value, value)) {
 			free(var->value);
 			var->value = xstrdup(value);
-			var->needs_export = 1;
+			ups_var_dirty(ups, var);
 
 			upsdebugx(5, "%s: [%s]: updated in ups->var_list: [%s] : [%s]",
 				__func__, ups->socketname, key, value);
@@ -1819,11 +1986,14 @@ static int ups_set_var(ups_device_t *ups, const char *key, const char *value)
 	new_var = xcalloc(1, sizeof(**ups->var_list));
 	new_var->key = xstrdup(key);
 	new_var->value = xstrdup(value);
-	new_var->needs_export = 1;
+	new_var->pos = ups->var_count;
 
 	ups->var_list[ups->var_count] = new_var;
 	ups->var_count++;
 
+	ups_var_hash_add(ups, new_var);
+	ups_var_dirty(ups, new_var);
+
 	upsdebugx(5, "%s: [%s]: stored in ups->var_list: [%s] : [%s]",
 		__func__, ups->socketname, key, value);
 
@@ -1832,10 +2002,9 @@ static int ups_set_var(ups_device_t *ups, const char *key, const char *value)
 
 static int ups_del_var(ups_device_t *ups, const char *key)
 {
-	int var_pos = ups_get_var_pos(ups, key);
+	ups_var_t *var = ups_get_var(ups, key);
 
-	if (var_pos >= 0) {
-		ups_var_t *var = ups->var_list[var_pos];
+	if (var) {
 		size_t i = 0;
 
 		if (primary_ups == ups) {
@@ -1861,16 +2030,27 @@ static int ups_del_var(ups_device_t *ups, const char *key)
 				__func__, ups->socketname, key);
 		}
 
-		ups_free_var_state(var);
-		free(var);
-
-		for (i = var_pos; i < ups->var_count - 1; ++i) {
-			ups->var_list[i] = ups->var_list[i + 1];
+		if (var->needs_export) {
+			for (i = 0; i < ups->dirty_count; ++i) {
+				if (ups->dirty_list[i] == var) {
+					ups->dirty_list[i] = ups->dirty_list[ups->dirty_count - 1];
+					ups->dirty_count--;
+					break;
+				}
+			}
 		}
 
+		ups_var_hash_del(ups, var);
+
+		/* the last variable takes the freed slot */
+		ups->var_list[var->pos] = ups->var_list[ups->var_count - 1];
+		ups->var_list[var->pos]->pos = var->pos;
 		ups->var_list[ups->var_count - 1] = NULL;
 		ups->var_count--;
 
+		ups_free_var_state(var);
+		free(var);
+
 		if (ups->var_count == 0) {
 			free(ups->var_list);
 			ups->var_list = NULL;
@@ -1895,11 +2075,9 @@ static int ups_del_var(ups_device_t *ups, const char *key)
 
 static int ups_set_var_flags(ups_device_t *ups, const char *key, const int flags)
 {
-	int var_pos = ups_get_var_pos(ups, key);
-
-	if (var_pos >= 0) {
-		ups_var_t *var = ups->var_list[var_pos];
+	ups_var_t *var = ups_get_var(ups, key);
 
+	if (var) {
 		if (var->flags == flags) {
 			upsdebugx(6, "%s: [%s]: unchanged flags in ups->var_list: [%s] : [%d]",
 				__func__, ups->socketname, key, flags);
@@ -1908,7 +2086,7 @@ static int ups_set_var_flags(ups_device_t *ups, const char *key, const int flags
 		}
 
 		var->flags = flags;
-		var->needs_export = 1;
+		ups_var_dirty(ups, var);
 
 		upsdebugx(5, "%s: [%s]: stored flags in ups->var_list: [%s] : [%d]",
 			__func__, ups->socketname, key, flags);
@@ -1924,11 +2102,9 @@ static int ups_set_var_flags(ups_device_t *ups, const char *key, const int flags
 
 static int ups_set_var_aux(ups_device_t *ups, const char *key, const long aux)
 {
-	int var_pos = ups_get_var_pos(ups, key);
-
-	if (var_pos >= 0) {
-		ups_var_t *var = ups->var_list[var_pos];
+	ups_var_t *var = ups_get_var(ups, key);
 
+	if (var) {
 		if (var->aux == aux) {
 			upsdebugx(6, "%s: [%s]: unchanged aux in ups->var_list: [%s] : [%ld]",
 				__func__, ups->socketname, key, aux);
@@ -1937,7 +2113,7 @@ static int ups_set_var_aux(ups_device_t *ups, const char *key, const long aux)
 		}
 
 		var->aux = aux;
-		var->needs_export = 1;
+		ups_var_dirty(ups, var);
 
 		upsdebugx(5, "%s: [%s]: stored aux in ups->var_list: [%s] : [%ld]",
 			__func__, ups->socketname, key, aux);
@@ -1953,15 +2129,13 @@ static int ups_set_var_aux(ups_device_t *ups, const char *key, const long aux)
 
 static int ups_add_range(ups_device_t *ups, const char *key, const int min, const int max)
 {
-	int var_pos = ups_get_var_pos(ups, key);
+	ups_var_t *var = ups_get_var(ups, key);
 
-	if (var_pos >= 0) {
-		var_range_t *new_range = NULL;
-		ups_var_t *var = ups->var_list[var_pos];
+	if (var) {
 		size_t i = 0;
 
 		for (i = 0; i < var->range_count; ++i) {
-			if (var->range_list[i]->min == min && var->range_list[i]->max == max) {
+			if (var->range_list[i].min == min && var->range_list[i].max == max) {
 				upsdebugx(6, "%s: [%s]: unchanged in ups->var_list->range_list: [%s] : min=[%d] : max=[%d]",
 					__func__, ups->socketname, key, min, max);
 
@@ -1971,17 +2145,13 @@ static int ups_add_range(ups_device_t *ups, const char *key, const int min, cons
 
 		if (var->range_count >= var->range_allocs) {
 			var->range_list = xrealloc(var->range_list, sizeof(*var->range_list) * (var->range_allocs + SUBVAR_ALLOC_BATCH));
-			memset(var->range_list + var->range_allocs, 0, sizeof(*var->range_list) * SUBVAR_ALLOC_BATCH);
 			var->range_allocs = var->range_allocs + SUBVAR_ALLOC_BATCH;
 		}
 
-		new_range = xcalloc(1, sizeof(**var->range_list));
-		new_range->min = min;
-		new_range->max = max;
-
-		var->range_list[var->range_count] = new_range;
+		var->range_list[var->range_count].min = min;
+		var->range_list[var->range_count].max = max;
 		var->range_count++;
-		var->needs_export = 1;
+		ups_var_dirty(ups, var);
 
 		upsdebugx(5, "%s: [%s]: added to ups->var_list->range_list: [%s] : min=[%d] : max=[%d]",
 			__func__, ups->socketname, key, min, max);
@@ -1997,16 +2167,13 @@ static int ups_add_range(ups_device_t *ups, const char *key, const int min, cons
 
 static int ups_del_range(ups_device_t *ups, const char *key, const int min, const int max)
 {
-	int var_pos = ups_get_var_pos(ups, key);
+	ups_var_t *var = ups_get_var(ups, key);
 
-	if (var_pos >= 0) {
-		ups_var_t *var = ups->var_list[var_pos];
+	if (var) {
 		size_t i = 0;
 
 		for (i = 0; i < var->range_count; ++i) {
-			if (var->range_list[i]->min == min && var->range_list[i]->max == max) {
-				size_t j = 0;
-
+			if (var->range_list[i].min == min && var->range_list[i].max == max) {
 				if (primary_ups == ups) {
 					dstate_delrange(key, min, max);
 
@@ -2014,13 +2181,8 @@ static int ups_del_range(ups_device_t *ups, const char *key, const int min, cons
 						__func__, ups->socketname, key, min, max);
 				}
 
-				free(var->range_list[i]);
-
-				for (j = i; j < var->range_count - 1; ++j) {
-					var->range_list[j] = var->range_list[j + 1];
-				}
-
-				var->range_list[var->range_count - 1] = NULL;
+				memmove(&var->range_list[i], &var->range_list[i + 1],
+					sizeof(*var->range_list) * (var->range_count - i - 1));
 				var->range_count--;
 
 				if (var->range_count == 0) {
@@ -2047,30 +2209,41 @@ static int ups_del_range(ups_device_t *ups, const char *key, const int min, cons
 	return 0;
 }
 
+static char *ups_find_enum(const ups_var_t *var, const char *val)
+{
+	char *p = var->enum_buf;
+	size_t i = 0;
+
+	for (i = 0; i < var->enum_count; ++i) {
+		if (!strcmp(p, val)) {
+			return p;
+		}
+		p += strlen(p) + 1;
+	}
+
+	return NULL;
+}
+
 static int ups_add_enum(ups_device_t *ups, const char *key, const char *val)
 {
-	int var_pos = ups_get_var_pos(ups, key);
+	ups_var_t *var = ups_get_var(ups, key);
 
-	if (var_pos >= 0) {
-		ups_var_t *var = ups->var_list[var_pos];
-		size_t i = 0;
+	if (var) {
+		size_t len = strlen(val) + 1;
 
-		for (i = 0; i < var->enum_count; ++i) {
-			if (!strcmp(var->enum_list[i], val)) {
-				return 0;
-			}
+		if (ups_find_enum(var, val)) {
+			return 0;
 		}
 
-		if (var->enum_count >= var->enum_allocs) {
-			var->enum_list = xrealloc(var->enum_list, sizeof(*var->enum_list) * (var->enum_allocs + SUBVAR_ALLOC_BATCH));
-			memset(var->enum_list + var->enum_allocs, 0, sizeof(*var->enum_list) * SUBVAR_ALLOC_BATCH);
-			var->enum_allocs = var->enum_allocs + SUBVAR_ALLOC_BATCH;
+		if (var->enum_buflen + len > var->enum_bufsize) {
+			var->enum_bufsize = (var->enum_buflen + len) * 2;
+			var->enum_buf = xrealloc(var->enum_buf, var->enum_bufsize);
 		}
 
-		var->enum_list[var->enum_count] = xstrdup(val);
-
+		memcpy(var->enum_buf + var->enum_buflen, val, len);
+		var->enum_buflen += len;
 		var->enum_count++;
-		var->needs_export = 1;
+		ups_var_dirty(ups, var);
 
 		upsdebugx(5, "%s: [%s]: added to ups->var_list->enum_list: [%s] : [%s]",
 			__func__, ups->socketname, key, val);
@@ -2086,48 +2259,37 @@ static int ups_add_enum(ups_device_t *ups, const char *key, const char *val)
 
 static int ups_del_enum(ups_device_t *ups, const char *key, const char *val)
 {
-	int var_pos = ups_get_var_pos(ups, key);
+	ups_var_t *var = ups_get_var(ups, key);
 
-	if (var_pos >= 0) {
-		ups_var_t *var = ups->var_list[var_pos];
-		size_t i = 0;
+	if (var) {
+		char *found = ups_find_enum(var, val);
 
-		for (i = 0; i < var->enum_count; ++i) {
-			if (!strcmp(var->enum_list[i], val)) {
-				size_t j = 0;
+		if (found) {
+			size_t len = strlen(found) + 1;
 
-				if (primary_ups == ups) {
-					dstate_delenum(key, val);
-
-					upsdebugx(5, "%s: [%s]: removed enum from dstate: [%s] : [%s]",
-						__func__, ups->socketname, key, val);
-				}
-
-				free(var->enum_list[i]);
-
-				for (j = i; j < var->enum_count - 1; ++j) {
-					var->enum_list[j] = var->enum_list[j + 1];
-				}
-
-				var->enum_list[var->enum_count - 1] = NULL;
-				var->enum_count--;
-
-				if (var->enum_count == 0) {
-					free(var->enum_list);
-					var->enum_list = NULL;
-					var->enum_allocs = 0;
-				}
-				else if (var->enum_count % SUBVAR_ALLOC_BATCH == 0) {
-					var->enum_list = xrealloc(var->enum_list, sizeof(*var->enum_list) * var->enum_count);
-					var->enum_allocs = var->enum_count;
-				}
+			if (primary_ups == ups) {
+				dstate_delenum(key, val);
 
-				upsdebugx(5, "%s: [%s]: deleted from ups->var_list->enum_list: [%s] : [%s]",
+				upsdebugx(5, "%s: [%s]: removed enum from dstate: [%s] : [%s]",
 					__func__, ups->socketname, key, val);
+			}
 
+			memmove(found, found + len,
+				var->enum_buflen - (size_t)(found - var->enum_buf) - len);
+			var->enum_buflen -= len;
+			var->enum_count--;
 
-				return 1;
+			if (var->enum_count == 0) {
+				free(var->enum_buf);
+				var->enum_buf = NULL;
+				var->enum_buflen = 0;
+				var->enum_bufsize = 0;
 			}
+
+			upsdebugx(5, "%s: [%s]: deleted from ups->var_list->enum_list: [%s] : [%s]",
+				__func__, ups->socketname, key, val);
+
+			return 1;
 		}
 	}
 
@@ -2201,6 +2363,19 @@ static void ups_free_ups_state(ups_device_t *ups)
 		ups->var_allocs = 0;
 	}
 
+	if (ups->var_hash) {
+		free(ups->var_hash);
+		ups->var_hash = NULL;
+		ups->var_hash_size = 0;
+	}
+
+	if (ups->dirty_list) {
+		free(ups->dirty_list);
+		ups->dirty_list = NULL;
+		ups->dirty_count = 0;
+		ups->dirty_allocs = 0;
+	}
+
 	if (ups->cmd_list) {
 		for (i = 0; i < ups->cmd_count; ++i) {
 			if (ups->cmd_list[i]) {
@@ -2227,8 +2402,6 @@ static void ups_free_ups_state(ups_device_t *ups)
 
 static void ups_free_var_state(ups_var_t *var)
 {
-	size_t i = 0;
-
 	if (var->key) {
 		free(var->key);
 		var->key = NULL;
@@ -2239,26 +2412,15 @@ static void ups_free_var_state(ups_var_t *var)
 		var->value = NULL;
 	}
 
-	if (var->enum_list) {
-		for (i = 0; i < var->enum_count; ++i) {
-			if (var->enum_list[i]) {
-				free(var->enum_list[i]);
-				var->enum_list[i] = NULL;
-			}
-		}
-		free(var->enum_list);
-		var->enum_list = NULL;
+	if (var->enum_buf) {
+		free(var->enum_buf);
+		var->enum_buf = NULL;
 		var->enum_count = 0;
-		var->enum_allocs = 0;
+		var->enum_buflen = 0;
+		var->enum_bufsize = 0;
 	}
 
 	if (var->range_list) {
-		for (i = 0; i < var->range_count; ++i) {
-			if (var->range_list[i]) {
-				free(var->range_list[i]);
-				var->range_list[i] = NULL;
-			}
-		}
 		free(var->range_list);
 		var->range_list = NULL;
 		var->range_count = 0;
@@ -28,6 +28,7 @@
 #include "upsdrvquery.h"
 
 #define VAR_ALLOC_BATCH      50
+#define VAR_HASH_MIN_SIZE    64
 #define SUBVAR_ALLOC_BATCH   10
 #define CMD_ALLOC_BATCH      20
 #define CONN_READ_TIMEOUT     3
@@ -67,15 +68,16 @@ typedef struct {
 	int max;
 } var_range_t;
 
-typedef struct {
+typedef struct ups_var_s {
 	char *key;
 	char *value;
 
-	char **enum_list;
-	var_range_t **range_list;
+	char *enum_buf;	/* enum values, each NUL-terminated, back to back */
+	var_range_t *range_list;
 
 	size_t enum_count;
-	size_t enum_allocs;
+	size_t enum_buflen;
+	size_t enum_bufsize;
 	size_t range_count;
 	size_t range_allocs;
 
@@ -83,6 +85,9 @@ typedef struct {
 
 	int flags;
 	int needs_export;
+
+	size_t pos;	/* index in var_list */
+	struct ups_var_s *hnext;	/* var_hash chain */
 } ups_var_t;
 
 typedef struct {
@@ -112,11 +117,16 @@ typedef struct {
 
 	ups_var_t **var_list;
 	ups_cmd_t **cmd_list;
+	ups_var_t **dirty_list;	/* variables with needs_export set */
+	ups_var_t **var_hash;	/* var_list by key */
 
 	size_t var_count;
 	size_t var_allocs;
 	size_t cmd_count;
 	size_t cmd_allocs;
+	size_t dirty_count;
+	size_t dirty_allocs;
+	size_t var_hash_size;
 
 	char *status;
 
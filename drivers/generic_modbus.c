@@ -413,11 +413,14 @@ void upsdrv_cleanup(void)
 int register_read(modbus_t *mb, int addr, regtype_t type, void *data)
 {
 	int rval = -1;
+	struct timeval start, stop;
 
 	/* register bit masks */
 	uint16_t mask8 = 0x000F;
 	uint16_t mask16 = 0x00FF;
 
+	gettimeofday(&start, NULL);
+
 	switch (type) {
 		case COIL:
 			rval = modbus_read_bits(mb, addr, 1, (uint8_t *)data);
@@ -465,6 +468,11 @@ int register_read(modbus_t *mb, int addr, regtype_t type, void *data)
 # pragma GCC diagnostic pop
 #endif
 	}
+
+	gettimeofday(&stop, NULL);
+	dstate_stats_io(difftimeval(stop, start),
+		(rval != -1) ? 1 : (errno == ETIMEDOUT) ? 0 : -1);
+
 	if (rval == -1) {
 		upslogx(LOG_ERR, "ERROR:(%s) modbus_read: addr:0x%x, type:%8s, path:%s",
 			modbus_strerror(errno),
@@ -563,33 +563,28 @@ HIDData_t *FindObject_with_ID_Node(HIDDesc_t *pDesc_arg, uint8_t ReportID, HIDNo
 }
 
 /*
- * GetValue
- * Extract data from a report stored in Buf.
- * Use Offset, Size, LogMin, and LogMax of pData.
- * Return response in *pValue.
+ * PrepareValue
+ * Compute the decode plan of pData: where its bits sit in the report,
+ * and the mask and sign bit implied by LogMin and LogMax. This is done
+ * once per item, so GetValue() does not re-derive it on every read.
  * -------------------------------------------------------------------------- */
-void GetValue(const unsigned char *Buf, HIDData_t *pData, long *pValue)
+static void PrepareValue(HIDData_t *pData)
 {
-	/* Note:  https://github.com/networkupstools/nut/issues/1023
-	   This conversion code can easily be sensitive to 32- vs. 64- bit
-	   compilation environments.  Consider the possibility of overflow
-	   in 32-bit representations when computing with extreme values,
-	   for example LogMax-LogMin+1.
-	   Test carefully in both environments if changing any declarations.
-	*/
+	unsigned int	Bit, Span;
+	unsigned long	signbit, magMax, magMin;
 
-	int	Weight, Bit;
-	unsigned long mask, signbit, magMax, magMin;
-	long	value = 0;
+	Bit = (unsigned int)pData->Offset + 8;	/* First byte of report is report ID */
+	Span = (Bit & 7) + pData->Size;
 
-	Bit = pData->Offset + 8;	/* First byte of report is report ID */
-
-	for (Weight = 0; Weight < pData->Size; Weight++, Bit++) {
-		int	State = Buf[Bit >> 3] & (1 << (Bit & 7));
+	pData->plan_byte = (uint8_t)(Bit >> 3);
+	pData->plan_shift = (uint8_t)(Bit & 7);
 
-		if(State) {
-			value += (1L << Weight);
-		}
+	/* Data which does not fit in an unsigned long once shifted (none
+	 * seen in practice) is still extracted bit by bit */
+	if (pData->Size > 0 && Span <= sizeof(unsigned long) * 8) {
+		pData->plan_bytes = (uint8_t)((Span + 7) >> 3);
+	} else {
+		pData->plan_bytes = 0;
 	}
 
 	/* translate Value into a signed/unsigned value in the range
@@ -622,14 +617,71 @@ void GetValue(const unsigned char *Buf, HIDData_t *pData, long *pValue)
 	signbit = 1L << hibit(magMax > magMin ? magMax : magMin);
 
 	/* but only include sign bit in mask if negative numbers are involved */
-	mask = (signbit - 1) | ((pData->LogMin < 0) ? signbit : 0);
+	pData->plan_mask = (signbit - 1) | ((pData->LogMin < 0) ? signbit : 0);
+	pData->plan_signbit = (pData->LogMin < 0) ? signbit : 0;
+
+	pData->have_plan = true;
+}
+
+/*
+ * GetValue
+ * Extract data from a report stored in Buf.
+ * Use Offset, Size, LogMin, and LogMax of pData (via its decode plan).
+ * Return response in *pValue.
+ * -------------------------------------------------------------------------- */
+void GetValue(const unsigned char *Buf, HIDData_t *pData, long *pValue)
+{
+	/* Note:  https://github.com/networkupstools/nut/issues/1023
+	   This conversion code can easily be sensitive to 32- vs. 64- bit
+	   compilation environments.  Consider the possibility of overflow
+	   in 32-bit representations when computing with extreme values,
+	   for example LogMax-LogMin+1.
+	   Test carefully in both environments if changing any declarations.
+	*/
+
+	long	value = 0;
+
+	if (!pData->have_plan) {
+		PrepareValue(pData);
+	}
+
+	if (pData->plan_bytes) {
+		/* Assemble the bytes spanned by the data, then drop the
+		 * bits of neighbouring data on either side */
+		unsigned long	raw = 0;
+		const unsigned char	*p = Buf + pData->plan_byte;
+		int	i;
+
+		for (i = pData->plan_bytes - 1; i >= 0; i--) {
+			raw = (raw << 8) | p[i];
+		}
+
+		raw >>= pData->plan_shift;
+		if (pData->Size < sizeof(unsigned long) * 8) {
+			raw &= (1UL << pData->Size) - 1;
+		}
+
+		value = (long)raw;
+	} else {
+		int	Weight, Bit;
+
+		Bit = pData->Offset + 8;	/* First byte of report is report ID */
+
+		for (Weight = 0; Weight < pData->Size; Weight++, Bit++) {
+			int	State = Buf[Bit >> 3] & (1 << (Bit & 7));
+
+			if(State) {
+				value += (1L << Weight);
+			}
+		}
+	}
 
 	/* throw away excess high order bits (which may contain garbage) */
-	value = (long)((unsigned long)(value) & mask);
+	value = (long)((unsigned long)(value) & pData->plan_mask);
 
 	/* sign-extend it, if appropriate */
-	if (pData->LogMin < 0 && ((unsigned long)(value) & signbit) != 0) {
-		value |= ~mask;
+	if (((unsigned long)(value) & pData->plan_signbit) != 0) {
+		value |= ~pData->plan_mask;
 	}
 
 	/* clamp returned value to range [LogMin..LogMax] */
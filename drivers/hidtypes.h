@@ -318,6 +318,18 @@ typedef struct {
 	int8_t		have_PhyMax;			/* Physical Max defined?		*/
 
 	bool		mapping_handled;		/* Did any (sub)driver handling loop care about this report? If not, may be a point for improvement... */
+
+	/* Decode plan, derived from the fields above on first read (so
+	 * any report descriptor fix-ups must be applied before that) */
+	bool		have_plan;			/* plan_* fields below are valid	*/
+	uint8_t		plan_byte;			/* First report byte of the data	*/
+	uint8_t		plan_shift;			/* Bit position in that byte		*/
+	uint8_t		plan_bytes;			/* Bytes spanned, 0 = use bit loop	*/
+	unsigned long	plan_mask;			/* Significant bits of the value	*/
+	unsigned long	plan_signbit;			/* Sign bit, 0 if unsigned		*/
+
+	bool		have_scale;			/* plan_scale below is valid		*/
+	double		plan_scale;			/* Unit exponent as a factor		*/
 } HIDData_t;
 
 /*
@@ -63,6 +63,17 @@ static int string_to_path(const char *string, HIDPath_t *path, usage_tables_t *u
 static int path_to_string(char *string, size_t size, const HIDPath_t *path, usage_tables_t *utab);
 static int8_t get_unit_expo(const HIDData_t *hiddata);
 static double exponent(double a, int8_t b);
+static double get_unit_scale(HIDData_t *hiddata);
+static size_t usage_code_hash(HIDNode_t code);
+static void usage_index(usage_tables_t *utab);
+
+/* Indexes of the usage tables looked up last (normally the subdriver's
+ * ones): by name, one per table, and by code, over all of them */
+static usage_tables_t	*usage_idx_utab = NULL;
+static nut_nameidx_t	*usage_idx_byname = NULL;
+static size_t	usage_idx_tables = 0;
+static const usage_lkp_t	**usage_idx_bycode = NULL;
+static size_t	usage_idx_size = 0;
 
 /* Tweak flag for APC Back-UPS */
 size_t max_report_size = 0;
@@ -533,13 +544,11 @@ int HIDGetDataValue(hid_dev_handle_t udev, HIDData_t *hiddata, double *Value, ti
 		return -errno;
 	}
 
-	*Value = hValue;
-
 	/* Convert Logical Min, Max and Value into Physical */
 	*Value = logical_to_physical(hiddata, hValue);
 
 	/* Process exponents and units */
-	*Value *= exponent(10, get_unit_expo(hiddata));
+	*Value *= get_unit_scale(hiddata);
 
 	return 1;
 }
@@ -664,7 +673,7 @@ int HIDSetDataValue(hid_dev_handle_t udev, HIDData_t *hiddata, double Value)
 	}
 
 	/* Process exponents and units */
-	Value /= exponent(10, get_unit_expo(hiddata));
+	Value /= get_unit_scale(hiddata);
 
 	/* Convert Physical Min, Max and Value into Logical */
 	hValue = physical_to_logical(hiddata, Value);
@@ -904,6 +913,18 @@ static int8_t get_unit_expo(const HIDData_t *hiddata)
 	return unit_expo;
 }
 
+/* return 10^(unit exponent) for the given item; it does not change
+ * once the descriptor was parsed, so only compute it on first use */
+static double get_unit_scale(HIDData_t *hiddata)
+{
+	if (!hiddata->have_scale) {
+		hiddata->plan_scale = exponent(10, get_unit_expo(hiddata));
+		hiddata->have_scale = true;
+	}
+
+	return hiddata->plan_scale;
+}
+
 /* exponent function: return a^b */
 static double exponent(double a, int8_t b)
 {
@@ -1021,24 +1042,80 @@ static int path_to_string(char *string, size_t size, const HIDPath_t *path, usag
 	return i;
 }
 
+/* codes of different pages tend to share their low bits: mix them in */
+static size_t usage_code_hash(HIDNode_t code)
+{
+	uint32_t	h = (uint32_t)code;
+
+	h ^= h >> 16;
+	h *= 0x45d9f3bU;
+	h ^= h >> 16;
+
+	return (size_t)h;
+}
+
+/* (re)build the indexes if utab is not the one indexed last */
+static void usage_index(usage_tables_t *utab)
+{
+	size_t	i, j, count = 0, slot;
+
+	if (utab == usage_idx_utab)
+		return;
+
+	for (i = 0; i < usage_idx_tables; i++)
+		nut_nameidx_free(&usage_idx_byname[i]);
+	free(usage_idx_byname);
+	free(usage_idx_bycode);
+
+	for (usage_idx_tables = 0; utab[usage_idx_tables] != NULL; usage_idx_tables++) {
+		for (j = 0; utab[usage_idx_tables][j].usage_name != NULL; j++)
+			count++;
+	}
+
+	/* name indexes get built on first use */
+	usage_idx_byname = xcalloc(usage_idx_tables ? usage_idx_tables : 1, sizeof(*usage_idx_byname));
+
+	for (usage_idx_size = 64; usage_idx_size < count * 2; usage_idx_size *= 2)
+		;
+	usage_idx_bycode = xcalloc(usage_idx_size, sizeof(*usage_idx_bycode));
+
+	/* the first table listing a code wins, as the tables are searched in order */
+	for (i = 0; i < usage_idx_tables; i++) {
+		for (j = 0; utab[i][j].usage_name != NULL; j++) {
+			HIDNode_t	code = utab[i][j].usage_code;
+
+			for (slot = usage_code_hash(code) & (usage_idx_size - 1);
+			     usage_idx_bycode[slot] && usage_idx_bycode[slot]->usage_code != code;
+			     slot = (slot + 1) & (usage_idx_size - 1)
+			) ;
+
+			if (!usage_idx_bycode[slot])
+				usage_idx_bycode[slot] = &utab[i][j];
+		}
+	}
+
+	usage_idx_utab = utab;
+}
+
 /* usage conversion string -> numeric
  * Returns -1 for error, or a (HIDNode_t) ranged code value
  */
 static long hid_lookup_usage(const char *name, usage_tables_t *utab)
 {
-	int i, j;
+	size_t	i;
+	usage_lkp_t	*lkp;
+
+	usage_index(utab);
 
-	for (i = 0; utab[i] != NULL; i++)
+	for (i = 0; i < usage_idx_tables; i++)
 	{
-		for (j = 0; utab[i][j].usage_name != NULL; j++)
-		{
-			if (strcasecmp(utab[i][j].usage_name, name))
-				continue;
+		lkp = NUT_NAMEIDX_FIND(&usage_idx_byname[i], utab[i], usage_lkp_t, usage_name, name);
+		if (!lkp)
+			continue;
 
-			/* Note: currently per hidtypes.h, HIDNode_t == uint32_t */
-			upsdebugx(5, "hid_lookup_usage: %s -> %08x", name, (uint32_t)utab[i][j].usage_code);
-			return (long)(utab[i][j].usage_code);
-		}
+		/* Note: currently per hidtypes.h, HIDNode_t == uint32_t */
+		upsdebugx(5, "hid_lookup_usage: %s -> %08x", name, (uint32_t)lkp->usage_code);
+		return (long)(lkp->usage_code);
 	}
 
 	upsdebugx(5, "hid_lookup_usage: %s -> not found in lookup table", name);
@@ -1048,18 +1125,19 @@ static long hid_lookup_usage(const char *name, usage_tables_t *utab)
 /* usage conversion numeric -> string */
 static const char *hid_lookup_path(const HIDNode_t usage, usage_tables_t *utab)
 {
-	int i, j;
+	size_t	slot;
 
-	for (i = 0; utab[i] != NULL; i++)
-	{
-		for (j = 0; utab[i][j].usage_name != NULL; j++)
-		{
-			if (utab[i][j].usage_code != usage)
-				continue;
+	usage_index(utab);
 
-			upsdebugx(5, "hid_lookup_path: %08x -> %s", (unsigned int)usage, utab[i][j].usage_name);
-			return utab[i][j].usage_name;
-		}
+	for (slot = usage_code_hash(usage) & (usage_idx_size - 1);
+	     usage_idx_bycode[slot];
+	     slot = (slot + 1) & (usage_idx_size - 1)
+	) {
+		if (usage_idx_bycode[slot]->usage_code != usage)
+			continue;
+
+		upsdebugx(5, "hid_lookup_path: %08x -> %s", (unsigned int)usage, usage_idx_bycode[slot]->usage_name);
+		return usage_idx_bycode[slot]->usage_name;
 	}
 
 	upsdebugx(5, "hid_lookup_path: %08x -> not found in lookup table", (unsigned int)usage);
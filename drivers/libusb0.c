@@ -100,6 +100,13 @@ void nut_usb_addvars(void)
 	addvar(VAR_VALUE, "usb_hid_ep_in",	"Deeper tuning of USB communications for complex devices");
 	addvar(VAR_VALUE, "usb_hid_ep_out",	"Deeper tuning of USB communications for complex devices");
 
+	/* Only implemented with libusb-1.0, tolerated here for the same
+	 * configuration to work with either build */
+	addvar(VAR_FLAG, "usb_no_hotplug", "Do not wait for USB hotplug events to re-scan the bus"
+		" (tolerated but ignored in this build)");
+	addvar(VAR_FLAG, "usb_no_enum_cache", "Do not share identities of USB devices seen on the bus with other drivers"
+		" (tolerated but ignored in this build)");
+
 	dstate_setinfo("driver.version.usb", "libusb-0.1 (or compat)");
 
 	upsdebugx(1, "Using USB implementation: %s", dstate_getinfo("driver.version.usb"));
@@ -842,6 +849,16 @@ static int nut_libusb_strerror(const int ret, const char *desc)
 	}
 }
 
+/* account one control transfer in driver.stats.io */
+static void nut_libusb_stats_io(struct timeval start, const int ret)
+{
+	struct timeval	stop;
+
+	gettimeofday(&stop, NULL);
+	dstate_stats_io(difftimeval(stop, start),
+		(ret == -ETIMEDOUT) ? 0 : (ret < 0 && ret != -EPIPE) ? -1 : 1);
+}
+
 /* return the report of ID=type in report
  * return -1 on failure, report length on success
  */
@@ -857,6 +874,7 @@ static int nut_libusb_get_report(
 	usb_ctrl_charbufsize ReportSize)
 {
 	int	ret;
+	struct timeval	start;
 
 	upsdebugx(4, "Entering nut_libusb_get_report");
 
@@ -864,12 +882,14 @@ static int nut_libusb_get_report(
 		return 0;
 	}
 
+	gettimeofday(&start, NULL);
 	ret = usb_control_msg(udev,
 		USB_ENDPOINT_IN + USB_TYPE_CLASS + USB_RECIP_INTERFACE,
 		0x01, /* HID_REPORT_GET */
 		ReportId+(0x03<<8), /* HID_REPORT_TYPE_FEATURE */
 		usb_subdriver.hid_rep_index,
 		raw_buf, ReportSize, USB_TIMEOUT);
+	nut_libusb_stats_io(start, ret);
 
 #ifdef WIN32
 	errno = -ret;
@@ -894,17 +914,20 @@ static int nut_libusb_set_report(
 	usb_ctrl_charbufsize ReportSize)
 {
 	int	ret;
+	struct timeval	start;
 
 	if (!udev) {
 		return 0;
 	}
 
+	gettimeofday(&start, NULL);
 	ret = usb_control_msg(udev,
 		USB_ENDPOINT_OUT + USB_TYPE_CLASS + USB_RECIP_INTERFACE,
 		0x09, /* HID_REPORT_SET = 0x09*/
 		ReportId+(0x03<<8), /* HID_REPORT_TYPE_FEATURE */
 		usb_subdriver.hid_rep_index,
 		raw_buf, ReportSize, USB_TIMEOUT);
+	nut_libusb_stats_io(start, ret);
 
 #ifdef WIN32
 	errno = -ret;
@@ -33,7 +33,7 @@
 #include "nut_stdint.h"
 
 #define USB_DRIVER_NAME		"USB communication driver (libusb 1.0)"
-#define USB_DRIVER_VERSION	"0.51"
+#define USB_DRIVER_VERSION	"0.52"
 
 /* driver description structure */
 upsdrv_info_t comm_upsdrv_info = {
@@ -48,6 +48,54 @@ upsdrv_info_t comm_upsdrv_info = {
 
 static void nut_libusb_close(libusb_device_handle *udev);
 
+/* Cache of identities (strings) of USB devices seen on the bus, shared
+ * by driver instances through a file in the state path, so that each
+ * of them does not have to open every device to match it */
+#define USB_ENUM_CACHE_FILE	"nut-usbenum.cache"
+
+static USBDevice_t	*usb_enum_cache = NULL;
+static size_t	usb_enum_count = 0;
+static int	usb_enum_cache_dirty = 0;
+static time_t	usb_enum_cache_mtime = 0;
+
+static void usb_enum_cache_load(void);
+static void usb_enum_cache_save(libusb_device **devlist, ssize_t devcount);
+static USBDevice_t *usb_enum_cache_find(const char *bus, const char *device,
+	const struct libusb_device_descriptor *dev_desc);
+static void usb_enum_cache_update(const USBDevice_t *curDevice);
+static void usb_enum_cache_forget(const char *bus, const char *device);
+static void usb_enum_cache_drop(size_t i);
+
+/* Hotplug notifications (if libusb supports them on this platform) let
+ * a driver which lost its device skip re-scanning the whole bus until
+ * something actually gets plugged in */
+#if (defined LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000102)
+# define NUT_LIBUSB_HOTPLUG 1
+
+/* Re-scan anyway after this many seconds, in case an event got lost */
+# define USB_HOTPLUG_RESCAN_INTERVAL	60
+
+static libusb_context	*hotplug_ctx = NULL;
+static libusb_hotplug_callback_handle	hotplug_handle;
+static int	hotplug_initialized = 0;
+static unsigned int	hotplug_arrivals = 0;
+static time_t	hotplug_last_poll = 0;
+
+static void usb_hotplug_init(void);
+static void usb_hotplug_cleanup(void);
+static int LIBUSB_CALL usb_hotplug_callback(libusb_context *ctx,
+	libusb_device *device, libusb_hotplug_event event, void *user_data);
+#endif	/* NUT_LIBUSB_HOTPLUG */
+
+/* Did the last bus scan find nothing to use (and was that not due to
+ * errors opening some device, e.g. permissions which may get fixed by
+ * udev shortly, or a device busy for a moment)? */
+static int	usb_last_scan_failed = 0;
+static time_t	usb_last_scan = 0;
+
+static int usb_skip_scan(void);
+static void usb_hotplug_poll(void);
+
 /*! Add USB-related driver variables with addvar() and dstate_setinfo().
  * This removes some code duplication across the USB drivers.
  */
@@ -93,6 +141,9 @@ void nut_usb_addvars(void)
 	addvar(VAR_VALUE, "usb_hid_ep_in",	"Deeper tuning of USB communications for complex devices");
 	addvar(VAR_VALUE, "usb_hid_ep_out",	"Deeper tuning of USB communications for complex devices");
 
+	addvar(VAR_FLAG, "usb_no_hotplug", "Do not wait for USB hotplug events to re-scan the bus when the device is lost");
+	addvar(VAR_FLAG, "usb_no_enum_cache", "Do not share identities of USB devices seen on the bus with other drivers");
+
 #ifdef LIBUSB_API_VERSION
 	dstate_setinfo("driver.version.usb", "libusb-%u.%u.%u (API: 0x%08X)", v->major, v->minor, v->micro, (unsigned int)LIBUSB_API_VERSION);
 #else  /* no LIBUSB_API_VERSION */
@@ -166,6 +217,418 @@ static void nut_libusb_subdriver_defaults(usb_communication_subdriver_t *subdriv
 		subdriver->hid_ep_out = LIBUSB_DEFAULT_HID_EP_OUT;
 }
 
+/* Helpers for the USB device identity cache */
+static int usb_enum_strcmp(const char *a, const char *b)
+{
+	if (!a || !b) {
+		return (a != b);
+	}
+
+	return strcmp(a, b);
+}
+
+static void usb_enum_free(USBDevice_t *dev)
+{
+	free(dev->Vendor);
+	free(dev->Product);
+	free(dev->Serial);
+	free(dev->Bus);
+	free(dev->Device);
+#if (defined WITH_USB_BUSPORT) && (WITH_USB_BUSPORT)
+	free(dev->BusPort);
+#endif
+	memset(dev, 0, sizeof(*dev));
+}
+
+static USBDevice_t *usb_enum_cache_find(const char *bus, const char *device,
+	const struct libusb_device_descriptor *dev_desc)
+{
+	size_t	i;
+
+	for (i = 0; i < usb_enum_count; i++) {
+		USBDevice_t	*dev = &usb_enum_cache[i];
+
+		if (strcmp(dev->Bus, bus) || strcmp(dev->Device, device)) {
+			continue;
+		}
+
+		/* Same address but another device: addresses are not
+		 * reused right away, but a stale entry must not be trusted */
+		if (dev->VendorID != dev_desc->idVendor
+		 || dev->ProductID != dev_desc->idProduct
+		 || dev->bcdDevice != dev_desc->bcdDevice
+		) {
+			return NULL;
+		}
+
+		return dev;
+	}
+
+	return NULL;
+}
+
+static void usb_enum_cache_drop(size_t i)
+{
+	usb_enum_free(&usb_enum_cache[i]);
+
+	usb_enum_count--;
+	if (i < usb_enum_count) {
+		usb_enum_cache[i] = usb_enum_cache[usb_enum_count];
+	}
+
+	usb_enum_cache_dirty = 1;
+}
+
+static void usb_enum_cache_forget(const char *bus, const char *device)
+{
+	size_t	i;
+
+	for (i = 0; i < usb_enum_count; i++) {
+		if (!strcmp(usb_enum_cache[i].Bus, bus) && !strcmp(usb_enum_cache[i].Device, device)) {
+			usb_enum_cache_drop(i);
+			return;
+		}
+	}
+}
+
+static void usb_enum_cache_update(const USBDevice_t *curDevice)
+{
+	USBDevice_t	*dev = NULL;
+	size_t	i;
+
+	if (!curDevice->Bus || !curDevice->Device) {
+		return;
+	}
+
+	for (i = 0; i < usb_enum_count; i++) {
+		if (!strcmp(usb_enum_cache[i].Bus, curDevice->Bus)
+		 && !strcmp(usb_enum_cache[i].Device, curDevice->Device)
+		) {
+			dev = &usb_enum_cache[i];
+			break;
+		}
+	}
+
+	if (dev) {
+		if (dev->VendorID == curDevice->VendorID
+		 && dev->ProductID == curDevice->ProductID
+		 && dev->bcdDevice == curDevice->bcdDevice
+		 && !usb_enum_strcmp(dev->Vendor, curDevice->Vendor)
+		 && !usb_enum_strcmp(dev->Product, curDevice->Product)
+		 && !usb_enum_strcmp(dev->Serial, curDevice->Serial)
+		) {
+			return;
+		}
+
+		usb_enum_free(dev);
+	} else {
+		usb_enum_cache = xrealloc(usb_enum_cache,
+			(usb_enum_count + 1) * sizeof(*usb_enum_cache));
+		dev = &usb_enum_cache[usb_enum_count++];
+		memset(dev, 0, sizeof(*dev));
+	}
+
+	dev->VendorID = curDevice->VendorID;
+	dev->ProductID = curDevice->ProductID;
+	dev->bcdDevice = curDevice->bcdDevice;
+	dev->Vendor = curDevice->Vendor ? xstrdup(curDevice->Vendor) : NULL;
+	dev->Product = curDevice->Product ? xstrdup(curDevice->Product) : NULL;
+	dev->Serial = curDevice->Serial ? xstrdup(curDevice->Serial) : NULL;
+	dev->Bus = xstrdup(curDevice->Bus);
+	dev->Device = xstrdup(curDevice->Device);
+#if (defined WITH_USB_BUSPORT) && (WITH_USB_BUSPORT)
+	dev->BusPort = curDevice->BusPort ? xstrdup(curDevice->BusPort) : NULL;
+#endif
+
+	usb_enum_cache_dirty = 1;
+}
+
+/* Merge the cache file written by other driver instances, if it changed.
+ * Lines are tab-separated: bus, device, busport, vendorid, productid,
+ * bcdDevice, vendor, product and serial (empty if not known). */
+static void usb_enum_cache_load(void)
+{
+	char	fn[NUT_PATH_MAX + 1], buf[LARGEBUF];
+	struct stat	st;
+	FILE	*f;
+	int	dirty = usb_enum_cache_dirty;
+
+	snprintf(fn, sizeof(fn), "%s/%s", dflt_statepath(), USB_ENUM_CACHE_FILE);
+
+	if (stat(fn, &st) != 0 || st.st_mtime == usb_enum_cache_mtime) {
+		return;
+	}
+
+	if ((f = fopen(fn, "r")) == NULL) {
+		upsdebug_with_errno(3, "%s: can't read %s", __func__, fn);
+		return;
+	}
+
+	usb_enum_cache_mtime = st.st_mtime;
+
+	while (fgets(buf, sizeof(buf), f)) {
+		char	*field[9], *p = buf;
+		size_t	n = 0;
+		unsigned int	vid, pid, bcd;
+		USBDevice_t	dev;
+
+		buf[strcspn(buf, "\r\n")] = '\0';
+
+		field[n++] = p;
+		while (n < 9 && (p = strchr(p, '\t')) != NULL) {
+			*p++ = '\0';
+			field[n++] = p;
+		}
+
+		if (n < 9 || !*field[0] || !*field[1]
+		 || sscanf(field[3], "%x", &vid) != 1
+		 || sscanf(field[4], "%x", &pid) != 1
+		 || sscanf(field[5], "%x", &bcd) != 1
+		) {
+			upsdebugx(3, "%s: skipping malformed line", __func__);
+			continue;
+		}
+
+		memset(&dev, 0, sizeof(dev));
+		dev.Bus = field[0];
+		dev.Device = field[1];
+#if (defined WITH_USB_BUSPORT) && (WITH_USB_BUSPORT)
+		dev.BusPort = *field[2] ? field[2] : NULL;
+#endif
+		dev.VendorID = (uint16_t)vid;
+		dev.ProductID = (uint16_t)pid;
+		dev.bcdDevice = (uint16_t)bcd;
+		dev.Vendor = *field[6] ? field[6] : NULL;
+		dev.Product = *field[7] ? field[7] : NULL;
+		dev.Serial = *field[8] ? field[8] : NULL;
+
+		usb_enum_cache_update(&dev);
+	}
+
+	fclose(f);
+
+	/* Only our own findings need to be written back */
+	usb_enum_cache_dirty = dirty;
+
+	upsdebugx(3, "%s: %" PRIuSIZE " cached USB device identities", __func__, usb_enum_count);
+}
+
+/* Forget devices which are no longer on the bus, and publish what we
+ * learned for other driver instances (via a rename, so they never see
+ * a partially written file) */
+static void usb_enum_cache_save(libusb_device **devlist, ssize_t devcount)
+{
+	char	fn[NUT_PATH_MAX + 1], tmpfn[NUT_PATH_MAX + 16];
+	struct stat	st;
+	size_t	i, devnum;
+	FILE	*f;
+
+	if (devcount < 0) {
+		/* Could not list the bus, so can not tell what is gone */
+		return;
+	}
+
+	for (i = 0; i < usb_enum_count; ) {
+		for (devnum = 0; (ssize_t)devnum < devcount; devnum++) {
+			char	bus[4], dev[4];
+
+			snprintf(bus, sizeof(bus), "%03d", libusb_get_bus_number(devlist[devnum]));
+			snprintf(dev, sizeof(dev), "%03d", libusb_get_device_address(devlist[devnum]));
+			if (!strcmp(usb_enum_cache[i].Bus, bus) && !strcmp(usb_enum_cache[i].Device, dev)) {
+				break;
+			}
+		}
+
+		if ((ssize_t)devnum < devcount) {
+			i++;
+		} else {
+			usb_enum_cache_drop(i);
+		}
+	}
+
+	if (!usb_enum_cache_dirty) {
+		return;
+	}
+
+	snprintf(fn, sizeof(fn), "%s/%s", dflt_statepath(), USB_ENUM_CACHE_FILE);
+	snprintf(tmpfn, sizeof(tmpfn), "%s.%ld", fn, (long)getpid());
+
+	if ((f = fopen(tmpfn, "w")) == NULL) {
+		upsdebug_with_errno(2, "%s: can't write %s", __func__, tmpfn);
+		return;
+	}
+
+	for (i = 0; i < usb_enum_count; i++) {
+		const USBDevice_t	*dev = &usb_enum_cache[i];
+
+		fprintf(f, "%s\t%s\t%s\t%04x\t%04x\t%04x\t%s\t%s\t%s\n",
+			dev->Bus, dev->Device,
+#if (defined WITH_USB_BUSPORT) && (WITH_USB_BUSPORT)
+			dev->BusPort ? dev->BusPort : "",
+#else
+			"",
+#endif
+			dev->VendorID, dev->ProductID, dev->bcdDevice,
+			dev->Vendor ? dev->Vendor : "",
+			dev->Product ? dev->Product : "",
+			dev->Serial ? dev->Serial : "");
+	}
+
+	if (fclose(f) != 0 || rename(tmpfn, fn) != 0) {
+		upsdebug_with_errno(2, "%s: can't update %s", __func__, fn);
+		unlink(tmpfn);
+		return;
+	}
+
+	/* No need to re-read what we just wrote */
+	if (stat(fn, &st) == 0) {
+		usb_enum_cache_mtime = st.st_mtime;
+	}
+
+	usb_enum_cache_dirty = 0;
+	upsdebugx(3, "%s: saved %" PRIuSIZE " USB device identities", __func__, usb_enum_count);
+}
+
+#ifdef NUT_LIBUSB_HOTPLUG
+static int LIBUSB_CALL usb_hotplug_callback(libusb_context *ctx,
+	libusb_device *device, libusb_hotplug_event event, void *user_data)
+{
+	char	bus[4], dev[4];
+
+	NUT_UNUSED_VARIABLE(ctx);
+	NUT_UNUSED_VARIABLE(user_data);
+
+	snprintf(bus, sizeof(bus), "%03d", libusb_get_bus_number(device));
+	snprintf(dev, sizeof(dev), "%03d", libusb_get_device_address(device));
+
+	if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED) {
+		upsdebugx(2, "%s: USB device arrived at %s:%s", __func__, bus, dev);
+		hotplug_arrivals++;
+	} else {
+		upsdebugx(2, "%s: USB device left %s:%s", __func__, bus, dev);
+	}
+
+	/* Whatever we knew about this address is stale now */
+	usb_enum_cache_forget(bus, dev);
+
+	/* Keep the callback registered */
+	return 0;
+}
+
+/* Watch for USB devices coming and going in a context of our own, so
+ * the handling of the device itself (and closing it) does not affect
+ * the subscription */
+static void usb_hotplug_init(void)
+{
+	int	ret;
+
+	if (hotplug_initialized) {
+		return;
+	}
+	hotplug_initialized = 1;
+
+	if (testvar("usb_no_hotplug")) {
+		upsdebugx(2, "%s: disabled by configuration", __func__);
+		return;
+	}
+
+	if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+		upsdebugx(2, "%s: not supported by libusb on this platform", __func__);
+		return;
+	}
+
+	if ((ret = libusb_init(&hotplug_ctx)) < 0) {
+		upsdebugx(1, "%s: failed to init libusb context: %s",
+			__func__, libusb_strerror((enum libusb_error)ret));
+		hotplug_ctx = NULL;
+		return;
+	}
+
+	ret = libusb_hotplug_register_callback(hotplug_ctx,
+		(libusb_hotplug_event)(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+		(libusb_hotplug_flag)0,
+		LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+		usb_hotplug_callback, NULL, &hotplug_handle);
+	if (ret != LIBUSB_SUCCESS) {
+		upsdebugx(1, "%s: failed to register for USB hotplug events: %s",
+			__func__, libusb_strerror((enum libusb_error)ret));
+		libusb_exit(hotplug_ctx);
+		hotplug_ctx = NULL;
+		return;
+	}
+
+	/* The subscription outlives nut_libusb_close() by design, so it
+	 * is only torn down when the driver exits */
+	atexit(usb_hotplug_cleanup);
+
+	upsdebugx(2, "%s: watching for USB hotplug events", __func__);
+}
+
+static void usb_hotplug_cleanup(void)
+{
+	if (!hotplug_ctx) {
+		return;
+	}
+
+	libusb_hotplug_deregister_callback(hotplug_ctx, hotplug_handle);
+	libusb_exit(hotplug_ctx);
+	hotplug_ctx = NULL;
+}
+#endif	/* NUT_LIBUSB_HOTPLUG */
+
+/* Deliver pending hotplug notifications to usb_hotplug_callback(), so
+ * they do not pile up in the libusb context while the device is in use;
+ * called from the data transfer methods, at most once a second */
+static void usb_hotplug_poll(void)
+{
+#ifdef NUT_LIBUSB_HOTPLUG
+	struct timeval	tv = { 0, 0 };
+	time_t	now;
+
+	if (!hotplug_ctx) {
+		return;
+	}
+
+	time(&now);
+	if (now == hotplug_last_poll) {
+		return;
+	}
+	hotplug_last_poll = now;
+
+	libusb_handle_events_timeout_completed(hotplug_ctx, &tv, NULL);
+#endif	/* NUT_LIBUSB_HOTPLUG */
+}
+
+/* Return 1 if the bus need not be scanned again: the previous scan
+ * found no matching device, and no device arrived since then */
+static int usb_skip_scan(void)
+{
+#ifdef NUT_LIBUSB_HOTPLUG
+	struct timeval	tv = { 0, 0 };
+	time_t	now;
+
+	if (!hotplug_ctx || !usb_last_scan_failed) {
+		return 0;
+	}
+
+	/* Deliver pending notifications to usb_hotplug_callback() */
+	libusb_handle_events_timeout_completed(hotplug_ctx, &tv, NULL);
+	hotplug_last_poll = time(NULL);
+	if (hotplug_arrivals > 0) {
+		return 0;
+	}
+
+	time(&now);
+	if (difftime(now, usb_last_scan) >= USB_HOTPLUG_RESCAN_INTERVAL) {
+		return 0;
+	}
+
+	return 1;
+#else	/* !NUT_LIBUSB_HOTPLUG */
+	return 0;
+#endif	/* !NUT_LIBUSB_HOTPLUG */
+}
+
 /* On success, fill in the curDevice structure and return the report
  * descriptor length. On failure, return -1.
  * Note: When callback is not NULL, the report descriptor will be
@@ -207,6 +670,10 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 	int count_open_EACCESS = 0;
 	int count_open_errors = 0;
 	int count_open_attempts = 0;
+	int count_matched = 0;
+	int use_enum_cache = !testvar("usb_no_enum_cache");
+	int strings_ok, pass;
+	char *cached_match = NULL;
 
 	/* report descriptor */
 	unsigned char	rdbuf[MAX_REPORT_SIZE];
@@ -282,6 +749,24 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 		usb_hid_number_opts_parsed = 1;
 	}
 
+	if (usb_skip_scan()) {
+		upsdebugx(2, "%s: no USB device arrived since the last scan, "
+			"not scanning the bus again yet", __func__);
+		*udevp = NULL;
+		return -1;
+	}
+
+#ifdef NUT_LIBUSB_HOTPLUG
+	/* Subscribe before scanning, so arrivals during the scan count */
+	usb_hotplug_init();
+	hotplug_arrivals = 0;
+#endif
+	time(&usb_last_scan);
+
+	if (use_enum_cache) {
+		usb_enum_cache_load();
+	}
+
 	/* libusb base init */
 	if (libusb_init(NULL) < 0) {
 		libusb_exit(NULL);
@@ -305,12 +790,57 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 
 	devcount = libusb_get_device_list(NULL, &devlist);
 
+	/* Devices whose identity cached by an earlier scan (ours or of
+	 * another driver) matches are tried first, so the one we want is
+	 * usually the only one opened. Everything else is still opened and
+	 * verified afterwards if none of those could be used, since the
+	 * cache may be incomplete or out of date. */
+	if (use_enum_cache && devcount > 0) {
+		cached_match = xcalloc((size_t)devcount, sizeof(*cached_match));
+
+		for (devnum = 0; (ssize_t)devnum < devcount; devnum++) {
+			libusb_device	*device = devlist[devnum];
+			char	bus_str[4], dev_str[4];
+			USBDevice_t	*cached;
+
+			if (libusb_get_device_address(device) == 0) {
+				continue;
+			}
+
+			libusb_get_device_descriptor(device, &dev_desc);
+			snprintf(bus_str, sizeof(bus_str), "%03d", libusb_get_bus_number(device));
+			snprintf(dev_str, sizeof(dev_str), "%03d", libusb_get_device_address(device));
+
+			if ((cached = usb_enum_cache_find(bus_str, dev_str, &dev_desc)) == NULL) {
+				continue;
+			}
+
+			for (m = matcher; m; m = m->next) {
+				if (matches(m, cached) != 1) {
+					break;
+				}
+			}
+
+			if (!m) {
+				upsdebugx(2, "Cached identity of device %s:%s matches - trying it first",
+					bus_str, dev_str);
+				cached_match[devnum] = 1;
+			}
+		}
+	}
+
 	/* devcount may be < 0, loop will get skipped;
 	 * its SSIZE_MAX < SIZE_MAX for devnum */
+	for (pass = (cached_match ? 0 : 1); pass < 2; pass++)
 	for (devnum = 0; (ssize_t)devnum < devcount; devnum++) {
 		/* int		if_claimed = 0; */
 		libusb_device	*device = devlist[devnum];
 
+		/* pass 0: cached matches; pass 1: all other devices */
+		if (cached_match && cached_match[devnum] != (pass == 0)) {
+			continue;
+		}
+
 		count_open_attempts++;
 		libusb_get_device_descriptor(device, &dev_desc);
 		upsdebugx(2, "Checking device %" PRIuSIZE " of %" PRIiSIZE " (%04X/%04X)",
@@ -407,6 +937,9 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 		curDevice->ProductID = dev_desc.idProduct;
 		curDevice->bcdDevice = dev_desc.bcdDevice;
 
+		/* only complete identities are worth caching */
+		strings_ok = 1;
+
 		if (dev_desc.iManufacturer) {
 			ret = nut_usb_get_string(udev, dev_desc.iManufacturer,
 				string, sizeof(string));
@@ -418,6 +951,7 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 				}
 			} else {
 				upsdebugx(1, "%s: get Manufacturer string failed", __func__);
+				strings_ok = 0;
 			}
 		}
 
@@ -432,6 +966,7 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 				}
 			} else {
 				upsdebugx(1, "%s: get Product string failed", __func__);
+				strings_ok = 0;
 			}
 		}
 
@@ -446,6 +981,7 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 				}
 			} else {
 				upsdebugx(1, "%s: get Serial Number string failed", __func__);
+				strings_ok = 0;
 			}
 		}
 
@@ -461,6 +997,22 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 		upsdebugx(2, "- Device: %s", curDevice->Device ? curDevice->Device : "unknown");
 		upsdebugx(2, "- Device release number: %04x", curDevice->bcdDevice);
 
+		/* A freshly read identity replaces whatever was cached for
+		 * this address, if it differs; it is recorded below if the
+		 * device is one of ours */
+		if (use_enum_cache && device_addr > 0 && strings_ok) {
+			USBDevice_t	*cached = usb_enum_cache_find(curDevice->Bus,
+				curDevice->Device, &dev_desc);
+
+			if (cached
+			 && (usb_enum_strcmp(cached->Vendor, curDevice->Vendor)
+			  || usb_enum_strcmp(cached->Product, curDevice->Product)
+			  || usb_enum_strcmp(cached->Serial, curDevice->Serial))
+			) {
+				usb_enum_cache_forget(curDevice->Bus, curDevice->Device);
+			}
+		}
+
 		/* FIXME: extend to Eaton OEMs (HP, IBM, ...) */
 		if ((curDevice->VendorID == 0x463) && (curDevice->bcdDevice == 0x0202)) {
 			if (!getval("usb_hid_desc_index"))
@@ -495,6 +1047,14 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 		/* If we got here, none of the matchers said
 		 * that the device is not what we want. */
 		upsdebugx(2, "Device matches");
+		count_matched++;
+
+		/* Only devices accepted by the matchers (which include the
+		 * VID/PID support lists of the drivers) are shared with other
+		 * driver instances, not every device plugged into the host */
+		if (use_enum_cache && device_addr > 0 && strings_ok) {
+			usb_enum_cache_update(curDevice);
+		}
 
 		upsdebugx(2, "Reading configuration descriptor %d of %d",
 			usb_subdriver.usb_config_index+1, dev_desc.bNumConfigurations);
@@ -613,7 +1173,12 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 		 */
 		if (!callback) {
 			libusb_free_config_descriptor(conf_desc);
+			if (use_enum_cache) {
+				usb_enum_cache_save(devlist, devcount);
+			}
 			libusb_free_device_list(devlist, 1);
+			free(cached_match);
+			usb_last_scan_failed = 0;
 			return 1;
 		}
 
@@ -825,7 +1390,12 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 			);
 
 		fflush(stdout);
+		if (use_enum_cache) {
+			usb_enum_cache_save(devlist, devcount);
+		}
 		libusb_free_device_list(devlist, 1);
+		free(cached_match);
+		usb_last_scan_failed = 0;
 
 		return rdlen;
 
@@ -841,7 +1411,17 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 
 	/* If we got here, we did not return a successfully chosen device above */
 	*udevp = NULL;
+	if (use_enum_cache) {
+		usb_enum_cache_save(devlist, devcount);
+	}
 	libusb_free_device_list(devlist, 1);
+	free(cached_match);
+
+	/* Until something gets plugged in, scanning again would find the
+	 * same; unless some device could not be opened and looked at (no
+	 * permission yet, busy, I/O errors...) so may still turn out to
+	 * be the one we want */
+	usb_last_scan_failed = (count_matched == 0 && count_open_errors == 0);
 	upsdebugx(2, "libusb1: No appropriate HID device found");
 	fflush(stdout);
 
@@ -939,6 +1519,17 @@ static int nut_libusb_strerror(const int ret, const char *desc)
 	}
 }
 
+/* account one control transfer in driver.stats.io */
+static void nut_libusb_stats_io(struct timeval start, const int ret)
+{
+	struct timeval	stop;
+
+	gettimeofday(&stop, NULL);
+	dstate_stats_io(difftimeval(stop, start),
+		(ret == LIBUSB_ERROR_TIMEOUT) ? 0
+		: (ret < 0 && ret != LIBUSB_ERROR_PIPE) ? -1 : 1);
+}
+
 /* return the report of ID=type in report
  * return -1 on failure, report length on success
  */
@@ -954,9 +1545,12 @@ static int nut_libusb_get_report(
 	usb_ctrl_charbufsize ReportSize)
 {
 	int	ret;
+	struct timeval	start;
 
 	upsdebugx(4, "Entering libusb_get_report");
 
+	usb_hotplug_poll();
+
 #if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && ( (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_TYPE_LIMITS) || (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_TAUTOLOGICAL_CONSTANT_OUT_OF_RANGE_COMPARE) || (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_TAUTOLOGICAL_UNSIGNED_ZERO_COMPARE) )
 # pragma GCC diagnostic push
 #endif
@@ -980,12 +1574,14 @@ static int nut_libusb_get_report(
 	}
 
 	/* libusb0: USB_ENDPOINT_IN + USB_TYPE_CLASS + USB_RECIP_INTERFACE */
+	gettimeofday(&start, NULL);
 	ret = libusb_control_transfer(udev,
 		LIBUSB_ENDPOINT_IN|LIBUSB_REQUEST_TYPE_CLASS|LIBUSB_RECIPIENT_INTERFACE,
 		0x01, /* HID_REPORT_GET */
 		(uint16_t)ReportId + (0x03<<8), /* HID_REPORT_TYPE_FEATURE */
 		usb_subdriver.hid_rep_index,
 		raw_buf, (uint16_t)ReportSize, USB_TIMEOUT);
+	nut_libusb_stats_io(start, ret);
 
 	/* Ignore "protocol stall" (for unsupported request) on control endpoint */
 	if (ret == LIBUSB_ERROR_PIPE) {
@@ -1006,6 +1602,9 @@ static int nut_libusb_set_report(
 	usb_ctrl_charbufsize ReportSize)
 {
 	int	ret;
+	struct timeval	start;
+
+	usb_hotplug_poll();
 
 #if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && ( (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_TYPE_LIMITS) || (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_TAUTOLOGICAL_CONSTANT_OUT_OF_RANGE_COMPARE) || (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_TAUTOLOGICAL_UNSIGNED_ZERO_COMPARE) )
 # pragma GCC diagnostic push
@@ -1030,12 +1629,14 @@ static int nut_libusb_set_report(
 	}
 
 	/* libusb0: USB_ENDPOINT_OUT + USB_TYPE_CLASS + USB_RECIP_INTERFACE */
+	gettimeofday(&start, NULL);
 	ret = libusb_control_transfer(udev,
 		LIBUSB_ENDPOINT_OUT|LIBUSB_REQUEST_TYPE_CLASS|LIBUSB_RECIPIENT_INTERFACE,
 		0x09, /* HID_REPORT_SET = 0x09*/
 		(uint16_t)ReportId + (0x03<<8), /* HID_REPORT_TYPE_FEATURE */
 		usb_subdriver.hid_rep_index,
 		raw_buf, (uint16_t)ReportSize, USB_TIMEOUT);
+	nut_libusb_stats_io(start, ret);
 
 	/* Ignore "protocol stall" (for unsupported request) on control endpoint */
 	if (ret == LIBUSB_ERROR_PIPE) {
@@ -1091,6 +1692,8 @@ static int nut_libusb_get_interrupt(
 {
 	int ret, tmpbufsize;
 
+	usb_hotplug_poll();
+
 #if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && ( (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_TYPE_LIMITS) || (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_TAUTOLOGICAL_CONSTANT_OUT_OF_RANGE_COMPARE) || (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_TAUTOLOGICAL_UNSIGNED_ZERO_COMPARE) )
 # pragma GCC diagnostic push
 #endif
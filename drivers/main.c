@@ -94,6 +94,19 @@ vartab_t	*vartab_h = NULL;
  * user and group may be set globally or per-driver
  */
 time_t	poll_interval = 2;
+
+/* pollmode=adaptive: the main loop waits pollinterval_min right after
+ * the status, alarms or staleness changed and for as long as the device
+ * is on battery, low or shutting down; otherwise it backs off to
+ * pollinterval while the device is alarmed, stale or its charge moves,
+ * and up to pollinterval_max while it is quiet on line power */
+static int	poll_adaptive = 0;
+static time_t	poll_interval_min = 1, poll_interval_max = 0, poll_interval_cur = 0;
+#ifndef DRIVERS_MAIN_WITHOUT_MAIN
+static char	*poll_last_status = NULL, *poll_last_alarm = NULL;
+static int	poll_last_stale = 0;
+#endif /* DRIVERS_MAIN_WITHOUT_MAIN */
+
 static char	*chroot_path = NULL, *user = NULL, *group = NULL;
 static int	user_from_cmdline = 0, group_from_cmdline = 0;
 
@@ -1159,6 +1172,119 @@ invalid:
 	return STAT_SET_INVALID;
 }
 
+/* pollmode, pollinterval_min and pollinterval_max may be set globally
+ * or per driver, and reloaded; returns 1 if var was one of them */
+static int poll_mode_arg(const char *var, const char *val)
+{
+	char	buf[SMALLBUF];
+	int	ipv = -1;
+
+	if (!strcmp(var, "pollmode")) {
+		if (testval_reloadable(var, poll_adaptive ? "adaptive" : "fixed", val, 1) > 0) {
+			if (!strcmp(val, "adaptive")) {
+				poll_adaptive = 1;
+			} else {
+				if (strcmp(val, "fixed"))
+					upslogx(LOG_WARNING, "Invalid pollmode value: %s, using fixed", val);
+				poll_adaptive = 0;
+			}
+			poll_interval_cur = 0;
+		}
+		return 1;
+	}
+
+	if (!strcmp(var, "pollinterval_min") || !strcmp(var, "pollinterval_max")) {
+		time_t	*dest = strcmp(var, "pollinterval_min") ? &poll_interval_max : &poll_interval_min;
+
+		snprintf(buf, sizeof(buf), "%" PRIdMAX, (intmax_t)*dest);
+		if (testval_reloadable(var, buf, val, 1) > 0) {
+			if (!str_to_int(val, &ipv, 10) || ipv < 1) {
+				fatalx(EXIT_FAILURE, "Error: UPS [%s]: invalid %s: %s",
+					NUT_STRARG(upsname), var, val);
+			}
+			*dest = (time_t)ipv;
+			poll_interval_cur = 0;
+		}
+		return 1;
+	}
+
+	return 0;
+}
+
+#ifndef DRIVERS_MAIN_WITHOUT_MAIN
+/* seconds to wait before the next upsdrv_updateinfo() call */
+static time_t poll_interval_next(double last_charge)
+{
+	const char	*status, *alarm, *val;
+	time_t	lo = poll_interval_min, hi = poll_interval_max;
+	int	changed, stale;
+	double	charge = -1.0;
+
+	if (!poll_adaptive)
+		return poll_interval;
+
+	if (lo > poll_interval)
+		lo = poll_interval;
+	if (!hi)
+		hi = poll_interval * 4;
+	else if (hi < poll_interval)
+		hi = poll_interval;
+
+	status = dstate_getinfo("ups.status");
+	if (!status)
+		status = "";
+	alarm = dstate_getinfo("ups.alarm");
+	if (!alarm)
+		alarm = "";
+	stale = dstate_is_stale();
+
+	/* only a change is urgent: a persistent condition would otherwise
+	 * keep the device polled at pollinterval_min for as long as it lasts */
+	changed = (!poll_last_status || strcmp(status, poll_last_status)
+		|| !poll_last_alarm || strcmp(alarm, poll_last_alarm)
+		|| stale != poll_last_stale);
+
+	/* no backing off at all during an outage, and not beyond pollinterval
+	 * while the device needs attention or its battery charge moved during
+	 * the last cycle */
+	if (str_contains_token(status, "OB")
+	 || str_contains_token(status, "LB")
+	 || str_contains_token(status, "FSD")
+	) {
+		hi = lo;
+	} else if (stale || *alarm
+	 || ((val = dstate_getinfo("battery.charge"))
+	  && str_to_double(val, &charge, 10)
+	  && last_charge >= 0.0 && !d_equal(charge, last_charge))
+	) {
+		hi = poll_interval;
+	}
+
+	if (!poll_last_status || strcmp(status, poll_last_status)) {
+		free(poll_last_status);
+		poll_last_status = xstrdup(status);
+	}
+	if (!poll_last_alarm || strcmp(alarm, poll_last_alarm)) {
+		free(poll_last_alarm);
+		poll_last_alarm = xstrdup(alarm);
+	}
+	poll_last_stale = stale;
+
+	if (changed || !poll_interval_cur) {
+		poll_interval_cur = changed ? lo : poll_interval;
+	} else if (poll_interval_cur < hi) {
+		/* back off while nothing changes */
+		poll_interval_cur = (poll_interval_cur * 2 > hi) ? hi : poll_interval_cur * 2;
+	} else {
+		poll_interval_cur = hi;
+	}
+
+	dstate_setinfo("driver.stats.pollinterval", "%" PRIdMAX, (intmax_t)poll_interval_cur);
+
+	return poll_interval_cur;
+}
+#endif /* DRIVERS_MAIN_WITHOUT_MAIN */
+
 /* handle -x / ups.conf config details that are for this part of the code */
 static int main_arg(char *var, char *val)
 {
@@ -1302,6 +1428,9 @@ static int main_arg(char *var, char *val)
 		return 1;	/* handled */
 	}
 
+	if (poll_mode_arg(var, val))
+		return 1;	/* handled */
+
 	/* Allow per-driver overrides of the global setting
 	 * and allow to reload this, why not.
 	 * Note: this may cause "spurious" redefinitions of the
@@ -1427,6 +1556,9 @@ static void do_global_args(const char *var, const char *val)
 		return;
 	}
 
+	if (poll_mode_arg(var, val))
+		return;
+
 	/* In checks below, testinfo_reloadable(..., 0) should forbid
 	 * re-population of the setting with a new value, but emit a
 	 * warning if it did change (so driver restart is needed to apply)
@@ -1922,6 +2054,8 @@ static void exit_cleanup(void)
 	free(device_path);
 	free(user);
 	free(group);
+	free(poll_last_status);
+	free(poll_last_alarm);
 
 	if (pidfn) {
 		unlink(pidfn);
@@ -3155,22 +3289,24 @@ sockname_ownership_finished:
 	while (!exit_flag) {
 		struct timeval	timeout;
 		const st_tree_t	*dstate_entry = NULL;
+		st_tree_timespec_t	update_start, update_finish;
+		double	last_charge;
+		time_t	next_interval;
 
 		if (!dump_data) {
 			upsnotify(NOTIFY_STATE_WATCHDOG, NULL);
 		}
 
 		gettimeofday(&timeout, NULL);
-		timeout.tv_sec += poll_interval;
 
 		/* Drivers can now choose to track changes of current battery
 		 * charge vs. its previous value to e.g. report "CHRG" status.
 		 * TODO: Eventually provide a common `runtimecal` fallback to all?
 		 */
-		if ((dstate_entry = dstate_tree_find("battery.charge")) && dstate_entry->val) {
+		if ((dstate_entry = dstate_tree_find("battery.charge")) && st_tree_node_getval(dstate_entry)) {
 			double	d = -1.0;
 
-			if (str_to_double(dstate_entry->val, &d, 10) && d >= 0.0) {
+			if (str_to_double(st_tree_node_getval(dstate_entry), &d, 10) && d >= 0.0) {
 				if (!d_equal(previous_battery_charge_value, d)) {
 					previous_battery_charge_value = d;
 					previous_battery_charge_timestamp = dstate_entry->lastset;
@@ -3178,10 +3314,20 @@ sockname_ownership_finished:
 			}
 		}
 
+		last_charge = previous_battery_charge_value;
+
 		dstate_setinfo("driver.state", "updateinfo");
+		state_get_timestamp(&update_start);
 		upsdrv_updateinfo();
+		state_get_timestamp(&update_finish);
 		dstate_setinfo("driver.state", "quiet");
 
+		next_interval = poll_interval_next(last_charge);
+		timeout.tv_sec += next_interval;
+
+		dstate_stats_update(difftime_st_tree_timespec(update_finish, update_start), next_interval);
+		dstate_stats_publish(dump_data && update_count == dump_data);
+
 		/* Dump the data tree (in upsc-like format) to stdout and exit */
 		if (dump_data) {
 			/* Wait for 'dump_data' update loops to ensure data completion */
@@ -161,10 +161,19 @@ static int	hunnox_step = 0;
 static int	is_usb = 0;	/* Whether the device is connected through USB (1) or serial (0) */
 #endif	/* QX_USB && QX_SERIAL */
 
+/* Answers got from the UPS during the current walk, so that all the items
+ * using the same command (e.g. the fields of Q1 or QPIGS) share one query */
+#define WALK_CACHE_SIZE	32
 static struct {
-	char	command[SMALLBUF];	/* Command sent to the UPS to get answer/to execute an instant command */
-	char	answer[SMALLBUF];	/* Answer from the UPS, filled at runtime */
-} previous_item = { "", "" };	/* Hold the values of the item processed just before the actual one */
+	char	command[SMALLBUF];	/* Command sent to the UPS to get answer */
+	char	answer[SMALLBUF];	/* Answer from the UPS, after preprocess_answer() */
+	int	(*preprocess_command)(item_t *item, char *command, const size_t commandlen);
+	int	(*preprocess_answer)(item_t *item, const int len);
+} walk_cache[WALK_CACHE_SIZE];
+static size_t	walk_cache_count = 0;
+static size_t	walk_cache_last = WALK_CACHE_SIZE;	/* Entry used by the item processed just before the actual one */
+
+static nut_nameidx_t	qx2nut_idx;	/* subdriver->qx2nut by info_type */
 
 
 /* == Support functions == */
@@ -172,6 +181,8 @@ static int	subdriver_matcher(void);
 static ssize_t	qx_command(const char *cmd, size_t cmdlen, char *buf, size_t buflen);
 static int	qx_process_answer(item_t *item, const size_t len); /* returns just 0 or -1 */
 static bool_t	qx_ups_walk(walkmode_t mode);
+static size_t	walk_cache_find(const item_t *item);
+static void	walk_cache_store(const item_t *item);
 static void	ups_status_set(void);
 static void	ups_alarm_set(void);
 static void	qx_set_var(item_t *item);
@@ -3829,6 +3840,7 @@ void	upsdrv_cleanup(void)
 
 #endif	/* TESTING */
 
+	nut_nameidx_free(&qx2nut_idx);
 }
 
 
@@ -4235,11 +4247,63 @@ static void	qx_set_var(item_t *item)
 	}
 }
 
+/* Look for an answer to item's command got before during this walk:
+ * return its index in walk_cache, or WALK_CACHE_SIZE if not found. */
+static size_t	walk_cache_find(const item_t *item)
+{
+	size_t	i;
+
+	for (i = 0; i < walk_cache_count; i++) {
+
+		if (strcasecmp(walk_cache[i].command, item->command))
+			continue;
+
+		/* The item just before is trusted to share the answer (as it
+		 * always was), others only if they process it the same way */
+		if (i == walk_cache_last
+		||  (walk_cache[i].preprocess_command == item->preprocess_command
+		&&   walk_cache[i].preprocess_answer == item->preprocess_answer)
+		) {
+			return i;
+		}
+
+	}
+
+	return WALK_CACHE_SIZE;
+}
+
+/* Record the answer to item's command, if any */
+static void	walk_cache_store(const item_t *item)
+{
+	size_t	i = walk_cache_find(item);
+
+	if (i == WALK_CACHE_SIZE) {
+
+		if (walk_cache_count == WALK_CACHE_SIZE) {
+			walk_cache_last = WALK_CACHE_SIZE;
+			return;
+		}
+
+		i = walk_cache_count++;
+		snprintf(walk_cache[i].command, sizeof(walk_cache[i].command), "%s",
+			item->command);
+		walk_cache[i].preprocess_command = item->preprocess_command;
+		walk_cache[i].preprocess_answer = item->preprocess_answer;
+
+	}
+
+	snprintf(walk_cache[i].answer, sizeof(walk_cache[i].answer), "%s",
+		item->answer);
+	walk_cache_last = i;
+}
+
 /* Walk UPS variables and set elements of the qx2nut array. */
 static bool_t	qx_ups_walk(walkmode_t mode)
 {
 	item_t	*item;
 	int	retcode;
+	size_t	cached;
+	unsigned int	queries = 0, reused = 0;
 
 	/* Clear batt.{chrg,runt}.act for guesstimation */
 	if (mode == QX_WALKMODE_FULL_UPDATE) {
@@ -4248,9 +4312,9 @@ static bool_t	qx_ups_walk(walkmode_t mode)
 		battery_voltage_reports_one_pack_considered = 0;
 	}
 
-	/* Clear data from previous_item */
-	memset(previous_item.command, 0, sizeof(previous_item.command));
-	memset(previous_item.answer, 0, sizeof(previous_item.answer));
+	/* Forget the answers of the previous walk */
+	walk_cache_count = 0;
+	walk_cache_last = WALK_CACHE_SIZE;
 
 	/* 3 modes: QX_WALKMODE_INIT, QX_WALKMODE_QUICK_UPDATE
 	 *      and QX_WALKMODE_FULL_UPDATE */
@@ -4369,15 +4433,17 @@ static bool_t	qx_ups_walk(walkmode_t mode)
 
 		}
 
-		/* Check whether the previous item uses the same command
-		 * and then use its answer, if available.. */
-		if (strlen(previous_item.command) > 0
-		&&  strlen(previous_item.answer) > 0
-		&&  !strcasecmp(previous_item.command, item->command)
+		/* Check whether an item processed before in this walk used
+		 * the same command and then use its answer, if available.. */
+		cached = walk_cache_find(item);
+		if (cached < WALK_CACHE_SIZE
+		&&  strlen(walk_cache[cached].answer) > 0
 		) {
 
 			snprintf(item->answer, sizeof(item->answer), "%s",
-				previous_item.answer);
+				walk_cache[cached].answer);
+			walk_cache_last = cached;
+			reused++;
 
 			/* Process the answer */
 			retcode = qx_process_answer(item, strlen(item->answer));
@@ -4386,14 +4452,12 @@ static bool_t	qx_ups_walk(walkmode_t mode)
 		} else {
 
 			retcode = qx_process(item, NULL);
+			queries++;
 
-		}
+			/* Record the answer for the next items */
+			walk_cache_store(item);
 
-		/* Record item as previous_item */
-		snprintf(previous_item.command, sizeof(previous_item.command), "%s",
-			item->command);
-		snprintf(previous_item.answer, sizeof(previous_item.answer), "%s",
-			item->answer);
+		}
 
 		if (retcode) {
 
@@ -4439,6 +4503,9 @@ static bool_t	qx_ups_walk(walkmode_t mode)
 
 	}
 
+	upsdebugx(5, "%s: %u queries sent to the UPS, %u answers reused",
+		__func__, queries, reused);
+
 	/* Update battery guesstimation */
 	if (mode == QX_WALKMODE_FULL_UPDATE
 	&&  (d_equal(batt.runt.act, -1) || d_equal(batt.chrg.act, -1))
@@ -4590,10 +4657,10 @@ item_t	*find_nut_info(const char *varname, const unsigned long flag, const unsig
 {
 	item_t	*item;
 
-	for (item = subdriver->qx2nut; item->info_type != NULL; item++) {
-
-		if (strcasecmp(item->info_type, varname))
-			continue;
+	for (item = NUT_NAMEIDX_FIND(&qx2nut_idx, subdriver->qx2nut, item_t, info_type, varname);
+	     item != NULL;
+	     item = nut_nameidx_next(&qx2nut_idx, item)
+	) {
 
 		if (flag && ((item->qxflags & flag) != flag))
 			continue;
@@ -336,6 +336,33 @@ int ser_close(TYPE_FD_SER fd, const char *port)
 	return 0;
 }
 
+/* select_read() with its duration and outcome accounted in driver.stats.io;
+ * while waiting for the UPS, driver socket clients still get answers */
+static ssize_t ser_select_read(TYPE_FD_SER fd, void *buf, const size_t buflen,
+	const time_t d_sec, const suseconds_t d_usec)
+{
+	struct timeval	start, stop;
+	ssize_t	ret;
+
+	gettimeofday(&start, NULL);
+#ifndef WIN32
+	if (d_sec > 0 || d_usec > 0) {
+		ret = dstate_wait_fd(fd, d_sec, d_usec);
+		if (ret > 0) {
+			ret = read(fd, buf, buflen);
+		}
+	} else
+#endif	/* !WIN32 */
+	{
+		ret = select_read(fd, buf, buflen, d_sec, d_usec);
+	}
+	gettimeofday(&stop, NULL);
+
+	dstate_stats_io(difftimeval(stop, start), ret);
+
+	return ret;
+}
+
 ssize_t ser_send_char(TYPE_FD_SER fd, unsigned char ch)
 {
 	return ser_send_buf_pace(fd, 0, &ch, 1);
@@ -449,19 +476,27 @@ ssize_t ser_send_buf_pace(TYPE_FD_SER fd, useconds_t d_usec, const void *buf,
 	ssize_t	ret = 0;
 	ssize_t	sent;
 	const char	*data = buf;
+	struct timeval	start, stop;
 
 	assert(buflen < SSIZE_MAX);
+	gettimeofday(&start, NULL);
+
 	for (sent = 0; sent < (ssize_t)buflen; sent += ret) {
 		/* Conditions above ensure that (buflen - sent) > 0 below */
 		ret = write(fd, &data[sent], (d_usec == 0) ? (size_t)((ssize_t)buflen - sent) : 1);
 
 		if (ret < 1) {
+			gettimeofday(&stop, NULL);
+			dstate_stats_io(difftimeval(stop, start), ret);
 			return ret;
 		}
 
 		usleep(d_usec);
 	}
 
+	gettimeofday(&stop, NULL);
+	dstate_stats_io(difftimeval(stop, start), sent ? sent : 1);
+
 	return sent;
 }
 
@@ -471,14 +506,14 @@ ssize_t ser_get_char(TYPE_FD_SER fd, void *ch, time_t d_sec, useconds_t d_usec)
 	 * effectively the same (and signed -1 for suseconds_t), and at most long:
 	 * https://pubs.opengroup.org/onlinepubs/009604599/basedefs/sys/types.h.html
 	 */
-	return select_read(fd, ch, 1, d_sec, (suseconds_t)d_usec);
+	return ser_select_read(fd, ch, 1, d_sec, (suseconds_t)d_usec);
 }
 
 ssize_t ser_get_buf(TYPE_FD_SER fd, void *buf, size_t buflen, time_t d_sec, useconds_t d_usec)
 {
 	memset(buf, '\0', buflen);
 
-	return select_read(fd, buf, buflen, d_sec, (suseconds_t)d_usec);
+	return ser_select_read(fd, buf, buflen, d_sec, (suseconds_t)d_usec);
 }
 
 /* keep reading until buflen bytes are received or a timeout occurs */
@@ -493,7 +528,7 @@ ssize_t ser_get_buf_len(TYPE_FD_SER fd, void *buf, size_t buflen, time_t d_sec,
 
 	for (recv = 0; recv < (ssize_t)buflen; recv += ret) {
 
-		ret = select_read(fd, &data[recv],
+		ret = ser_select_read(fd, &data[recv],
 			(size_t)((ssize_t)buflen - recv),
 			d_sec, (suseconds_t)d_usec);
 
@@ -505,6 +540,20 @@ ssize_t ser_get_buf_len(TYPE_FD_SER fd, void *buf, size_t buflen, time_t d_sec,
 	return recv;
 }
 
+/* fill set with the characters of chars; like with strchr(), the
+   terminating NUL is considered a part of the set */
+void ser_charset_init(ser_charset_t *set, const char *chars)
+{
+	memset(set, 0, sizeof(*set));
+
+	set->bits[0] = 1;
+	for (; chars && *chars; chars++) {
+		unsigned char	ch = (unsigned char)*chars;
+
+		set->bits[ch >> 3] |= (unsigned char)(1U << (ch & 7));
+	}
+}
+
 /* reads a line up to <endchar>, discarding anything else that may follow,
    with callouts to the handler if anything matches the alertset */
 ssize_t ser_get_line_alert(TYPE_FD_SER fd, void *buf, size_t buflen, char endchar,
@@ -515,14 +564,18 @@ ssize_t ser_get_line_alert(TYPE_FD_SER fd, void *buf, size_t buflen, char endcha
 	char	tmp[64];
 	char	*data = buf;
 	ssize_t	count = 0, maxcount;
+	ser_charset_t	ign, alert;
 
 	assert(buflen < SSIZE_MAX && buflen > 0);
 	memset(buf, '\0', buflen);
 
+	ser_charset_init(&ign, ignset);
+	ser_charset_init(&alert, alertset);
+
 	maxcount = (ssize_t)buflen - 1;		/* for trailing \0 */
 
 	while (count < maxcount) {
-		ret = select_read(fd, tmp, sizeof(tmp), d_sec, (suseconds_t)d_usec);
+		ret = ser_select_read(fd, tmp, sizeof(tmp), d_sec, (suseconds_t)d_usec);
 
 		if (ret < 1) {
 			return ret;
@@ -534,10 +587,10 @@ ssize_t ser_get_line_alert(TYPE_FD_SER fd, void *buf, size_t buflen, char endcha
 				return count;
 			}
 
-			if (strchr(ignset, tmp[i]))
+			if (SER_CHARSET_HAS(&ign, tmp[i]))
 				continue;
 
-			if (strchr(alertset, tmp[i])) {
+			if (SER_CHARSET_HAS(&alert, tmp[i])) {
 				if (handler)
 					handler(tmp[i]);
 
@@ -563,10 +616,15 @@ ssize_t ser_flush_in(TYPE_FD_SER fd, const char *ignset, int verbose)
 {
 	ssize_t	ret, extra = 0;
 	char	ch;
+	ser_charset_t	ign;
+
+	ser_charset_init(&ign, ignset);
 
-	while ((ret = ser_get_char(fd, &ch, 0, 0)) > 0) {
+	/* not via ser_get_char(): draining until there is nothing left
+	 * is not a timeout worth accounting in driver.stats.io */
+	while ((ret = select_read(fd, &ch, 1, 0, 0)) > 0) {
 
-		if (strchr(ignset, ch))
+		if (SER_CHARSET_HAS(&ign, ch))
 			continue;
 
 		extra++;
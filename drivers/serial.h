@@ -85,6 +85,17 @@ ssize_t ser_get_buf(TYPE_FD_SER fd, void *buf, size_t buflen, time_t d_sec, usec
 /* keep reading until buflen bytes are received or a timeout occurs */
 ssize_t ser_get_buf_len(TYPE_FD_SER fd, void *buf, size_t buflen, time_t d_sec, useconds_t d_usec);
 
+/* set of characters (e.g. to ignore, or alerts) checked with a single
+   bit test per received byte, rather than a strchr() on a string */
+typedef struct {
+	unsigned char	bits[32];
+} ser_charset_t;
+
+#define SER_CHARSET_HAS(set, ch)	\
+	((set)->bits[(unsigned char)(ch) >> 3] & (1U << ((unsigned char)(ch) & 7)))
+
+void ser_charset_init(ser_charset_t *set, const char *chars);
+
 /* reads a line up to <endchar>, discarding anything else that may follow,
    with callouts to the handler if anything matches the alertset */
 ssize_t ser_get_line_alert(TYPE_FD_SER fd, void *buf, size_t buflen, char endchar,
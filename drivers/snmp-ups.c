@@ -173,11 +173,12 @@ mib2nut_info_t *mib2nut_info;
 /* FIXME: to be trashed */
 snmp_info_t *snmp_info;
 alarms_info_t *alarms_info;
+static nut_nameidx_t snmp_info_idx;	/* snmp_info by info_type */
 static const char *mibname;
 static const char *mibvers;
 
 #define DRIVER_NAME	"Generic SNMP UPS driver"
-#define DRIVER_VERSION	"1.38"
+#define DRIVER_VERSION	"1.39"
 
 /* driver description structure */
 upsdrv_info_t	upsdrv_info = {
@@ -216,8 +217,46 @@ static int device_template_offset = -1;
 /* sysOID location */
 #define SYSOID_OID	".1.3.6.1.2.1.1.2.0"
 
+/* Mapping table model OIDs asked for in one request while detecting the MIB */
+#define SU_PROBE_BATCH	16
+/* Template instances asked for in one GETBULK request (SNMPv2c and v3) */
+#define SU_BULK_REPETITIONS	32
+
+/* Detection results kept per host in the state path (unless the
+ * "nomibcache" flag is set), so the next start only has to check that
+ * they still hold. The file is named after the driver section and the
+ * host, since several sections may talk to one agent with different
+ * "mibs", "community" or "snmp_version" settings; its lines are
+ * tab-separated:
+ *   version <DRIVER_VERSION>
+ *   mib <mib2nut index> <mib name> <device sysOID>
+ *   count <OID template> <number of instances>
+ */
+#define SU_CACHE_FILE_FMT	"%s/snmp-ups-%s@%s.cache"
+
+typedef struct {
+	char	*OID;	/* template */
+	int	count;
+} su_cache_count_t;
+
+static struct {
+	int	enabled;
+	int	dirty;
+	int	mib_index;	/* in mib2nut[], -1 if not known */
+	char	*mib_name;
+	char	*sysoid;
+	su_cache_count_t	*counts;
+	size_t	nb_counts;
+} su_cache = { 0, 0, -1, NULL, NULL, NULL, 0 };
+
+/* sysOID value of the device, as last read by get_sysoid() */
+static char device_sysoid[LARGEBUF];
+
 /* Forward functions declarations */
 static void disable_transfer_oids(void);
+static void su_cache_load(void);
+static void su_cache_save(void);
+static void su_cache_free(void);
 bool_t get_and_process_data(int mode, snmp_info_t *su_info_p);
 int extract_template_number(snmp_info_flags_t template_type, const char* varname);
 snmp_info_flags_t get_template_type(const char* varname);
@@ -437,6 +476,9 @@ void upsdrv_initinfo(void)
 		comm_status = COMM_LOST;
 	}
 
+	/* Templates counted during the initial walk */
+	su_cache_save();
+
 	/* setup handlers for instcmd and setvar functions */
 	upsh.setvar = su_setvar;
 	upsh.instcmd = su_instcmd;
@@ -484,6 +526,9 @@ void upsdrv_updateinfo(void)
 		if (daisychain_enabled == TRUE)
 			alarm_commit();
 
+		/* Templates may also get counted in later walks */
+		su_cache_save();
+
 		/* store timestamp */
 		lastpoll = time(NULL);
 	}
@@ -599,6 +644,8 @@ void upsdrv_makevartable(void)
 		"Disable transfer OIDs (use on APCC Symmetras)");
 	addvar(VAR_FLAG, "symmetrathreephase",
 		"Enable APCC three phase Symmetra quirks (use on APCC three phase Symmetras)");
+	addvar(VAR_FLAG, "nomibcache",
+		"Do not keep the MIB detection results in the state path for the next start");
 	addvar(VAR_VALUE, SU_VAR_SECLEVEL,
 		"Set the securityLevel used for SNMPv3 messages (default=noAuthNoPriv, allowed: authNoPriv,authPriv)");
 	addvar(VAR_VALUE | VAR_SENSITIVE, SU_VAR_SECNAME,
@@ -811,6 +858,10 @@ void upsdrv_initups(void)
 	/* init SNMP library, etc... */
 	nut_snmp_init(progname, device_path);
 
+	/* Results of a previous MIB detection for this host, if any */
+	su_cache.enabled = !testvar("nomibcache");
+	su_cache_load();
+
 	/* FIXME: first test if the device is reachable to avoid timeouts! */
 
 	/* FIXME: with the argument called "mibs" (plural) it could make
@@ -972,6 +1023,9 @@ void upsdrv_cleanup(void)
 	if (daisychain_info)
 		free(daisychain_info);
 
+	nut_nameidx_free(&snmp_info_idx);
+	su_cache_free();
+
 	/* Net-SNMP specific cleanup */
 	nut_snmp_cleanup();
 }
@@ -1280,6 +1334,22 @@ static void nut_snmp_free(struct snmp_pdu ** array_to_free)
 	}
 }
 
+/* snmp_synch_response(), with its duration and outcome in driver.stats.io */
+static int nut_snmp_synch_response(struct snmp_pdu *pdu, struct snmp_pdu **response)
+{
+	int	status;
+	struct timeval	start, stop;
+
+	gettimeofday(&start, NULL);
+	status = snmp_synch_response(g_snmp_sess_p, pdu, response);
+	gettimeofday(&stop, NULL);
+
+	dstate_stats_io(difftimeval(stop, start),
+		(status == STAT_TIMEOUT) ? 0 : (status == STAT_SUCCESS) ? 1 : -1);
+
+	return status;
+}
+
 /* Return a NULL terminated array of snmp_pdu * */
 static struct snmp_pdu **nut_snmp_walk(const char *OID, int max_iteration)
 {
@@ -1328,7 +1398,7 @@ static struct snmp_pdu **nut_snmp_walk(const char *OID, int max_iteration)
 
 		snmp_add_null_var(pdu, current_name, current_name_len);
 
-		status = snmp_synch_response(g_snmp_sess_p, pdu, &response);
+		status = nut_snmp_synch_response(pdu, &response);
 
 		if (!response) {
 			break;
@@ -1686,7 +1756,7 @@ bool_t nut_snmp_set(const char *OID, char type, const char *value)
 		return FALSE;
 	}
 
-	status = snmp_synch_response(g_snmp_sess_p, pdu, &response);
+	status = nut_snmp_synch_response(pdu, &response);
 
 	if ((status == STAT_SUCCESS) && (response->errstat == SNMP_ERR_NOERROR))
 		ret = TRUE;
@@ -2028,23 +2098,214 @@ snmp_info_t *su_find_info(const char *type)
 		upsdebugx(1, "%s: WARNING: snmp_info is empty", __func__);
 	}
 
-	for (su_info_p = &snmp_info[0]; (su_info_p != NULL && su_info_p->info_type != NULL) ; su_info_p++)
-		if (!strcasecmp(su_info_p->info_type, type)) {
-			upsdebugx(3, "%s: \"%s\" found", __func__, type);
-			return su_info_p;
-		}
+	su_info_p = NUT_NAMEIDX_FIND(&snmp_info_idx, snmp_info, snmp_info_t, info_type, type);
+	if (su_info_p) {
+		upsdebugx(3, "%s: \"%s\" found", __func__, type);
+		return su_info_p;
+	}
 
 	upsdebugx(3, "%s: unknown info type (%s)", __func__, type);
 	return NULL;
 }
 
-/* Counter match the sysOID using {device,ups}.model OID
- * Return TRUE if this OID can be retrieved, FALSE otherwise */
-static bool_t match_model_OID(void)
+/* Copy a section or host name, sanitized for use in a file name
+ * (e.g. an IPv6 address); this never leaves a '@' behind */
+static void su_cache_sanitize(char *buf, size_t buflen, const char *name)
 {
-	bool_t retCode = FALSE;
-	snmp_info_t *su_info_p, *cur_info_p;
-	char testOID_buf[LARGEBUF];
+	char	*p;
+
+	snprintf(buf, buflen, "%s", name ? name : "");
+	for (p = buf; *p; p++) {
+		if (!isalnum((unsigned char)*p) && *p != '.' && *p != '-')
+			*p = '_';
+	}
+}
+
+/* Name of the cache file for this driver section and host */
+static void su_cache_filename(char *fn, size_t fnlen)
+{
+	char	section[SU_INFOSIZE], host[SU_INFOSIZE];
+
+	su_cache_sanitize(section, sizeof(section), upsname);
+	su_cache_sanitize(host, sizeof(host), device_path);
+
+	snprintf(fn, fnlen, SU_CACHE_FILE_FMT, dflt_statepath(), section, host);
+}
+
+static void su_cache_set_mib(int mib_index, const char *mib_name, const char *sysoid)
+{
+	if (su_cache.mib_index == mib_index
+	 && su_cache.mib_name && !strcmp(su_cache.mib_name, mib_name)
+	 && su_cache.sysoid && !strcmp(su_cache.sysoid, sysoid)
+	) {
+		return;
+	}
+
+	free(su_cache.mib_name);
+	free(su_cache.sysoid);
+	su_cache.mib_index = mib_index;
+	su_cache.mib_name = xstrdup(mib_name);
+	su_cache.sysoid = xstrdup(sysoid);
+	su_cache.dirty = 1;
+}
+
+/* Cached number of instances for that OID template, -1 if not known */
+static int su_cache_get_count(const char *OID_template)
+{
+	size_t	i;
+
+	for (i = 0; i < su_cache.nb_counts; i++) {
+		if (!strcmp(su_cache.counts[i].OID, OID_template))
+			return su_cache.counts[i].count;
+	}
+
+	return -1;
+}
+
+static void su_cache_set_count(const char *OID_template, int count)
+{
+	size_t	i;
+
+	for (i = 0; i < su_cache.nb_counts; i++) {
+		if (!strcmp(su_cache.counts[i].OID, OID_template))
+			break;
+	}
+
+	if (i == su_cache.nb_counts) {
+		su_cache.counts = xrealloc(su_cache.counts,
+			(su_cache.nb_counts + 1) * sizeof(*su_cache.counts));
+		su_cache.counts[i].OID = xstrdup(OID_template);
+		su_cache.nb_counts++;
+	} else if (su_cache.counts[i].count == count) {
+		return;
+	}
+
+	su_cache.counts[i].count = count;
+	su_cache.dirty = 1;
+}
+
+static void su_cache_free(void)
+{
+	size_t	i;
+
+	for (i = 0; i < su_cache.nb_counts; i++)
+		free(su_cache.counts[i].OID);
+	free(su_cache.counts);
+	su_cache.counts = NULL;
+	su_cache.nb_counts = 0;
+
+	free(su_cache.mib_name);
+	su_cache.mib_name = NULL;
+	free(su_cache.sysoid);
+	su_cache.sysoid = NULL;
+	su_cache.mib_index = -1;
+}
+
+/* Read what a previous start of the driver detected for this host;
+ * results from another driver version are ignored */
+static void su_cache_load(void)
+{
+	char	fn[NUT_PATH_MAX + 1], buf[LARGEBUF];
+	FILE	*f;
+	int	version_ok = 0;
+
+	if (!su_cache.enabled)
+		return;
+
+	su_cache_filename(fn, sizeof(fn));
+	if ((f = fopen(fn, "r")) == NULL) {
+		upsdebug_with_errno(3, "%s: can't read %s", __func__, fn);
+		return;
+	}
+
+	while (fgets(buf, sizeof(buf), f)) {
+		char	*field[4], *p = buf;
+		size_t	n = 0;
+
+		buf[strcspn(buf, "\r\n")] = '\0';
+
+		field[n++] = p;
+		while (n < 4 && (p = strchr(p, '\t')) != NULL) {
+			*p++ = '\0';
+			field[n++] = p;
+		}
+
+		if (!strcmp(field[0], "version") && n == 2) {
+			version_ok = !strcmp(field[1], DRIVER_VERSION);
+			continue;
+		}
+
+		if (!version_ok) {
+			upsdebugx(2, "%s: %s was written by another driver version, ignoring it",
+				__func__, fn);
+			break;
+		}
+
+		if (!strcmp(field[0], "mib") && n == 4) {
+			su_cache_set_mib(atoi(field[1]), field[2], field[3]);
+		} else if (!strcmp(field[0], "count") && n == 3) {
+			su_cache_set_count(field[1], atoi(field[2]));
+		} else {
+			upsdebugx(3, "%s: skipping malformed line", __func__);
+		}
+	}
+
+	fclose(f);
+
+	if (!version_ok)
+		su_cache_free();
+
+	su_cache.dirty = 0;
+
+	upsdebugx(2, "%s: cached MIB %s, %" PRIuSIZE " cached template counts",
+		__func__, NUT_STRARG(su_cache.mib_name), su_cache.nb_counts);
+}
+
+/* Write the detection results back, if they changed (via a rename, so
+ * a partially written file is never seen) */
+static void su_cache_save(void)
+{
+	char	fn[NUT_PATH_MAX + 1], tmpfn[NUT_PATH_MAX + 16];
+	size_t	i;
+	FILE	*f;
+
+	if (!su_cache.enabled || !su_cache.dirty)
+		return;
+
+	su_cache_filename(fn, sizeof(fn));
+	snprintf(tmpfn, sizeof(tmpfn), "%s.%ld", fn, (long)getpid());
+
+	if ((f = fopen(tmpfn, "w")) == NULL) {
+		upsdebug_with_errno(2, "%s: can't write %s", __func__, tmpfn);
+		return;
+	}
+
+	fprintf(f, "version\t%s\n", DRIVER_VERSION);
+	if (su_cache.mib_name && su_cache.sysoid) {
+		fprintf(f, "mib\t%d\t%s\t%s\n",
+			su_cache.mib_index, su_cache.mib_name, su_cache.sysoid);
+	}
+	for (i = 0; i < su_cache.nb_counts; i++) {
+		fprintf(f, "count\t%s\t%d\n",
+			su_cache.counts[i].OID, su_cache.counts[i].count);
+	}
+
+	if (fclose(f) != 0 || rename(tmpfn, fn) != 0) {
+		upsdebug_with_errno(2, "%s: can't update %s", __func__, fn);
+		unlink(tmpfn);
+		return;
+	}
+
+	su_cache.dirty = 0;
+	upsdebugx(3, "%s: saved detection results to %s", __func__, fn);
+}
+
+/* Get the OID of {device,ups}.model in the current snmp_info, resolving
+ * a daisychain template to the daisychain master (0) / 1rst device index.
+ * Return TRUE if there is one, FALSE otherwise */
+static bool_t model_OID(char *buf, size_t buf_len)
+{
+	snmp_info_t *su_info_p;
 
 	/* Try to get device.model first */
 	su_info_p = su_find_info("device.model");
@@ -2052,40 +2313,181 @@ static bool_t match_model_OID(void)
 	if (su_info_p == NULL)
 		su_info_p = su_find_info("ups.model");
 
-	if (su_info_p != NULL) {
-		/* Daisychain specific: we may have a template (including formatting
-		 * string) that needs to be adapted! */
-		if (strchr(su_info_p->OID, '%') != NULL)
-		{
-			upsdebugx(2, "Found template, need to be adapted");
-			cur_info_p = (snmp_info_t *)malloc(sizeof(snmp_info_t));
-			cur_info_p->info_type = (char *)xmalloc(SU_INFOSIZE);
-			cur_info_p->OID = (char *)xmalloc(SU_INFOSIZE);
-			snprintf((char*)cur_info_p->info_type, SU_INFOSIZE, "%s", su_info_p->info_type);
-			/* Use the daisychain master (0) / 1rst device index */
-			snprintf_dynamic((char*)cur_info_p->OID, SU_INFOSIZE, su_info_p->OID, "%i", 0);
+	if (su_info_p == NULL || su_info_p->OID == NULL)
+		return FALSE;
+
+	/* Daisychain specific: we may have a template (including formatting
+	 * string) that needs to be adapted! */
+	if (strchr(su_info_p->OID, '%') != NULL) {
+		upsdebugx(2, "Found template, need to be adapted");
+		snprintf_dynamic(buf, buf_len, su_info_p->OID, "%i", 0);
+	}
+	else {
+		upsdebugx(2, "Found entry, not a template %s", su_info_p->OID);
+		snprintf(buf, buf_len, "%s", su_info_p->OID);
+	}
+
+	return TRUE;
+}
+
+/* Counter match the sysOID using {device,ups}.model OID
+ * Return TRUE if this OID can be retrieved, FALSE otherwise */
+static bool_t match_model_OID(void)
+{
+	char testOID[SU_INFOSIZE];
+	char testOID_buf[LARGEBUF];
+
+	if (model_OID(testOID, sizeof(testOID)) != TRUE)
+		return FALSE;
+
+	upsdebugx(2, "Testing model using OID %s", testOID);
+	return nut_snmp_get_str(testOID, testOID_buf, LARGEBUF, NULL);
+}
+
+/* Ask the device for the model OIDs of all mapping tables at once (by
+ * SU_PROBE_BATCH variables per request), so that the tables whose OID is
+ * not there can be skipped without a request of their own. present[i] is
+ * set to FALSE for the mib2nut[i] tables known not to match, and left
+ * TRUE otherwise (including when a whole request failed, in which case
+ * match_model_OID() asks for each of them as before).
+ * Only for SNMPv2c and v3: SNMPv1 agents fail the whole request for the
+ * first variable they do not have, which would not save anything. */
+static void probe_model_OIDs(bool_t *present)
+{
+	struct snmp_pdu *pdu = NULL, *response;
+	struct variable_list *var;
+	snmp_info_t *saved_snmp_info = snmp_info;
+	oid name[MAX_OID_LEN];
+	size_t name_len;
+	char testOID[SU_INFOSIZE];
+	int batch[SU_PROBE_BATCH];
+	int i, k, n = 0, status;
+
+	for (i = 0; ; i++) {
+		if (mib2nut[i] != NULL) {
+			present[i] = TRUE;
+
+			if (mib2nut[i]->snmp_info == NULL)
+				continue;
+
+			snmp_info = mib2nut[i]->snmp_info;
+			name_len = MAX_OID_LEN;
+			if (model_OID(testOID, sizeof(testOID)) != TRUE
+			 || !snmp_parse_oid(testOID, name, &name_len)
+			) {
+				/* match_model_OID() would fail without asking */
+				present[i] = FALSE;
+				continue;
+			}
+
+			if (pdu == NULL && (pdu = snmp_pdu_create(SNMP_MSG_GET)) == NULL)
+				fatalx(EXIT_FAILURE, "Not enough memory");
+
+			snmp_add_null_var(pdu, name, name_len);
+			batch[n++] = i;
+
+			if (n < SU_PROBE_BATCH)
+				continue;
 		}
-		else {
-			upsdebugx(2, "Found entry, not a template %s", su_info_p->OID);
-			/* Otherwise, just point at what we found */
-			cur_info_p = su_info_p;
+
+		if (n > 0) {
+			upsdebugx(2, "%s: asking for %d model OIDs at once", __func__, n);
+			response = NULL;
+			status = nut_snmp_synch_response(pdu, &response);
+
+			if (status == STAT_SUCCESS && response
+			 && response->errstat == SNMP_ERR_NOERROR
+			) {
+				for (var = response->variables, k = 0;
+				     var != NULL && k < n;
+				     var = var->next_variable, k++
+				) {
+					if (var->type == SNMP_NOSUCHOBJECT
+					 || var->type == SNMP_NOSUCHINSTANCE
+					 || var->type == SNMP_ENDOFMIBVIEW
+					) {
+						upsdebugx(3, "%s: model OID of MIB '%s' is not available",
+							__func__, mib2nut[batch[k]]->mib_name);
+						present[batch[k]] = FALSE;
+					}
+				}
+			}
+			else {
+				upsdebugx(2, "%s: batch request failed, will ask one by one", __func__);
+			}
+
+			if (response)
+				snmp_free_pdu(response);
+			pdu = NULL;
+			n = 0;
 		}
 
-		upsdebugx(2, "Testing %s using OID %s", cur_info_p->info_type, cur_info_p->OID);
-		retCode = nut_snmp_get_str(cur_info_p->OID, testOID_buf, LARGEBUF, NULL);
+		if (mib2nut[i] == NULL)
+			break;
+	}
 
-		/* Free our malloc, if it was dynamic */
-		if (strchr(su_info_p->OID, '%') != NULL) {
-			if (cur_info_p->info_type != NULL)
-				free((char*)cur_info_p->info_type);
-			if (cur_info_p->OID != NULL)
-				free((char*)cur_info_p->OID);
-			if (cur_info_p != NULL)
-				free((char*)cur_info_p);
+	snmp_info = saved_snmp_info;
+}
+
+/* Get the sysOID value of the device into buf (and device_sysoid).
+ * Return TRUE if it could be read, FALSE otherwise */
+static bool_t get_sysoid(char *buf, size_t buf_len)
+{
+	if (nut_snmp_get_oid(SYSOID_OID, buf, buf_len) != TRUE)
+	{
+		upsdebugx(2, "Can't get sysOID value (using nut_snmp_get_oid())");
+		/* Fallback for non-compliant device, that returns a string and not an OID */
+		if (nut_snmp_get_str(SYSOID_OID, buf, buf_len, NULL) != TRUE) {
+			upsdebugx(2, "Can't get sysOID value (using nut_snmp_get_str())");
+			return FALSE;
 		}
 	}
 
-	return retCode;
+	snprintf(device_sysoid, sizeof(device_sysoid), "%s", buf);
+	return TRUE;
+}
+
+/* Reuse the MIB detected during a previous start, if the device still
+ * reports the same sysOID and the model OID of that MIB.
+ * Return a pointer to its mib2nut definition if so, NULL otherwise */
+static mib2nut_info_t *match_cached_mib(void)
+{
+	char sysOID_buf[LARGEBUF];
+	int i;
+
+	if (su_cache.mib_name == NULL || su_cache.sysoid == NULL)
+		return NULL;
+
+	for (i = 0; mib2nut[i] != NULL && i < su_cache.mib_index; i++)
+		;
+
+	if (i != su_cache.mib_index || mib2nut[i] == NULL
+	 || strcmp(mib2nut[i]->mib_name, su_cache.mib_name)
+	 || mib2nut[i]->snmp_info == NULL
+	) {
+		upsdebugx(1, "%s: cached MIB '%s' is not in the mapping table anymore",
+			__func__, su_cache.mib_name);
+		return NULL;
+	}
+
+	if (get_sysoid(sysOID_buf, sizeof(sysOID_buf)) != TRUE
+	 || strcmp(sysOID_buf, su_cache.sysoid)
+	) {
+		upsdebugx(1, "%s: device sysOID changed since MIB '%s' was detected",
+			__func__, su_cache.mib_name);
+		return NULL;
+	}
+
+	snmp_info = mib2nut[i]->snmp_info;
+	if (match_model_OID() != TRUE) {
+		upsdebugx(1, "%s: model OID of cached MIB '%s' is not available anymore",
+			__func__, su_cache.mib_name);
+		snmp_info = NULL;
+		return NULL;
+	}
+
+	upsdebugx(1, "%s: device still matches cached MIB '%s'", __func__, su_cache.mib_name);
+	return mib2nut[i];
 }
 
 /* Try to find the MIB using sysOID matching.
@@ -2100,15 +2502,8 @@ static mib2nut_info_t *match_sysoid(void)
 	int i;
 
 	/* Retrieve sysOID value of this device */
-	if (nut_snmp_get_oid(SYSOID_OID, sysOID_buf, sizeof(sysOID_buf)) != TRUE)
-	{
-		upsdebugx(2, "Can't get sysOID value (using nut_snmp_get_oid())");
-		/* Fallback for non-compliant device, that returns a string and not an OID */
-		if (nut_snmp_get_str(SYSOID_OID, sysOID_buf, sizeof(sysOID_buf), NULL) != TRUE) {
-			upsdebugx(2, "Can't get sysOID value (using nut_snmp_get_str())");
-			return NULL;
-		}
-	}
+	if (get_sysoid(sysOID_buf, sizeof(sysOID_buf)) != TRUE)
+		return NULL;
 
 	upsdebugx(1, "%s: device sysOID value = %s", __func__, sysOID_buf);
 
@@ -2190,6 +2585,7 @@ bool_t load_mib2nut(const char *mib)
 {
 	int	i;
 	mib2nut_info_t *m2n = NULL;
+	bool_t	*present = NULL;
 	/* Below we have many checks for "auto"; avoid redundant string walks: */
 	bool_t mibIsAuto = (0 == strcmp(mib, "auto"));
 	bool_t mibSeen = FALSE; /* Did we see the MIB name while walking mib2nut[]? */
@@ -2201,10 +2597,15 @@ bool_t load_mib2nut(const char *mib)
 		device_path /* the "port" from config section is hostname/IP for networked drivers */
 		);
 
+	/* Reuse what was detected for this host during a previous start,
+	 * if that still holds */
+	if (mibIsAuto)
+		m2n = match_cached_mib();
+
 	/* First, try to match against sysOID, if no MIB was provided.
 	 * This should speed up init stage
 	 * (Note: sysOID points the device main MIB entry point) */
-	if (mibIsAuto)
+	if (mibIsAuto && m2n == NULL)
 	{
 		upsdebugx(2, "%s: trying the new match_sysoid() method with %s",
 			__func__, mib);
@@ -2232,6 +2633,14 @@ bool_t load_mib2nut(const char *mib)
 	/* Otherwise, revert to the classic method */
 	if (m2n == NULL)
 	{
+		if (mibIsAuto && g_snmp_sess.version != SNMP_VERSION_1) {
+			/* Find out which tables can match at all in a few requests */
+			for (i = 0; mib2nut[i] != NULL; i++)
+				;
+			present = (bool_t *)xcalloc((size_t)i + 1, sizeof(bool_t));
+			probe_model_OIDs(present);
+		}
+
 		for (i = 0; mib2nut[i] != NULL; i++) {
 			/* Is there already a MIB name provided? */
 			upsdebugx(4, "%s: checking against mapping table entry #%d \"%s\"",
@@ -2270,6 +2679,13 @@ bool_t load_mib2nut(const char *mib)
 				mibSeen = TRUE;
 			}
 
+			if (present != NULL && present[i] != TRUE) {
+				upsdebugx(3, "%s: testOID not available for MIB '%s'!",
+					__func__, mib2nut[i]->mib_name);
+				snmp_info = NULL;
+				continue;
+			}
+
 			if (match_model_OID() != TRUE)
 			{
 				upsdebugx(3, "%s: testOID provided and doesn't match MIB '%s'!",
@@ -2285,6 +2701,8 @@ bool_t load_mib2nut(const char *mib)
 			m2n = mib2nut[i];
 			break;
 		}
+
+		free(present);
 	}
 
 	/* Store the result, if any */
@@ -2299,6 +2717,14 @@ bool_t load_mib2nut(const char *mib)
 			__func__, mibname,
 			upsname ? upsname : device_name, device_path);
 
+		/* Only an automatic detection is worth remembering, and only
+		 * if it can be checked quickly against the sysOID next time */
+		if (mibIsAuto && *device_sysoid) {
+			for (i = 0; mib2nut[i] != NULL && mib2nut[i] != m2n; i++)
+				;
+			su_cache_set_mib(i, mibname, device_sysoid);
+		}
+
 		/* FIXME: also "tripplite" on devices that do not identify as such */
 		if (mibIsAuto && strcasecmp(mibname, "ietf"))
 			upsdebugx(0, "Only the IETF standard mapping was found as fallback. "
@@ -2663,9 +3089,119 @@ static int base_snmp_template_index(const snmp_info_t *su_info_p)
 	return base_index;
 }
 
+/* Does the OID template instance of that index exist on the device? */
+static bool_t template_instance_exists(const char *OID_template, int index)
+{
+	char test_OID[SU_INFOSIZE];
+	struct snmp_pdu *pdu;
+
+	snprintf_dynamic(test_OID, sizeof(test_OID), OID_template, "%i", index);
+	if ((pdu = nut_snmp_get(test_OID)) == NULL)
+		return FALSE;
+
+	snmp_free_pdu(pdu);
+	return TRUE;
+}
+
+/* Check a number of instances (cached, or counted with GETBULK) with
+ * two requests: the last instance must exist, and the next one not */
+static bool_t template_count_matches(const char *OID_template, int base_index, int count)
+{
+	if (count > 0 && template_instance_exists(OID_template, base_index + count - 1) != TRUE)
+		return FALSE;
+
+	return (template_instance_exists(OID_template, base_index + count) != TRUE);
+}
+
+/* Count the consecutive instances of an OID template ending with its
+ * index from base_index on, with GETBULK requests fetching up to
+ * SU_BULK_REPETITIONS of them at once. Return -1 if that is not
+ * possible (SNMPv1, index in the middle of the OID, failed request) */
+static int bulk_template_count(const char *OID_template, int base_index)
+{
+	struct snmp_pdu *pdu, *response = NULL;
+	struct variable_list *var;
+	char prefix[SU_INFOSIZE];
+	const char *p;
+	oid prefix_name[MAX_OID_LEN], cur_name[MAX_OID_LEN];
+	size_t prefix_len = MAX_OID_LEN, cur_len;
+	int count = 0, status;
+	bool_t done = FALSE;
+
+	if (g_snmp_sess.version == SNMP_VERSION_1)
+		return -1;
+
+	p = strchr(OID_template, '%');
+	if (p == NULL || p == OID_template || p[-1] != '.' || strcmp(p, "%i"))
+		return -1;
+
+	snprintf(prefix, sizeof(prefix), "%.*s", (int)(p - OID_template - 1), OID_template);
+	if (!snmp_parse_oid(prefix, prefix_name, &prefix_len) || prefix_len >= MAX_OID_LEN)
+		return -1;
+
+	/* GETBULK returns what follows the OID it is given */
+	memcpy(cur_name, prefix_name, prefix_len * sizeof(oid));
+	cur_len = prefix_len;
+	if (base_index > 0)
+		cur_name[cur_len++] = (oid)(base_index - 1);
+
+	while (done != TRUE) {
+		/* Check if we are asked to stop (reactivity++) */
+		if (exit_flag != 0) {
+			fatalx(EXIT_FAILURE, "Aborting because exit_flag was set");
+		}
+
+		if ((pdu = snmp_pdu_create(SNMP_MSG_GETBULK)) == NULL)
+			fatalx(EXIT_FAILURE, "Not enough memory");
+
+		pdu->non_repeaters = 0;
+		pdu->max_repetitions = SU_BULK_REPETITIONS;
+		snmp_add_null_var(pdu, cur_name, cur_len);
+
+		status = nut_snmp_synch_response(pdu, &response);
+		if (status != STAT_SUCCESS || response == NULL
+		 || response->errstat != SNMP_ERR_NOERROR
+		) {
+			upsdebugx(2, "%s: GETBULK request failed for %s", __func__, OID_template);
+			if (response)
+				snmp_free_pdu(response);
+			return -1;
+		}
+
+		done = TRUE;
+		for (var = response->variables; var != NULL; var = var->next_variable) {
+			/* Stop at the first instance which is missing, or at
+			 * the end of the subtree */
+			if (var->type == SNMP_NOSUCHOBJECT
+			 || var->type == SNMP_NOSUCHINSTANCE
+			 || var->type == SNMP_ENDOFMIBVIEW
+			 || var->name_length != prefix_len + 1
+			 || snmp_oid_compare(var->name, prefix_len, prefix_name, prefix_len)
+			 || var->name[prefix_len] != (oid)(base_index + count)
+			) {
+				done = TRUE;
+				break;
+			}
+
+			count++;
+			memcpy(cur_name, var->name, var->name_length * sizeof(oid));
+			cur_len = var->name_length;
+			done = FALSE;
+		}
+
+		snmp_free_pdu(response);
+		response = NULL;
+	}
+
+	upsdebugx(3, "%s(%s): %i", __func__, OID_template, count);
+	return count;
+}
+
 /* Try to determine the number of items (outlets, outlet groups, ...),
  * using a template definition. Walk through the template until we can't
- * get anymore values. I.e., if we can iterate up to 8 item, return 8 */
+ * get anymore values. I.e., if we can iterate up to 8 item, return 8.
+ * A count remembered from a previous start, or one got with GETBULK,
+ * is used instead if it checks out. */
 static int guesstimate_template_count(snmp_info_t *su_info_p)
 {
 	int base_index = 0;
@@ -2696,6 +3232,21 @@ static int guesstimate_template_count(snmp_info_t *su_info_p)
 		}
 	}
 
+	if ((base_count = su_cache_get_count(OID_template)) >= 0
+	 && template_count_matches(OID_template, base_index, base_count) == TRUE
+	) {
+		upsdebugx(3, "%s: %i (cached)", __func__, base_count);
+		return base_count;
+	}
+
+	if ((base_count = bulk_template_count(OID_template, base_index)) >= 0
+	 && template_count_matches(OID_template, base_index, base_count) == TRUE
+	) {
+		upsdebugx(3, "%s: %i (GETBULK)", __func__, base_count);
+		su_cache_set_count(OID_template, base_count);
+		return base_count;
+	}
+
 	/* Now, actually iterate */
 	for (base_count = 0 ;  ; base_count++) {
 		snprintf_dynamic(test_OID, sizeof(test_OID), OID_template, "%i", base_index + base_count);
@@ -2704,6 +3255,7 @@ static int guesstimate_template_count(snmp_info_t *su_info_p)
 	}
 
 	upsdebugx(3, "%s: %i", __func__, base_count);
+	su_cache_set_count(OID_template, base_count);
 	return base_count;
 }
 
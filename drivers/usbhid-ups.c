@@ -121,6 +121,9 @@ typedef enum {
 /* pointer to the active subdriver object (changed in callback() function) */
 static subdriver_t *subdriver = NULL;
 
+/* subdriver->hid2nut by info_type, for find_nut_info() */
+static nut_nameidx_t hid2nut_idx;
+
 /* Global vars */
 static HIDDevice_t *hd = NULL;
 static HIDDevice_t curDevice = { 0x0000, 0x0000, NULL, NULL, NULL, NULL, 0, NULL
@@ -1947,6 +1950,7 @@ void upsdrv_cleanup(void)
 	comm_driver->close_dev(udev);
 	Free_ReportDesc(pDesc);
 	free_report_buffer(reportbuf);
+	nut_nameidx_free(&hid2nut_idx);
 #if !((defined SHUT_MODE) && SHUT_MODE)
 	USBFreeExactMatcher(exact_matcher);
 	USBFreeRegexMatcher(regex_matcher);
@@ -2932,10 +2936,10 @@ static hid_info_t *find_nut_info(const char *varname)
 		return NULL;
 	}
 
-	for (hidups_item = subdriver->hid2nut; hidups_item->info_type != NULL ; hidups_item++) {
-		if (strcasecmp(hidups_item->info_type, varname))
-			continue;
-
+	for (hidups_item = NUT_NAMEIDX_FIND(&hid2nut_idx, subdriver->hid2nut, hid_info_t, info_type, varname);
+	     hidups_item != NULL;
+	     hidups_item = nut_nameidx_next(&hid2nut_idx, hidups_item)
+	) {
 		if (hidups_item->hiddata != NULL) {
 			errno = 0;
 			return hidups_item;
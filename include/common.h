@@ -57,6 +57,7 @@
 #endif
 
 #include <stdlib.h>
+#include <stddef.h>	/* offsetof() */
 
 #ifdef HAVE_STRINGS_H
 #include <strings.h>	/* for strncasecmp() and strcasecmp() */
@@ -781,6 +782,55 @@ double difftimeval(struct timeval x, struct timeval y);
 double difftimespec(struct timespec x, struct timespec y);
 #endif
 
+/* Cheap latency accounting: min/avg/max plus a histogram with power-of-two
+ * microsecond buckets (bucket N counts durations in [2^(N-1), 2^N) us,
+ * the last one catches everything from about 4 seconds up), which is
+ * enough to estimate percentiles. Used by upsd LIST STATS and by the
+ * driver.stats.* data points of drivers. */
+#define NUT_LATENCY_BUCKETS	24
+typedef struct nut_latency_s {
+	uint64_t	count;
+	uint64_t	usec_total;
+	uint64_t	usec_min;
+	uint64_t	usec_max;
+	uint64_t	hist[NUT_LATENCY_BUCKETS];
+} nut_latency_t;
+
+/* Account one event which took "elapsed" seconds */
+void nut_latency_add(nut_latency_t *lat, double elapsed);
+/* Upper bound (in microseconds, capped by the maximum seen) of the bucket
+ * holding the given percentile; 0 if nothing was accounted yet */
+uint64_t nut_latency_percentile(const nut_latency_t *lat, unsigned int pct);
+/* Average duration in microseconds; 0 if nothing was accounted yet */
+uint64_t nut_latency_avg(const nut_latency_t *lat);
+
+/* FNV-1a hash of a string for hash tables; with casefold set, the string
+ * is hashed lowercased so names compared with strcasecmp() collide */
+size_t nut_strhash(const char *s, int casefold);
+
+/* Case-insensitive index of a static table (terminated by an entry with
+ * a NULL name) by the "const char *" name field of its entries, such as
+ * the driver mapping tables searched by NUT variable name. It is built
+ * on the first lookup, and rebuilt if another table is looked up with
+ * the same index (e.g. after a subdriver was chosen). */
+typedef struct nut_nameidx_s {
+	char	*table;
+	size_t	stride;	/* size of an entry */
+	size_t	offset;	/* of the name field in an entry */
+	size_t	*slots;	/* entry position + 1, 0 for an empty slot */
+	size_t	*next;	/* position + 1 of the next entry with the same name */
+	size_t	size;	/* of slots, a power of two */
+} nut_nameidx_t;
+
+/* First entry of table with that name, or NULL */
+void *nut_nameidx_find(nut_nameidx_t *idx, void *table, size_t stride, size_t offset, const char *name);
+/* Next entry (in table order) with the same name as entry, or NULL */
+void *nut_nameidx_next(const nut_nameidx_t *idx, const void *entry);
+void nut_nameidx_free(nut_nameidx_t *idx);
+
+#define NUT_NAMEIDX_FIND(idx, table, type, field, name)	\
+	((type *)nut_nameidx_find((idx), (table), sizeof(type), offsetof(type, field), (name)))
+
 #ifndef HAVE_USLEEP
 /* int __cdecl usleep(unsigned int useconds); */
 /* Note: if we'd need to define an useconds_t for obscure systems,
@@ -705,6 +705,9 @@ public:
 	std::string parseCHARS();
 	std::string parseSTRCHARS();
 	Token parseToken();
+	/** Same as parseToken(), but reuses the storage of "token";
+	 *  returns whether a token was found */
+	bool parseToken(Token& token);
 	std::list<Token> parseLine();
 	/** \} */
 
@@ -1747,6 +1750,7 @@ public:
 	inline std::string getDriverPath() const { return getStr("driverpath"); }
 	inline std::string getStatePath()  const { return getStr("statepath", false); }	// NOTE: accept it case-insensitively
 	inline std::string getGroup()      const { return getStr("group"); }
+	inline std::string getPollMode()   const { return getStr("pollmode"); }
 	inline std::string getSynchronous() const { return getStr("synchronous"); }
 	inline std::string getUser()       const { return getStr("user"); }
 
@@ -1758,12 +1762,15 @@ public:
 	inline long long int getMaxRetry()      const { return getInt("maxretry"); }
 	inline long long int getMaxStartDelay() const { return getInt("maxstartdelay"); }
 	inline long long int getPollInterval()  const { return getInt("pollinterval", 5); }  // TODO: check the default
+	inline long long int getPollIntervalMin() const { return getInt("pollinterval_min"); }
+	inline long long int getPollIntervalMax() const { return getInt("pollinterval_max"); }
 	inline long long int getRetryDelay()    const { return getInt("retrydelay"); }
 
 	inline void setChroot(const std::string & path)     { setStr("chroot",     path); }
 	inline void setDriverPath(const std::string & path) { setStr("driverpath", path); }
 	inline void setStatePath(const std::string & path)  { setStr("statepath", path); }
 	inline void setGroup(const std::string & group)     { setStr("group",      group); }
+	inline void setPollMode(const std::string & mode)   { setStr("pollmode",   mode); }
 	inline void setSynchronous(const std::string & val) { setStr("synchronous", val); }
 	inline void setUser(const std::string & user)       { setStr("user",       user); }
 
@@ -1774,6 +1781,8 @@ public:
 	inline void setMaxRetry(long long int num)          { setInt("maxretry",      num); }
 	inline void setMaxStartDelay(long long int delay)   { setInt("maxstartdelay", delay); }
 	inline void setPollInterval(long long int interval) { setInt("pollinterval",  interval); }
+	inline void setPollIntervalMin(long long int interval) { setInt("pollinterval_min", interval); }
+	inline void setPollIntervalMax(long long int interval) { setInt("pollinterval_max", interval); }
 	inline void setRetryDelay(long long int delay)      { setInt("retrydelay",    delay); }
 
 	/** \} */
@@ -1874,6 +1883,7 @@ public:
 	inline std::string getSensorID(const std::string & ups)            const { return getStr(ups, "sensorid"); }
 	inline std::string getSerial(const std::string & ups)              const { return getStr(ups, "serial"); }
 	inline std::string getSerialNumber(const std::string & ups)        const { return getStr(ups, "serialnumber"); }
+	inline std::string getPollMode(const std::string & ups)            const { return getStr(ups, "pollmode"); }
 	inline std::string getShutdownArguments(const std::string & ups)   const { return getStr(ups, "shutdownArguments"); }
 	inline std::string getSNMPversion(const std::string & ups)         const { return getStr(ups, "snmp_version"); }
 	inline std::string getSubdriver(const std::string & ups)           const { return getStr(ups, "subdriver"); }
@@ -2005,6 +2015,8 @@ public:
 	inline long long int getOutputPhaseAngle(const std::string & ups)          const { return getInt(ups, "output_phase_angle"); }
 	inline long long int getPinsShutdownMode(const std::string & ups)          const { return getInt(ups, "pins_shutdown_mode"); }
 	inline long long int getPollFreq(const std::string & ups)                  const { return getInt(ups, "pollfreq"); }            // CHECKME
+	inline long long int getPollIntervalMin(const std::string & ups)           const { return getInt(ups, "pollinterval_min"); }
+	inline long long int getPollIntervalMax(const std::string & ups)           const { return getInt(ups, "pollinterval_max"); }
 	inline long long int getPowerUp(const std::string & ups)                   const { return getInt(ups, "powerup"); }             // CHECKME
 	inline long long int getPrgShut(const std::string & ups)                   const { return getInt(ups, "prgshut"); }             // CHECKME
 	inline long long int getRebootDelay(const std::string & ups)               const { return getInt(ups, "rebootdelay"); }         // CHECKME
@@ -2121,6 +2133,7 @@ public:
 	inline void setSensorID(const std::string & ups, const std::string & sensorid)            { setStr(ups, "sensorid",            sensorid); }
 	inline void setSerial(const std::string & ups, const std::string & serial)                { setStr(ups, "serial",              serial); }
 	inline void setSerialNumber(const std::string & ups, const std::string & serialnumber)    { setStr(ups, "serialnumber",        serialnumber); }
+	inline void setPollMode(const std::string & ups, const std::string & mode)                { setStr(ups, "pollmode",            mode); }
 	inline void setShutdownArguments(const std::string & ups, const std::string & sd_args)    { setStr(ups, "shutdownArguments",   sd_args); }
 	inline void setSNMPversion(const std::string & ups, const std::string & snmp_version)     { setStr(ups, "snmp_version",        snmp_version); }
 	inline void setSubdriver(const std::string & ups, const std::string & subdriver)          { setStr(ups, "subdriver",           subdriver); }
@@ -2220,6 +2233,8 @@ public:
 	inline void setOutputPhaseAngle(const std::string & ups, long long int val)               { setInt(ups, "output_phase_angle",  val); }
 	inline void setPinsShutdownMode(const std::string & ups, long long int val)               { setInt(ups, "pins_shutdown_mode",  val); }
 	inline void setPollFreq(const std::string & ups, long long int pollfreq)                  { setInt(ups, "pollfreq",            pollfreq); }     // CHECKME
+	inline void setPollIntervalMin(const std::string & ups, long long int interval)           { setInt(ups, "pollinterval_min",    interval); }
+	inline void setPollIntervalMax(const std::string & ups, long long int interval)           { setInt(ups, "pollinterval_max",    interval); }
 	inline void setPowerUp(const std::string & ups, long long int powerup)                    { setInt(ups, "powerup",             powerup); }      // CHECKME
 	inline void setPrgShut(const std::string & ups, long long int prgshut)                    { setInt(ups, "prgshut",             prgshut); }      // CHECKME
 	inline void setRebootDelay(const std::string & ups, long long int delay)                  { setInt(ups, "rebootdelay",         delay); }        // CHECKME
@@ -890,6 +890,28 @@ class NutSocket: public NutStream {
 	/** Current character cache status */
 	bool m_current_ch_valid;
 
+	/** Read-ahead buffer, so getChar() does not need a syscall per byte */
+	char m_rbuf[4096];
+
+	/** Next unread byte in \ref m_rbuf */
+	size_t m_rbuf_pos;
+
+	/** End of data in \ref m_rbuf */
+	size_t m_rbuf_len;
+
+	/**
+	 *  \brief  Refill the read-ahead buffer (when it is empty)
+	 *
+	 *  \retval NUTS_OK    if there is data in the buffer
+	 *  \retval NUTS_EOF   on end of stream
+	 *  \retval NUTS_ERROR on read error
+	 */
+	status_t fillBuffer()
+#if (defined __cplusplus) && (__cplusplus < 201100)
+		throw()
+#endif
+		;
+
 	/**
 	 *  \brief  Accept client connection on a listen socket
 	 *
@@ -1001,7 +1023,9 @@ class NutSocket: public NutStream {
 		m_domain(NUTSOCKD_UNDEFINED),
 		m_type(NUTSOCKT_UNDEFINED),
 		m_current_ch('\0'),
-		m_current_ch_valid(false)
+		m_current_ch_valid(false),
+		m_rbuf_pos(0),
+		m_rbuf_len(0)
 	{
 		accept(*this, listen_sock, err_code, err_msg);
 	}
@@ -1018,7 +1042,9 @@ class NutSocket: public NutStream {
 		m_domain(NUTSOCKD_UNDEFINED),
 		m_type(NUTSOCKT_UNDEFINED),
 		m_current_ch('\0'),
-		m_current_ch_valid(false)
+		m_current_ch_valid(false),
+		m_rbuf_pos(0),
+		m_rbuf_len(0)
 	{
 		accept(*this, listen_sock);
 	}
@@ -44,13 +44,15 @@ double difftime_st_tree_timespec(st_tree_timespec_t finish, st_tree_timespec_t s
 
 typedef struct st_tree_s {
 	char	*var;
-	char	*val;			/* points to raw or safe */
+	char	*val;			/* points to raw or safe; use
+					 * st_tree_node_getval() to read */
 
 	char	*raw;			/* raw data from caller */
 	size_t	rawsize;
 
 	char	*safe;			/* safe data from pconf_encode */
 	size_t	safesize;
+	int	safe_dirty;		/* raw changed, safe not made yet */
 
 	int	flags;
 	long	aux;
@@ -70,6 +72,7 @@ typedef struct st_tree_s {
 
 int state_get_timestamp(st_tree_timespec_t *now);
 int st_tree_node_compare_timestamp(const st_tree_t *node, const st_tree_timespec_t *cutoff);
+const char *st_tree_node_getval(const st_tree_t *node);
 int state_setinfo(st_tree_t **nptr, const char *var, const char *val);
 int state_addenum(st_tree_t *root, const char *var, const char *val);
 int state_addrange(st_tree_t *root, const char *var, const int min, const int max);
@@ -38,6 +38,9 @@ let ups_global   = "chroot"
                  | "nowait"
                  | "retrydelay"
                  | "pollinterval"
+                 | "pollinterval_min"
+                 | "pollinterval_max"
+                 | "pollmode"
                  | "synchronous"
                  | "user"
                  | "group"
@@ -55,6 +58,9 @@ let ups_fields   = "driver"
                  | "nolock"
                  | "ignorelb"
                  | "maxstartdelay"
+                 | "pollinterval_min"
+                 | "pollinterval_max"
+                 | "pollmode"
                  | "synchronous"
                  | "user"
                  | "group"
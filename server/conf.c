@@ -23,6 +23,7 @@
 #include "sstate.h"
 #include "user.h"
 #include "netssl.h"
+#include "netmetrics.h"
 #include "nut_stdint.h"
 #include <ctype.h>
 
@@ -46,11 +47,9 @@ static void ups_create(const char *fn, const char *name, const char *desc)
 {
 	upstype_t	*temp;
 
-	for (temp = firstups; temp != NULL; temp = temp->next) {
-		if (!strcasecmp(temp->name, name)) {
-			upslogx(LOG_ERR, "UPS name [%s] is already in use!", name);
-			return;
-		}
+	if (get_ups_ptr(name)) {
+		upslogx(LOG_ERR, "UPS name [%s] is already in use!", name);
+		return;
 	}
 
 	/* grab some memory and add the info */
@@ -81,9 +80,11 @@ static void ups_create(const char *fn, const char *name, const char *desc)
 
 	/* preload this to the current time to avoid false staleness */
 	time(&temp->last_heard);
+	ups_watch(temp);
 
 	temp->next = firstups;
 	firstups = temp;
+	ups_index_add(temp);
 	num_ups++;
 }
 
@@ -202,6 +203,18 @@ static int parse_upsd_conf_args(size_t numargs, char **arg)
 		}
 	}
 
+	/* CLIENT_INACTIVITY_DELAY <seconds> */
+	if (!strcmp(arg[0], "CLIENT_INACTIVITY_DELAY")) {
+		if (isdigit((size_t)arg[1][0]) && atoi(arg[1]) > 0) {
+			client_inactivity_delay = atoi(arg[1]);
+			return 1;
+		}
+		else {
+			upslogx(LOG_ERR, "CLIENT_INACTIVITY_DELAY has non numeric or zero value (%s)!", arg[1]);
+			return 0;
+		}
+	}
+
 	/* ALLOW_NO_DEVICE <bool> */
 	if (!strcmp(arg[0], "ALLOW_NO_DEVICE")) {
 		if (isdigit((size_t)arg[1][0])) {
@@ -324,6 +337,15 @@ static int parse_upsd_conf_args(size_t numargs, char **arg)
 		return 1;
 	}
 
+	/* METRICS_LISTEN <address> [<port>] */
+	if (!strcmp(arg[0], "METRICS_LISTEN")) {
+		if (numargs < 3)
+			metrics_listen_add(arg[1], string_const(METRICS_PORT));
+		else
+			metrics_listen_add(arg[1], arg[2]);
+		return 1;
+	}
+
 	/* everything below here uses up through arg[2] */
 	if (numargs < 3)
 		return 0;
@@ -561,6 +583,7 @@ static void delete_ups(upstype_t *target)
 
 			/* make sure nobody stays logged into this thing */
 			kick_login_clients(target->name);
+			ups_index_del(target);
 
 			/* about to delete the first ups? */
 			if (ptr == last)
@@ -576,8 +599,10 @@ static void delete_ups(upstype_t *target)
 #endif	/* WIN32 */
 
 			/* release memory */
+			upsd_timer_cancel(&ptr->check_timer);
 			sstate_infofree(ptr);
 			sstate_cmdfree(ptr);
+			metrics_ups_free(ptr);
 			pconf_finish(&ptr->sock_ctx);
 
 			free(ptr->fn);
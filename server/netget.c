@@ -24,6 +24,7 @@
 #include "state.h"
 #include "desc.h"
 #include "neterr.h"
+#include "stats.h"
 
 #include "netget.h"
 
@@ -263,6 +264,40 @@ static void get_var(nut_ctype_t *client, const char *upsname, const char *var)
 		sendback(client, "VAR %s %s \"%s\"\n", upsname, var, val);
 }
 
+typedef struct {
+	const char	*name;
+	char	value[SMALLBUF];
+	int	found;
+} get_stat_t;
+
+static void get_stat_one(const char *name, const char *value, void *arg)
+{
+	get_stat_t	*gs = (get_stat_t *)arg;
+
+	if (gs->found || strcasecmp(name, gs->name))
+		return;
+
+	snprintf(gs->value, sizeof(gs->value), "%s", value);
+	gs->found = 1;
+}
+
+static void get_stat(nut_ctype_t *client, const char *name)
+{
+	get_stat_t	gs;
+
+	gs.name = name;
+	gs.found = 0;
+
+	stats_foreach(get_stat_one, &gs);
+
+	if (!gs.found) {
+		send_err(client, NUT_ERR_VAR_NOT_SUPPORTED);
+		return;
+	}
+
+	sendback(client, "STAT %s \"%s\"\n", name, gs.value);
+}
+
 void net_get(nut_ctype_t *client, size_t numarg, const char **arg)
 {
 	if (numarg < 1) {
@@ -295,6 +330,12 @@ void net_get(nut_ctype_t *client, size_t numarg, const char **arg)
 		return;
 	}
 
+	/* GET STAT NAME */
+	if (!strcasecmp(arg[0], "STAT")) {
+		get_stat(client, arg[1]);
+		return;
+	}
+
 	/* GET UPSDESC UPS */
 	if (!strcasecmp(arg[0], "UPSDESC")) {
 		get_upsdesc(client, arg[1]);
@@ -25,11 +25,11 @@
 #include "sstate.h"
 #include "state.h"
 #include "neterr.h"
+#include "stats.h"
 
 #include "netlist.h"
 
 extern	upstype_t	*firstups;	/* for list_ups */
-extern	nut_ctype_t *firstclient;	/* for list_clients */
 
 static int tree_dump(st_tree_t *node, nut_ctype_t *client, const char *ups,
 	int rw, int fsd)
@@ -51,7 +51,7 @@ static int tree_dump(st_tree_t *node, nut_ctype_t *client, const char *ups,
 		/* only send this back if it's been flagged RW */
 		if (node->flags & ST_FLAG_RW) {
 			ret = sendback(client, "RW %s %s \"%s\"\n",
-				ups, node->var, node->val);
+				ups, node->var, st_tree_node_getval(node));
 
 		} else {
 			ret = 1;	/* dummy */
@@ -64,11 +64,11 @@ static int tree_dump(st_tree_t *node, nut_ctype_t *client, const char *ups,
 		/* status is always a special case */
 		if ((fsd == 1) && (!strcasecmp(node->var, "ups.status"))) {
 			ret = sendback(client, "VAR %s %s \"FSD %s\"\n",
-				ups, node->var, node->val);
+				ups, node->var, st_tree_node_getval(node));
 
 		} else {
 			ret = sendback(client, "VAR %s %s \"%s\"\n",
-				ups, node->var, node->val);
+				ups, node->var, st_tree_node_getval(node));
 		}
 	}
 
@@ -270,21 +270,49 @@ static void list_clients(nut_ctype_t *client, const char *upsname)
 	if (!sendback(client, "BEGIN LIST CLIENT %s\n", upsname))
 		return;
 
-	if (firstclient) {
-		int	ret;
-		/* show connected clients */
-		for (c = firstclient; c; c = cnext) {
-			if (c->loginups && (!ups || !strcasecmp(c->loginups, ups->name))) {
-				ret = sendback(client, "CLIENT %s %s\n", c->loginups, c->addr);
-				if (!ret)
-					return;
-			}
-			cnext = c->next;
-		}
+	/* show clients logged into this UPS */
+	for (c = ups->logins; c; c = cnext) {
+		cnext = c->login_next;
+		if (!sendback(client, "CLIENT %s %s\n", c->loginups, c->addr))
+			return;
 	}
 	sendback(client, "END LIST CLIENT %s\n", upsname);
 }
 
+typedef struct {
+	nut_ctype_t	*client;
+	int	ok;
+} list_stats_t;
+
+static void list_stats_one(const char *name, const char *value, void *arg)
+{
+	list_stats_t	*ls = (list_stats_t *)arg;
+
+	/* stop talking after the first failed write */
+	if (!ls->ok)
+		return;
+
+	ls->ok = sendback(ls->client, "STAT %s \"%s\"\n", name, value);
+}
+
+static void list_stats(nut_ctype_t *client)
+{
+	list_stats_t	ls;
+
+	if (!sendback(client, "BEGIN LIST STATS\n"))
+		return;
+
+	ls.client = client;
+	ls.ok = 1;
+
+	stats_foreach(list_stats_one, &ls);
+
+	if (!ls.ok)
+		return;
+
+	sendback(client, "END LIST STATS\n");
+}
+
 void net_list(nut_ctype_t *client, size_t numarg, const char **arg)
 {
 	if (numarg < 1) {
@@ -298,6 +326,12 @@ void net_list(nut_ctype_t *client, size_t numarg, const char **arg)
 		return;
 	}
 
+	/* LIST STATS */
+	if (!strcasecmp(arg[0], "STATS")) {
+		list_stats(client);
+		return;
+	}
+
 	if (numarg < 2) {
 		send_err(client, NUT_ERR_INVALID_ARGUMENT);
 		return;
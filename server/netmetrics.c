@@ -0,0 +1,600 @@
+/* netmetrics.c - OpenMetrics (Prometheus) exporter endpoint for upsd
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+/*
+ * This serves a read-only HTTP "GET /metrics" on the METRICS_LISTEN
+ * sockets, rendered straight from the in-memory state trees, so that
+ * monitoring systems do not need to walk the NUT protocol with LIST UPS
+ * and LIST VAR for every device on every scrape.
+ *
+ * Numeric variables of each UPS are rendered once per "generation" of
+ * its tree (bumped by sstate.c whenever the driver changes a value),
+ * and the cached text is reused until the next change.  Anything that
+ * depends on the current time (staleness, ages) is rendered per scrape.
+ */
+
+#define NUT_WANT_INET_NTOP_XX	1
+
+#include "config.h" /* must be the first header */
+#include "common.h"
+
+#include <ctype.h>
+
+#ifndef WIN32
+# include <sys/socket.h>
+# include <fcntl.h>
+#else	/* WIN32 */
+# include "wincompat.h"
+#endif	/* WIN32 */
+
+#include "upsd.h"
+#include "sstate.h"
+#include "state.h"
+#include "nut_stdint.h"
+
+#include "netmetrics.h"
+
+metrics_ctype_t	*firstmetricsclient = NULL;
+
+uint64_t	metrics_netcmds_total = 0;
+
+static uint64_t	metrics_scrapes_total = 0;
+
+/* growable text buffer for the response body */
+typedef struct {
+	char	*buf;
+	size_t	len;
+	size_t	size;
+} metrics_buf_t;
+
+static void mbuf_reserve(metrics_buf_t *mb, size_t extra)
+{
+	size_t	want = mb->len + extra + 1;
+
+	if (want <= mb->size) {
+		return;
+	}
+
+	if (mb->size < LARGEBUF) {
+		mb->size = LARGEBUF;
+	}
+
+	while (mb->size < want) {
+		mb->size *= 2;
+	}
+
+	mb->buf = xrealloc(mb->buf, mb->size);
+}
+
+static void mbuf_append(metrics_buf_t *mb, const char *s, size_t len)
+{
+	mbuf_reserve(mb, len);
+	memcpy(mb->buf + mb->len, s, len);
+	mb->len += len;
+	mb->buf[mb->len] = '\0';
+}
+
+static void mbuf_printf(metrics_buf_t *mb, const char *fmt, ...)
+	__attribute__ ((__format__ (__printf__, 2, 3)));
+
+static void mbuf_printf(metrics_buf_t *mb, const char *fmt, ...)
+{
+	va_list	ap;
+	int	ret;
+
+	mbuf_reserve(mb, SMALLBUF);
+
+	va_start(ap, fmt);
+	ret = vsnprintf(mb->buf + mb->len, mb->size - mb->len, fmt, ap);
+	va_end(ap);
+
+	if (ret < 0) {
+		mb->buf[mb->len] = '\0';
+		return;
+	}
+
+	if ((size_t)ret >= mb->size - mb->len) {
+		/* did not fit, grow and redo */
+		mbuf_reserve(mb, (size_t)ret);
+
+		va_start(ap, fmt);
+		ret = vsnprintf(mb->buf + mb->len, mb->size - mb->len, fmt, ap);
+		va_end(ap);
+
+		if (ret < 0) {
+			mb->buf[mb->len] = '\0';
+			return;
+		}
+	}
+
+	mb->len += (size_t)ret;
+}
+
+/* append a label value, escaped per the exposition format */
+static void mbuf_label(metrics_buf_t *mb, const char *s)
+{
+	const char	*p;
+
+	for (p = s; *p; p++) {
+		switch (*p) {
+		case '\\':
+			mbuf_append(mb, "\\\\", 2);
+			break;
+		case '"':
+			mbuf_append(mb, "\\\"", 2);
+			break;
+		case '\n':
+			mbuf_append(mb, "\\n", 2);
+			break;
+		default:
+			mbuf_append(mb, p, 1);
+			break;
+		}
+	}
+}
+
+static void mbuf_family(metrics_buf_t *mb, const char *name, const char *type, const char *help)
+{
+	mbuf_printf(mb, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/* only plain decimal numbers are exported: "12", "-3.5", "2.1e3";
+ * things like serial numbers in hex or "inf" are not metrics */
+static int metrics_isnumeric(const char *s)
+{
+	int	digits = 0;
+
+	if (*s == '-' || *s == '+') {
+		s++;
+	}
+
+	for (; isdigit((unsigned char)*s); s++) {
+		digits++;
+	}
+
+	if (*s == '.') {
+		for (s++; isdigit((unsigned char)*s); s++) {
+			digits++;
+		}
+	}
+
+	if (!digits) {
+		return 0;
+	}
+
+	if (*s == 'e' || *s == 'E') {
+		s++;
+
+		if (*s == '-' || *s == '+') {
+			s++;
+		}
+
+		if (!isdigit((unsigned char)*s)) {
+			return 0;
+		}
+
+		for (; isdigit((unsigned char)*s); s++);
+	}
+
+	return (*s == '\0');
+}
+
+static void render_tree(metrics_buf_t *mb, const st_tree_t *node, const char *upsname)
+{
+	if (!node) {
+		return;
+	}
+
+	render_tree(mb, node->left, upsname);
+
+	if (metrics_isnumeric(node->raw)) {
+		mbuf_append(mb, "nut_variable{ups=\"", 18);
+		mbuf_label(mb, upsname);
+		mbuf_append(mb, "\",variable=\"", 12);
+		mbuf_label(mb, node->var);
+		mbuf_printf(mb, "\"} %s\n", node->raw);
+	}
+
+	render_tree(mb, node->right, upsname);
+}
+
+/* return the cached numeric variables of a UPS, re-rendering if needed */
+static const char *metrics_ups_vars(upstype_t *ups, size_t *len)
+{
+	if (!ups->metrics_cache || ups->metrics_cachegen != ups->generation) {
+		metrics_buf_t	mb;
+
+		mb.buf = ups->metrics_cache;
+		mb.len = 0;
+		mb.size = ups->metrics_cachesize;
+
+		mbuf_reserve(&mb, 0);
+		render_tree(&mb, ups->inforoot, ups->name);
+
+		ups->metrics_cache = mb.buf;
+		ups->metrics_cachesize = mb.size;
+		ups->metrics_cachelen = mb.len;
+		ups->metrics_cachegen = ups->generation;
+
+		upsdebugx(5, "%s: re-rendered UPS [%s] generation %" PRIu64 " (%" PRIuSIZE " bytes)",
+			__func__, ups->name, ups->generation, mb.len);
+	}
+
+	*len = ups->metrics_cachelen;
+	return ups->metrics_cache;
+}
+
+static int ups_serving(const upstype_t *ups)
+{
+	return (VALID_FD(ups->sock_fd) && !ups->stale);
+}
+
+static void metrics_render(metrics_buf_t *mb)
+{
+	upstype_t	*ups;
+	nut_ctype_t	*client;
+	size_t	numclients = 0, numups = 0;
+	time_t	now;
+
+	time(&now);
+
+	for (client = firstclient; client; client = client->next) {
+		numclients++;
+	}
+
+	for (ups = firstups; ups; ups = ups->next) {
+		numups++;
+	}
+
+	mbuf_family(mb, "nut_upsd_info", "gauge", "Version of the NUT data server.");
+	mbuf_append(mb, "nut_upsd_info{version=\"", 23);
+	mbuf_label(mb, UPS_VERSION);
+	mbuf_append(mb, "\"} 1\n", 5);
+
+	mbuf_family(mb, "nut_upsd_clients", "gauge", "NUT protocol clients currently connected.");
+	mbuf_printf(mb, "nut_upsd_clients %" PRIuSIZE "\n", numclients);
+
+	mbuf_family(mb, "nut_upsd_devices", "gauge", "Devices configured in ups.conf.");
+	mbuf_printf(mb, "nut_upsd_devices %" PRIuSIZE "\n", numups);
+
+	mbuf_family(mb, "nut_upsd_commands_total", "counter", "NUT protocol commands processed.");
+	mbuf_printf(mb, "nut_upsd_commands_total %" PRIu64 "\n", metrics_netcmds_total);
+
+	mbuf_family(mb, "nut_upsd_metrics_scrapes_total", "counter", "Requests served by this endpoint.");
+	mbuf_printf(mb, "nut_upsd_metrics_scrapes_total %" PRIu64 "\n", metrics_scrapes_total);
+
+	mbuf_family(mb, "nut_driver_connected", "gauge", "Whether upsd is connected to the driver socket.");
+	for (ups = firstups; ups; ups = ups->next) {
+		mbuf_append(mb, "nut_driver_connected{ups=\"", 26);
+		mbuf_label(mb, ups->name);
+		mbuf_printf(mb, "\"} %d\n", VALID_FD(ups->sock_fd) ? 1 : 0);
+	}
+
+	/* ups->stale is maintained by mainloop() from sstate_dead() */
+	mbuf_family(mb, "nut_driver_stale", "gauge", "Whether the data from the driver is considered stale.");
+	for (ups = firstups; ups; ups = ups->next) {
+		mbuf_append(mb, "nut_driver_stale{ups=\"", 22);
+		mbuf_label(mb, ups->name);
+		mbuf_printf(mb, "\"} %d\n", ups_serving(ups) ? 0 : 1);
+	}
+
+	mbuf_family(mb, "nut_driver_last_heard_seconds", "gauge", "Seconds since the driver last said something.");
+	for (ups = firstups; ups; ups = ups->next) {
+		if (INVALID_FD(ups->sock_fd)) {
+			continue;
+		}
+
+		mbuf_append(mb, "nut_driver_last_heard_seconds{ups=\"", 35);
+		mbuf_label(mb, ups->name);
+		mbuf_printf(mb, "\"} %.0f\n", difftime(now, ups->last_heard));
+	}
+
+	mbuf_family(mb, "nut_ups_status", "gauge", "Flags currently present in ups.status.");
+	for (ups = firstups; ups; ups = ups->next) {
+		const char	*status, *p;
+
+		if (!ups_serving(ups)) {
+			continue;
+		}
+
+		if (ups->fsd) {
+			mbuf_append(mb, "nut_ups_status{ups=\"", 20);
+			mbuf_label(mb, ups->name);
+			mbuf_append(mb, "\",flag=\"FSD\"} 1\n", 16);
+		}
+
+		status = sstate_getinfo(ups, "ups.status");
+		for (p = status; p && *p; ) {
+			size_t	len = strcspn(p, " ");
+
+			if (len > 0) {
+				mbuf_append(mb, "nut_ups_status{ups=\"", 20);
+				mbuf_label(mb, ups->name);
+				mbuf_append(mb, "\",flag=\"", 8);
+				mbuf_append(mb, p, len);
+				mbuf_append(mb, "\"} 1\n", 5);
+			}
+
+			p += len;
+			p += strspn(p, " ");
+		}
+	}
+
+	mbuf_family(mb, "nut_variable", "gauge", "Numeric NUT variables reported by the driver.");
+	for (ups = firstups; ups; ups = ups->next) {
+		const char	*vars;
+		size_t	len;
+
+		if (!ups_serving(ups)) {
+			continue;
+		}
+
+		vars = metrics_ups_vars(ups, &len);
+		mbuf_append(mb, vars, len);
+	}
+}
+
+/* try to send the rest of the pending response without blocking;
+ * returns 1 when all is out, 0 if more is to come, -1 on errors */
+static int metrics_flush(metrics_ctype_t *client)
+{
+	while (client->respsent < client->resplen) {
+		ssize_t	ret = write(client->sock_fd,
+			client->resp + client->respsent,
+			client->resplen - client->respsent);
+
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				/* slow reader: the mainloop polls for POLLOUT */
+				return 0;
+			}
+
+			upsdebug_with_errno(2, "%s: write() failed for %s", __func__, client->addr);
+			return -1;
+		}
+
+		client->respsent += (size_t)ret;
+	}
+
+	return 1;
+}
+
+/* queue the response; it is sent by metrics_flush() as the socket allows */
+static void metrics_reply(metrics_ctype_t *client, int code, const char *reason,
+	const char *body, size_t bodylen, int headonly)
+{
+	metrics_buf_t	mb;
+
+	mb.buf = NULL;
+	mb.len = 0;
+	mb.size = 0;
+
+	mbuf_printf(&mb,
+		"HTTP/1.0 %d %s\r\n"
+		"Content-Type: %s\r\n"
+		"Content-Length: %" PRIuSIZE "\r\n"
+		"Connection: close\r\n"
+		"\r\n",
+		code, reason,
+		(code == 200) ? "text/plain; version=0.0.4; charset=utf-8" : "text/plain",
+		bodylen);
+
+	if (!headonly && bodylen) {
+		mbuf_append(&mb, body, bodylen);
+	}
+
+	free(client->resp);
+	client->resp = mb.buf;
+	client->resplen = mb.len;
+	client->respsent = 0;
+	time(&client->resp_started);
+}
+
+static void metrics_handle_request(metrics_ctype_t *client)
+{
+	char	*method, *path, *p;
+	int	headonly = 0;
+
+	/* "METHOD /path HTTP/1.x" - we only care about the first two words */
+	method = client->req;
+	p = method + strcspn(method, " \r\n");
+
+	if (*p != ' ') {
+		metrics_reply(client, 400, "Bad Request", "Bad Request\n", 12, 0);
+		return;
+	}
+
+	*p++ = '\0';
+	path = p;
+	path[strcspn(path, " ?\r\n")] = '\0';
+
+	upsdebugx(3, "%s: %s requested %s %s", __func__, client->addr, method, path);
+
+	if (!strcmp(method, "HEAD")) {
+		headonly = 1;
+	} else if (strcmp(method, "GET")) {
+		metrics_reply(client, 405, "Method Not Allowed", "Method Not Allowed\n", 19, 0);
+		return;
+	}
+
+	if (strcmp(path, "/metrics")) {
+		metrics_reply(client, 404, "Not Found", "Not Found\n", 10, headonly);
+		return;
+	}
+
+	{ /* scoping */
+		metrics_buf_t	mb;
+
+		mb.buf = NULL;
+		mb.len = 0;
+		mb.size = 0;
+
+		metrics_scrapes_total++;
+		metrics_render(&mb);
+		metrics_reply(client, 200, "OK", mb.buf, mb.len, headonly);
+
+		free(mb.buf);
+	}
+}
+
+/* interface */
+
+void metrics_client_connect(stype_t *server)
+{
+	struct	sockaddr_storage csock;
+#if defined(__hpux) && !defined(_XOPEN_SOURCE_EXTENDED)
+	int	clen;
+#else
+	socklen_t	clen;
+#endif
+	int	fd;
+	metrics_ctype_t	*client;
+
+	clen = sizeof(csock);
+	fd = accept(server->sock_fd, (struct sockaddr *) &csock, &clen);
+
+	if (fd < 0) {
+		return;
+	}
+
+#ifndef WIN32
+	{ /* scoping */
+		/* the answer is flushed from the mainloop as the peer reads it,
+		 * so a stuck scraper can not block the whole server in write() */
+		int	flags = fcntl(fd, F_GETFL, 0);
+
+		if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+			upslog_with_errno(LOG_ERR, "%s: fcntl set O_NONBLOCK failed", __func__);
+			close(fd);
+			return;
+		}
+	}
+#endif	/* !WIN32 */
+
+	client = xcalloc(1, sizeof(*client));
+
+	client->sock_fd = fd;
+	time(&client->last_heard);
+	client->addr = xstrdup(inet_ntopSS(&csock));
+
+	if (firstmetricsclient) {
+		firstmetricsclient->prev = client;
+		client->next = firstmetricsclient;
+	}
+
+	firstmetricsclient = client;
+
+	upsdebugx(2, "Metrics connect from %s", client->addr);
+}
+
+void metrics_client_disconnect(metrics_ctype_t *client)
+{
+	if (!client) {
+		return;
+	}
+
+	upsdebugx(2, "Metrics disconnect from %s", client->addr);
+
+	shutdown(client->sock_fd, 2);
+	close(client->sock_fd);
+
+	if (client->prev) {
+		client->prev->next = client->next;
+	} else {
+		/* deleting first entry */
+		firstmetricsclient = client->next;
+	}
+
+	if (client->next) {
+		client->next->prev = client->prev;
+	}
+
+	free(client->resp);
+	free(client->addr);
+	free(client);
+}
+
+void metrics_client_write(metrics_ctype_t *client)
+{
+	if (!client->resp || metrics_flush(client)) {
+		/* all sent, or failed */
+		metrics_client_disconnect(client);
+	}
+}
+
+int metrics_client_expired(const metrics_ctype_t *client, time_t now)
+{
+	if (client->resp) {
+		return (difftime(now, client->resp_started) > METRICS_SEND_TIMEOUT);
+	}
+
+	return (difftime(now, client->last_heard) > METRICS_CLIENT_TIMEOUT);
+}
+
+void metrics_client_readline(metrics_ctype_t *client)
+{
+	ssize_t	ret;
+	size_t	avail = sizeof(client->req) - client->reqlen - 1;
+
+	ret = read(client->sock_fd, client->req + client->reqlen, avail);
+
+	if (ret <= 0) {
+		upsdebugx(2, "Metrics disconnect %s (%s)", client->addr,
+			ret ? "read failure" : "no data available");
+		metrics_client_disconnect(client);
+		return;
+	}
+
+	client->reqlen += (size_t)ret;
+	client->req[client->reqlen] = '\0';
+	time(&client->last_heard);
+
+	/* wait for the whole header block; we do not accept request bodies */
+	if (strstr(client->req, "\r\n\r\n") || strstr(client->req, "\n\n")) {
+		metrics_handle_request(client);
+	} else if (client->reqlen >= sizeof(client->req) - 1) {
+		metrics_reply(client, 431, "Request Header Fields Too Large", NULL, 0, 0);
+	} else {
+		return;
+	}
+
+	/* usually it all fits in the socket buffer right away */
+	metrics_client_write(client);
+}
+
+void metrics_client_free(void)
+{
+	metrics_ctype_t	*client, *cnext;
+
+	for (client = firstmetricsclient; client; client = cnext) {
+		cnext = client->next;
+		metrics_client_disconnect(client);
+	}
+}
+
+void metrics_ups_free(upstype_t *ups)
+{
+	free(ups->metrics_cache);
+
+	ups->metrics_cache = NULL;
+	ups->metrics_cachesize = 0;
+	ups->metrics_cachelen = 0;
+}
@@ -0,0 +1,99 @@
+/* netmetrics.h - OpenMetrics (Prometheus) exporter endpoint for upsd
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef NUT_NETMETRICS_H_SEEN
+#define NUT_NETMETRICS_H_SEEN 1
+
+#include "common.h"
+#include "nut_stdint.h"
+#include "stype.h"
+#include "upstype.h"
+
+/* default TCP port for METRICS_LISTEN lines which do not specify one;
+ * this is the port commonly used by external NUT exporters as well */
+#define METRICS_PORT	9199
+
+/* how much of an HTTP request we are willing to buffer (headers only) */
+#define METRICS_REQ_MAX	2048
+
+/* drop HTTP clients which did not complete a request in this many seconds */
+#define METRICS_CLIENT_TIMEOUT	10
+
+/* drop HTTP clients which did not read the whole response in this many
+ * seconds after it was ready (slow or stuck scrapers) */
+#define METRICS_SEND_TIMEOUT	5
+
+#ifdef __cplusplus
+/* *INDENT-OFF* */
+extern "C" {
+/* *INDENT-ON* */
+#endif
+
+/* HTTP client connected to one of the METRICS_LISTEN sockets */
+typedef struct metrics_ctype_s {
+	char	*addr;
+	TYPE_FD_SOCK	sock_fd;
+	time_t	last_heard;
+
+	char	req[METRICS_REQ_MAX];
+	size_t	reqlen;
+
+	/* response being sent, flushed from the mainloop as the
+	 * (non-blocking) socket accepts it; NULL while reading */
+	char	*resp;
+	size_t	resplen;
+	size_t	respsent;
+	time_t	resp_started;
+
+	/* doubly linked list */
+	struct metrics_ctype_s	*prev;
+	struct metrics_ctype_s	*next;
+} metrics_ctype_t;
+
+extern metrics_ctype_t	*firstmetricsclient;
+
+/* total amount of commands dispatched by parse_net(), for the exporter */
+extern uint64_t	metrics_netcmds_total;
+
+/* answer an incoming connection on a METRICS_LISTEN socket */
+void metrics_client_connect(stype_t *server);
+
+/* read (part of) an HTTP request, and answer it when complete */
+void metrics_client_readline(metrics_ctype_t *client);
+
+/* send more of a pending response, and close when it is all out */
+void metrics_client_write(metrics_ctype_t *client);
+
+/* check whether a client should be dropped for taking too long */
+int metrics_client_expired(const metrics_ctype_t *client, time_t now);
+
+/* close the connection and free all related memory */
+void metrics_client_disconnect(metrics_ctype_t *client);
+
+/* disconnect all HTTP clients (e.g. when exiting) */
+void metrics_client_free(void);
+
+/* release the cached rendering of a UPS (when it is forgotten) */
+void metrics_ups_free(upstype_t *ups);
+
+#ifdef __cplusplus
+/* *INDENT-OFF* */
+}
+/* *INDENT-ON* */
+#endif
+
+#endif	/* NUT_NETMETRICS_H_SEEN */
@@ -223,7 +223,7 @@ void net_set(nut_ctype_t *client, size_t numarg, const char **arg)
 			client->tracking = 0;
 			/* then only disable the general one if no other clients use it!
 			 * Note: don't call tracking_free() since we want info to
-			 * persist, and tracking_cleanup() takes care of cleaning */
+			 * persist, and their TRACKINGDELAY timers take care of cleaning */
 			if (tracking_disable()) {
 				upsdebugx(2, "%s: TRACKING disabled for one client, more remain.", __func__);
 			} else {
@@ -59,8 +59,7 @@ void net_login(nut_ctype_t *client, size_t numarg, const char **arg)
 		return;
 	}
 
-	ups->numlogins++;
-	client->loginups = xstrdup(ups->name);
+	ups_login(ups, client);
 
 	upslogx(LOG_INFO, "User %s@%s logged into UPS [%s]%s", client->username, client->addr,
 		client->loginups, client->ssl ? " (SSL)" : "");
@@ -82,7 +81,9 @@ void net_logout(nut_ctype_t *client, size_t numarg, const char **arg)
 
 	sendback(client, "OK Goodbye\n");
 
+	/* disconnect on the next pass of mainloop() */
 	client->last_heard = 0;
+	upsd_timer_set(&client->idle_timer, 0);
 }
 
 /* NOTE: Protocol updated since NUT 2.8.0 to handle master/primary
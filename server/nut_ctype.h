@@ -38,6 +38,8 @@
 #endif
 
 #include "parseconf.h"
+#include "nut_stdint.h"
+#include "timers.h"
 
 #ifdef __cplusplus
 /* *INDENT-OFF* */
@@ -50,6 +52,7 @@ typedef struct nut_ctype_s {
 	char	*addr;
 	TYPE_FD_SOCK	sock_fd;
 	time_t	last_heard;
+	upsd_timer_t	idle_timer;	/* disconnect when inactive */
 	char	*loginups;
 	char	*password;
 	char	*username;
@@ -68,9 +71,18 @@ typedef struct nut_ctype_s {
 
 	PCONF_CTX_t	ctx;
 
+	/* accounting for LIST STATS */
+	uint64_t	stat_bytes_in;
+	uint64_t	stat_bytes_out;
+	uint64_t	stat_commands;
+
 	/* doubly linked list */
 	struct nut_ctype_s	*prev;
 	struct nut_ctype_s	*next;
+
+	/* clients logged into the same UPS (see upstype_t) */
+	struct nut_ctype_s	*login_prev;
+	struct nut_ctype_s	*login_next;
 #ifdef WIN32
 	HANDLE Event;
 #endif	/* WIN32 */
@@ -85,7 +85,8 @@ static int parse_args(upstype_t *ups, size_t numargs, char **arg)
 
 	/* DELINFO <var> */
 	if (!strcasecmp(arg[0], "DELINFO")) {
-		state_delinfo(&ups->inforoot, arg[1]);
+		if (state_delinfo(&ups->inforoot, arg[1]) > 0)
+			ups->generation++;
 		return 1;
 	}
 
@@ -100,7 +101,8 @@ static int parse_args(upstype_t *ups, size_t numargs, char **arg)
 
 	/* SETINFO <varname> <value> */
 	if (!strcasecmp(arg[0], "SETINFO")) {
-		state_setinfo(&ups->inforoot, arg[1], arg[2]);
+		if (state_setinfo(&ups->inforoot, arg[1], arg[2]) > 0)
+			ups->generation++;
 		return 1;
 	}
 
@@ -335,6 +337,7 @@ TYPE_FD sstate_connect(upstype_t *ups)
 
 	/* set ups.status to "WAIT" while waiting for the driver response to dumpcmd */
 	state_setinfo(&ups->inforoot, "ups.status", "WAIT");
+	ups->generation++;
 
 	upslogx(LOG_INFO, "Connected to UPS [%s]: %s", ups->name, ups->fn);
 
@@ -363,7 +366,8 @@ void sstate_disconnect(upstype_t *ups)
 
 void sstate_readline(upstype_t *ups)
 {
-	ssize_t	i, ret;
+	ssize_t	ret;
+	size_t	i, used;
 
 #ifndef WIN32
 	char	buf[SMALLBUF];
@@ -399,11 +403,18 @@ void sstate_readline(upstype_t *ups)
 	ret = bytesRead;
 #endif	/* WIN32 */
 
-	for (i = 0; i < ret; i++) {
+	ups->stat_reads++;
+	if (ret > 0) {
+		ups->stat_bytes += (uint64_t)ret;
+	}
+
+	for (i = 0; ret > 0 && i < (size_t)ret; i += used) {
 
-		switch (pconf_char(&ups->sock_ctx, buf[i]))
+		switch (pconf_buffer(&ups->sock_ctx, buf + i, (size_t)ret - i, &used))
 		{
 		case 1:
+			ups->stat_lines++;
+
 			/* set the 'last heard' time to now for later staleness checks */
 			if (parse_args(ups, ups->sock_ctx.numargs, ups->sock_ctx.arglist)) {
 				time(&ups->last_heard);
@@ -415,6 +426,7 @@ void sstate_readline(upstype_t *ups)
 
 		default:
 			/* parse error */
+			ups->stat_parse_errors++;
 			upslogx(LOG_NOTICE, "Parse error on sock: %s", ups->sock_ctx.errmsg);
 			return;
 		}
@@ -511,6 +523,7 @@ void sstate_infofree(upstype_t *ups)
 	state_infofree(ups->inforoot);
 
 	ups->inforoot = NULL;
+	ups->generation++;
 }
 
 void sstate_cmdfree(upstype_t *ups)
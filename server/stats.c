@@ -0,0 +1,198 @@
+/* stats.c - upsd self-instrumentation counters
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+/*
+ * upsd is single-threaded, so these are plain counters updated in place:
+ * no locks and no atomics are needed, and the cost per command is a
+ * couple of clock reads and a few increments - cheap enough to always
+ * keep it enabled.  Per-driver and per-client counters live in upstype_t
+ * and nut_ctype_t respectively; this file keeps the server-wide ones and
+ * knows how to present all of them.
+ */
+
+#include "config.h" /* must be the first header */
+#include "common.h"
+
+#include "upsd.h"
+#include "upstype.h"
+#include "nut_ctype.h"
+#include "nut_stdint.h"
+
+#include "stats.h"
+
+typedef struct {
+	const char	*name;	/* points into netcmds[] */
+	nut_latency_t	lat;
+} stats_cmd_t;
+
+static stats_cmd_t	*cmdstats = NULL;
+static size_t	numcmdstats = 0;
+
+static uint64_t	unknown_cmds = 0;
+
+static uint64_t	sendback_count = 0;
+static uint64_t	sendback_bytes = 0;
+static uint64_t	sendback_short = 0;
+static uint64_t	sendback_failed = 0;
+
+static time_t	stats_since = 0;
+
+static void stats_emit(stats_cb_t cb, void *arg, const char *name, uint64_t value)
+{
+	char	val[SMALLBUF];
+
+	snprintf(val, sizeof(val), "%" PRIu64, value);
+	cb(name, val, arg);
+}
+
+/* interface */
+
+void stats_init(void)
+{
+	time(&stats_since);
+}
+
+void stats_netcmd(size_t cmdnum, const char *name, double elapsed)
+{
+	if (cmdnum >= numcmdstats) {
+		cmdstats = xrealloc(cmdstats, (cmdnum + 1) * sizeof(*cmdstats));
+		memset(&cmdstats[numcmdstats], 0,
+			(cmdnum + 1 - numcmdstats) * sizeof(*cmdstats));
+		numcmdstats = cmdnum + 1;
+	}
+
+	cmdstats[cmdnum].name = name;
+	nut_latency_add(&cmdstats[cmdnum].lat, elapsed);
+}
+
+void stats_netcmd_unknown(void)
+{
+	unknown_cmds++;
+}
+
+void stats_sendback(size_t len, ssize_t res)
+{
+	sendback_count++;
+
+	if (res < 0) {
+		sendback_failed++;
+		return;
+	}
+
+	sendback_bytes += (uint64_t)res;
+
+	if ((size_t)res != len) {
+		sendback_short++;
+	}
+}
+
+void stats_foreach(stats_cb_t cb, void *arg)
+{
+	char	name[SMALLBUF];
+	size_t	i;
+	upstype_t	*ups;
+	nut_ctype_t	*client;
+	uint64_t	numclients = 0;
+	time_t	now;
+
+	time(&now);
+
+	for (client = firstclient; client; client = client->next) {
+		numclients++;
+	}
+
+	stats_emit(cb, arg, "server.uptime", (uint64_t)difftime(now, stats_since));
+	stats_emit(cb, arg, "server.clients", numclients);
+
+	for (i = 0; i < numcmdstats; i++) {
+		const nut_latency_t	*lat = &cmdstats[i].lat;
+
+		if (!cmdstats[i].name) {
+			continue;	/* never seen */
+		}
+
+		snprintf(name, sizeof(name), "command.%s.count", cmdstats[i].name);
+		stats_emit(cb, arg, name, lat->count);
+
+		snprintf(name, sizeof(name), "command.%s.usec.avg", cmdstats[i].name);
+		stats_emit(cb, arg, name, nut_latency_avg(lat));
+
+		snprintf(name, sizeof(name), "command.%s.usec.p50", cmdstats[i].name);
+		stats_emit(cb, arg, name, nut_latency_percentile(lat, 50));
+
+		snprintf(name, sizeof(name), "command.%s.usec.p99", cmdstats[i].name);
+		stats_emit(cb, arg, name, nut_latency_percentile(lat, 99));
+
+		snprintf(name, sizeof(name), "command.%s.usec.max", cmdstats[i].name);
+		stats_emit(cb, arg, name, lat->usec_max);
+	}
+
+	stats_emit(cb, arg, "command.unknown.count", unknown_cmds);
+
+	stats_emit(cb, arg, "sendback.count", sendback_count);
+	stats_emit(cb, arg, "sendback.bytes", sendback_bytes);
+	stats_emit(cb, arg, "sendback.short", sendback_short);
+	stats_emit(cb, arg, "sendback.failed", sendback_failed);
+
+	for (ups = firstups; ups; ups = ups->next) {
+		snprintf(name, sizeof(name), "driver.%s.reads", ups->name);
+		stats_emit(cb, arg, name, ups->stat_reads);
+
+		snprintf(name, sizeof(name), "driver.%s.bytes", ups->name);
+		stats_emit(cb, arg, name, ups->stat_bytes);
+
+		snprintf(name, sizeof(name), "driver.%s.lines", ups->name);
+		stats_emit(cb, arg, name, ups->stat_lines);
+
+		snprintf(name, sizeof(name), "driver.%s.parse_errors", ups->name);
+		stats_emit(cb, arg, name, ups->stat_parse_errors);
+	}
+
+	/* clients have no names, so tell them apart by address and socket */
+	for (client = firstclient; client; client = client->next) {
+		snprintf(name, sizeof(name), "client.%s.%d.bytes_in",
+			client->addr, (int)client->sock_fd);
+		stats_emit(cb, arg, name, client->stat_bytes_in);
+
+		snprintf(name, sizeof(name), "client.%s.%d.bytes_out",
+			client->addr, (int)client->sock_fd);
+		stats_emit(cb, arg, name, client->stat_bytes_out);
+
+		snprintf(name, sizeof(name), "client.%s.%d.commands",
+			client->addr, (int)client->sock_fd);
+		stats_emit(cb, arg, name, client->stat_commands);
+	}
+}
+
+static void stats_dump_one(const char *name, const char *value, void *arg)
+{
+	NUT_UNUSED_VARIABLE(arg);
+	upslogx(LOG_INFO, "STAT %s %s", name, value);
+}
+
+void stats_dump(void)
+{
+	upslogx(LOG_INFO, "Dumping server statistics");
+	stats_foreach(stats_dump_one, NULL);
+}
+
+void stats_free(void)
+{
+	free(cmdstats);
+	cmdstats = NULL;
+	numcmdstats = 0;
+}
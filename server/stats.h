@@ -0,0 +1,60 @@
+/* stats.h - upsd self-instrumentation counters
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef NUT_STATS_H_SEEN
+#define NUT_STATS_H_SEEN 1
+
+#include "common.h"
+#include "nut_stdint.h"
+
+#ifdef __cplusplus
+/* *INDENT-OFF* */
+extern "C" {
+/* *INDENT-ON* */
+#endif
+
+/* callback for stats_foreach(): one named value at a time */
+typedef void (*stats_cb_t)(const char *name, const char *value, void *arg);
+
+/* note the start of accounting (for server.uptime) */
+void stats_init(void);
+
+/* account one dispatch of netcmds[cmdnum] which took "elapsed" seconds */
+void stats_netcmd(size_t cmdnum, const char *name, double elapsed);
+
+/* account a line which did not match any entry in netcmds[] */
+void stats_netcmd_unknown(void);
+
+/* account one sendback() of "len" bytes, with write() result "res" */
+void stats_sendback(size_t len, ssize_t res);
+
+/* walk all known counters (server, commands, drivers, clients) */
+void stats_foreach(stats_cb_t cb, void *arg);
+
+/* log all counters, e.g. when asked to by a signal */
+void stats_dump(void);
+
+/* release memory used for accounting */
+void stats_free(void);
+
+#ifdef __cplusplus
+/* *INDENT-OFF* */
+}
+/* *INDENT-ON* */
+#endif
+
+#endif	/* NUT_STATS_H_SEEN */
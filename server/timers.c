@@ -0,0 +1,222 @@
+/* timers.c - upsd housekeeping timers
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+/*
+ * A two-level timer wheel with one-second ticks: the inner level has a
+ * slot for each of the next 64 seconds, the outer one a slot for each of
+ * the next 64 spans of 64 seconds, whose timers are moved ("cascaded")
+ * to the inner level when their span begins.  Timers further away than
+ * that are parked in the last outer slot and looked at again when it
+ * comes around.  Arming, re-arming and cancelling are O(1), and each
+ * second only the timers of its own slot are visited, so the cost of
+ * upsd housekeeping no longer grows with the number of devices, clients
+ * and tracking entries it would otherwise scan on every event.
+ *
+ * upsd is single-threaded, so there is no locking here.
+ */
+
+#include "config.h" /* must be the first header */
+#include "common.h"
+
+#include "timers.h"
+
+#define TW_BITS	6
+#define TW_SIZE	(1 << TW_BITS)
+#define TW_MASK	(TW_SIZE - 1)
+
+static upsd_timer_t	*tw_inner[TW_SIZE];
+static upsd_timer_t	*tw_outer[TW_SIZE];
+static upsd_timer_t	*tw_due = NULL;	/* fire on the next run */
+
+/* the last second processed */
+static time_t	tw_now = 0;
+
+static void tw_link(upsd_timer_t **head, upsd_timer_t *timer)
+{
+	timer->head = head;
+	timer->prev = NULL;
+	timer->next = *head;
+
+	if (*head)
+		(*head)->prev = timer;
+
+	*head = timer;
+}
+
+static void tw_unlink(upsd_timer_t *timer)
+{
+	if (timer->prev)
+		timer->prev->next = timer->next;
+	else
+		*timer->head = timer->next;
+
+	if (timer->next)
+		timer->next->prev = timer->prev;
+
+	timer->head = NULL;
+	timer->prev = NULL;
+	timer->next = NULL;
+}
+
+static void tw_insert(upsd_timer_t *timer)
+{
+	time_t	delta = timer->expires - tw_now;
+
+	if (delta <= 0) {
+		tw_link(&tw_due, timer);
+		return;
+	}
+
+	if (delta < TW_SIZE) {
+		tw_link(&tw_inner[timer->expires & TW_MASK], timer);
+		return;
+	}
+
+	if (delta < TW_SIZE * TW_SIZE) {
+		tw_link(&tw_outer[(timer->expires >> TW_BITS) & TW_MASK], timer);
+		return;
+	}
+
+	/* too far away: park it in the outer slot that comes up last */
+	tw_link(&tw_outer[((tw_now >> TW_BITS) + TW_SIZE - 1) & TW_MASK], timer);
+}
+
+/* call back everything on a list, taking it over first so that
+ * timers re-armed by callbacks wait for the next round */
+static void tw_fire(upsd_timer_t **head)
+{
+	upsd_timer_t	*list = *head, *timer;
+
+	*head = NULL;
+
+	if (list)
+		list->head = &list;
+
+	while ((timer = list) != NULL) {
+		list = timer->next;
+		if (list) {
+			list->prev = NULL;
+			list->head = &list;
+		}
+
+		timer->head = NULL;
+		timer->next = NULL;
+
+		timer->callback(timer->data);
+	}
+}
+
+/* clock jumped: keep what was left of each timer from the new "now" */
+static void tw_rebase(time_t now)
+{
+	upsd_timer_t	*all = NULL, *timer;
+	time_t	shift = now - tw_now;
+	size_t	i;
+
+	upsdebugx(1, "%s: clock jumped by %.0f seconds",
+		__func__, difftime(now, tw_now));
+
+	for (i = 0; i < TW_SIZE; i++) {
+		while ((timer = tw_inner[i]) != NULL) {
+			tw_unlink(timer);
+			tw_link(&all, timer);
+		}
+
+		while ((timer = tw_outer[i]) != NULL) {
+			tw_unlink(timer);
+			tw_link(&all, timer);
+		}
+	}
+
+	tw_now = now;
+
+	while ((timer = all) != NULL) {
+		tw_unlink(timer);
+		timer->expires += shift;
+		tw_insert(timer);
+	}
+}
+
+void upsd_timer_init(upsd_timer_t *timer, void (*callback)(void *data), void *data)
+{
+	memset(timer, 0, sizeof(*timer));
+	timer->callback = callback;
+	timer->data = data;
+}
+
+void upsd_timer_set(upsd_timer_t *timer, time_t expires)
+{
+	if (!tw_now)
+		time(&tw_now);
+
+	if (timer->head)
+		tw_unlink(timer);
+
+	timer->expires = expires;
+	tw_insert(timer);
+}
+
+void upsd_timer_cancel(upsd_timer_t *timer)
+{
+	if (timer->head)
+		tw_unlink(timer);
+}
+
+void upsd_timers_run(time_t now)
+{
+	if (!tw_now)
+		tw_now = now;
+
+	if ((now < tw_now) || (now - tw_now > TW_SIZE * TW_SIZE))
+		tw_rebase(now);
+
+	tw_fire(&tw_due);
+
+	while (tw_now < now) {
+		tw_now++;
+
+		/* a new span of the outer level begins */
+		if (!(tw_now & TW_MASK)) {
+			upsd_timer_t	**head = &tw_outer[(tw_now >> TW_BITS) & TW_MASK], *timer;
+
+			while ((timer = *head) != NULL) {
+				tw_unlink(timer);
+				tw_insert(timer);
+			}
+		}
+
+		tw_fire(&tw_inner[tw_now & TW_MASK]);
+
+		/* anything cascaded right into this second */
+		tw_fire(&tw_due);
+	}
+}
+
+int upsd_timers_wait(int maxwait)
+{
+	int	i;
+
+	if (tw_due)
+		return 0;
+
+	for (i = 1; i < TW_SIZE && i * 1000 < maxwait; i++) {
+		if (tw_inner[(tw_now + i) & TW_MASK])
+			return i * 1000;
+	}
+
+	return maxwait;
+}
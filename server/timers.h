@@ -0,0 +1,66 @@
+/* timers.h - upsd housekeeping timers
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef NUT_TIMERS_H_SEEN
+#define NUT_TIMERS_H_SEEN 1
+
+#include "timehead.h"
+
+#ifdef __cplusplus
+/* *INDENT-OFF* */
+extern "C" {
+/* *INDENT-ON* */
+#endif
+
+/* A timer is embedded in the object it watches (client, UPS, tracking
+ * entry) and calls back with that object when its second has come.
+ * The callback runs with the timer already disarmed, so it may re-arm
+ * it or free the object. */
+typedef struct upsd_timer_s {
+	time_t	expires;
+	void	(*callback)(void *data);
+	void	*data;
+
+	/* position in the wheel, NULL head when disarmed */
+	struct upsd_timer_s	**head;
+	struct upsd_timer_s	*prev;
+	struct upsd_timer_s	*next;
+} upsd_timer_t;
+
+/* prepare a (disarmed) timer */
+void upsd_timer_init(upsd_timer_t *timer, void (*callback)(void *data), void *data);
+
+/* (re-)arm the timer to fire at "expires"; a time in the past (like 0)
+ * fires it on the next upsd_timers_run() */
+void upsd_timer_set(upsd_timer_t *timer, time_t expires);
+
+/* disarm the timer, if armed */
+void upsd_timer_cancel(upsd_timer_t *timer);
+
+/* call back all timers due by "now" */
+void upsd_timers_run(time_t now);
+
+/* how long poll() may sleep (in msec, at most maxwait) before a timer is due */
+int upsd_timers_wait(int maxwait);
+
+#ifdef __cplusplus
+/* *INDENT-OFF* */
+}
+/* *INDENT-ON* */
+#endif
+
+#endif	/* NUT_TIMERS_H_SEEN */
@@ -65,6 +65,8 @@
 #include "sstate.h"
 #include "desc.h"
 #include "neterr.h"
+#include "netmetrics.h"
+#include "stats.h"
 
 #ifdef HAVE_WRAP
 #include <tcpd.h>
@@ -82,6 +84,9 @@ int	maxage = 15;
 /* default to 1h before cleaning up status tracking entries */
 int	tracking_delay = 3600;
 
+/* default to 1 minute before shedding inactive clients */
+int	client_inactivity_delay = 60;
+
 /*
  * Preloaded to ALLOW_NO_DEVICE from upsd.conf or environment variable
  * (with higher prio for envvar); defaults to disabled for legacy compat.
@@ -112,12 +117,17 @@ nut_ctype_t	*firstclient = NULL;
 /* default is to listen on all local interfaces */
 static stype_t	*firstaddr = NULL;
 
+/* optional HTTP listeners for the metrics exporter (none by default) */
+static stype_t	*firstmetricsaddr = NULL;
+
 static int 	opt_af = AF_UNSPEC;
 
 typedef enum {
 	DRIVER = 1,
 	CLIENT,
-	SERVER
+	SERVER,
+	METRICS_CLIENT,
+	METRICS_SERVER
 #ifdef WIN32
 	,NAMED_PIPE
 #endif	/* WIN32 */
@@ -142,12 +152,20 @@ typedef struct tracking_s {
 	char	*id;
 	int	status;
 	time_t	request_time; /* for cleanup */
+	upsd_timer_t	timer;
 	/* doubly linked list */
 	struct tracking_s	*prev;
 	struct tracking_s	*next;
+	struct tracking_s	*hnext;	/* tracking_find() hash chain */
 } tracking_t;
 
 static tracking_t	*tracking_list = NULL;
+static tracking_t	**tracking_hash = NULL;
+static size_t	tracking_hash_size = 0, tracking_hash_count = 0;
+
+	/* case-insensitive index of firstups, for get_ups_ptr() */
+static upstype_t	**ups_hash = NULL;
+static size_t	ups_hash_size = 0, ups_hash_count = 0;
 
 #ifndef WIN32
 	/* pollfd  */
@@ -162,7 +180,7 @@ static handler_t	*handler = NULL;
 static char	pidfn[NUT_PATH_MAX];
 
 	/* set by signal handlers */
-static int	reload_flag = 0, exit_flag = 0;
+static int	reload_flag = 0, exit_flag = 0, stats_flag = 0;
 
 /* Minimalistic support for UUID v4 */
 /* Ref: RFC 4122 https://tools.ietf.org/html/rfc4122#section-4.1.2 */
@@ -172,6 +190,63 @@ static int	reload_flag = 0, exit_flag = 0;
 # define SERVICE_UNIT_NAME "nut-server.service"
 #endif
 
+/* double the UPS index once it holds more entries than buckets */
+static void ups_index_grow(void)
+{
+	upstype_t	**nhash, *ups, *unext;
+	size_t	i, nsize, slot;
+
+	nsize = ups_hash_size ? ups_hash_size * 2 : 64;
+	nhash = xcalloc(nsize, sizeof(*nhash));
+
+	for (i = 0; i < ups_hash_size; i++) {
+		for (ups = ups_hash[i]; ups; ups = unext) {
+			unext = ups->hnext;
+			slot = nut_strhash(ups->name, 1) & (nsize - 1);
+			ups->hnext = nhash[slot];
+			nhash[slot] = ups;
+		}
+	}
+
+	free(ups_hash);
+	ups_hash = nhash;
+	ups_hash_size = nsize;
+}
+
+/* make a new UPS visible to get_ups_ptr() */
+void ups_index_add(upstype_t *ups)
+{
+	size_t	slot;
+
+	if (ups_hash_count >= ups_hash_size) {
+		ups_index_grow();
+	}
+
+	slot = nut_strhash(ups->name, 1) & (ups_hash_size - 1);
+	ups->hnext = ups_hash[slot];
+	ups_hash[slot] = ups;
+	ups_hash_count++;
+}
+
+/* forget a UPS before it is freed */
+void ups_index_del(upstype_t *ups)
+{
+	upstype_t	**pp;
+
+	if (!ups_hash_size) {
+		return;
+	}
+
+	for (pp = &ups_hash[nut_strhash(ups->name, 1) & (ups_hash_size - 1)]; *pp; pp = &(*pp)->hnext) {
+		if (*pp == ups) {
+			*pp = ups->hnext;
+			ups->hnext = NULL;
+			ups_hash_count--;
+			return;
+		}
+	}
+}
+
 /* return a pointer to the named ups if possible */
 upstype_t *get_ups_ptr(const char *name)
 {
@@ -183,9 +258,11 @@ upstype_t *get_ups_ptr(const char *name)
 		return NULL;
 	}
 
-	for (tmp = firstups; tmp; tmp = tmp->next) {
-		if (!strcasecmp(tmp->name, name)) {
-			return tmp;
+	if (ups_hash_size) {
+		for (tmp = ups_hash[nut_strhash(name, 1) & (ups_hash_size - 1)]; tmp; tmp = tmp->hnext) {
+			if (!strcasecmp(tmp->name, name)) {
+				return tmp;
+			}
 		}
 	}
 
@@ -219,16 +296,66 @@ static void ups_data_ok(upstype_t *ups)
 	upslogx(LOG_NOTICE, "UPS [%s] data is no longer stale", ups->name);
 }
 
-/* add another listening address */
-void listen_add(const char *addr, const char *port)
+/* staleness checks and pings for one UPS, on its own schedule */
+static void ups_check(void *data)
 {
-	stype_t	*server;
+	upstype_t	*ups = (upstype_t *)data;
+	time_t	now, next;
 
-	/* don't change listening addresses on reload */
-	if (reload_flag) {
+	/* reconnecting is up to mainloop(), which calls us again when done */
+	if (INVALID_FD(ups->sock_fd)) {
 		return;
 	}
 
+	/* throw some warnings if it's not feeding us data any more */
+	if (sstate_dead(ups, maxage)) {
+		ups_data_stale(ups);
+	} else {
+		ups_data_ok(ups);
+	}
+
+	/* look again when sstate_dead() would send the next ping or see
+	 * the data go stale, whichever is sooner (ups_readline() may call
+	 * us earlier when the driver says something that matters) */
+	time(&now);
+
+	next = ((ups->last_heard > ups->last_ping) ? ups->last_heard : ups->last_ping)
+		+ maxage / 3 + 1;
+
+	if (next > ups->last_heard + maxage + 2) {
+		next = ups->last_heard + maxage + 2;
+	}
+
+	if (next <= now) {
+		next = now + 1;
+	}
+
+	upsd_timer_set(&ups->check_timer, next);
+}
+
+/* start the housekeeping of a newly defined UPS */
+void ups_watch(upstype_t *ups)
+{
+	upsd_timer_init(&ups->check_timer, ups_check, ups);
+	upsd_timer_set(&ups->check_timer, 0);
+}
+
+/* read from the driver, and re-check the UPS if its data may have
+ * turned stale or fresh */
+static void ups_readline(upstype_t *ups)
+{
+	sstate_readline(ups);
+
+	if (ups->stale || (ups->dumpdone && !ups->data_ok)) {
+		upsd_timer_set(&ups->check_timer, 0);
+	}
+}
+
+/* add another listening address to the list */
+static void stype_add(stype_t **list, const char *addr, const char *port)
+{
+	stype_t	*server;
+
 	/* grab some memory and add the info */
 	server = xcalloc(1, sizeof(*server));
 	server->addr = xstrdup(addr);
@@ -236,15 +363,43 @@ void listen_add(const char *addr, const char *port)
 	server->sock_fd = ERROR_FD_SOCK;
 	server->next = NULL;
 
-	if (firstaddr) {
+	if (*list) {
 		stype_t	*tmp;
-		for (tmp = firstaddr; tmp->next; tmp = tmp->next);
+		for (tmp = *list; tmp->next; tmp = tmp->next);
 		tmp->next = server;
 	} else {
-		firstaddr = server;
+		*list = server;
+	}
+}
+
+/* add another listening address */
+void listen_add(const char *addr, const char *port)
+{
+	/* don't change listening addresses on reload */
+	if (reload_flag) {
+		return;
+	}
+
+	stype_add(&firstaddr, addr, port);
+
+	upsdebugx(3, "listen_add: added %s:%s", addr, port);
+}
+
+/* add another listening address for the metrics exporter */
+void metrics_listen_add(const char *addr, const char *port)
+{
+	/* don't change listening addresses on reload */
+	if (reload_flag) {
+		return;
 	}
 
-	upsdebugx(3, "listen_add: added %s:%s", server->addr, server->port);
+#ifndef WIN32
+	stype_add(&firstmetricsaddr, addr, port);
+
+	upsdebugx(3, "metrics_listen_add: added %s:%s", addr, port);
+#else	/* WIN32 */
+	upslogx(LOG_WARNING, "METRICS_LISTEN %s %s: not supported on this platform, ignored", addr, port);
+#endif	/* WIN32 */
 }
 
 /* Close the connection if needed and free the allocated memory.
@@ -529,18 +684,46 @@ static void setuptcp(stype_t *server)
 	return;
 }
 
-/* decrement the login counter for this ups */
-static void declogins(const char *upsname)
+/* record a client as logged into this ups */
+void ups_login(upstype_t *ups, nut_ctype_t *client)
+{
+	ups->numlogins++;
+	client->loginups = xstrdup(ups->name);
+
+	client->login_prev = NULL;
+	client->login_next = ups->logins;
+
+	if (ups->logins) {
+		ups->logins->login_prev = client;
+	}
+
+	ups->logins = client;
+}
+
+/* decrement the login counter for the ups this client is on */
+static void declogins(nut_ctype_t *client)
 {
 	upstype_t	*ups;
 
-	ups = get_ups_ptr(upsname);
+	ups = get_ups_ptr(client->loginups);
 
 	if (!ups) {
-		upslogx(LOG_INFO, "Tried to decrement invalid ups name (%s)", upsname);
+		upslogx(LOG_INFO, "Tried to decrement invalid ups name (%s)", client->loginups);
 		return;
 	}
 
+	if (client->login_prev) {
+		client->login_prev->login_next = client->login_next;
+	} else {
+		ups->logins = client->login_next;
+	}
+
+	if (client->login_next) {
+		client->login_next->login_prev = client->login_prev;
+	}
+
+	client->login_prev = client->login_next = NULL;
+
 	ups->numlogins--;
 
 	if (ups->numlogins < 0) {
@@ -565,13 +748,15 @@ static void client_disconnect(nut_ctype_t *client)
 #endif	/* WIN32 */
 
 	if (client->loginups) {
-		declogins(client->loginups);
+		declogins(client);
 	}
 
 	ssl_finish(client);
 
 	pconf_finish(&client->ctx);
 
+	upsd_timer_cancel(&client->idle_timer);
+
 	if (client->prev) {
 		client->prev->next = client->next;
 	} else {
@@ -629,6 +814,11 @@ int sendback(nut_ctype_t *client, const char *fmt, ...)
 		res = write(client->sock_fd, ans, len);
 	}
 
+	stats_sendback(len, res);
+	if (res > 0) {
+		client->stat_bytes_out += (uint64_t)res;
+	}
+
 	{ /* scoping */
 		char * s = str_rtrim(ans, '\n');
 		upsdebugx(2, "write: [destfd=%d] [len=%" PRIuSIZE "] [%s]", client->sock_fd, len, s);
@@ -636,7 +826,9 @@ int sendback(nut_ctype_t *client, const char *fmt, ...)
 
 	if (res < 0 || len != (size_t)res) {
 		upslog_with_errno(LOG_NOTICE, "write() failed for %s", client->addr);
+		/* disconnect on the next pass of mainloop() */
 		client->last_heard = 0;
+		upsd_timer_set(&client->idle_timer, 0);
 		return 0;	/* failed */
 	}
 
@@ -658,21 +850,21 @@ int send_err(nut_ctype_t *client, const char *errtype)
 /* disconnect anyone logged into this UPS */
 void kick_login_clients(const char *upsname)
 {
+	upstype_t	*ups;
 	nut_ctype_t	*client, *cnext;
 
-	for (client = firstclient; client; client = cnext) {
+	ups = get_ups_ptr(upsname);
 
-		cnext = client->next;
+	if (!ups) {
+		return;
+	}
 
-		/* if it's not logged in, don't check it */
-		if (!client->loginups) {
-			continue;
-		}
+	for (client = ups->logins; client; client = cnext) {
 
-		if (!strcmp(client->loginups, upsname)) {
-			upslogx(LOG_INFO, "Kicking client %s (was on UPS [%s])\n", client->addr, upsname);
-			client_disconnect(client);
-		}
+		cnext = client->login_next;
+
+		upslogx(LOG_INFO, "Kicking client %s (was on UPS [%s])\n", client->addr, upsname);
+		client_disconnect(client);
 	}
 }
 
@@ -787,18 +979,39 @@ static void parse_net(nut_ctype_t *client)
 		return;
 	}
 
+	client->stat_commands++;
+
 	for (i = 0; netcmds[i].name; i++) {
 		if (!strcasecmp(netcmds[i].name, client->ctx.arglist[0])) {
+			st_tree_timespec_t	start, finish;
+
+			metrics_netcmds_total++;
+
+			state_get_timestamp(&start);
 			check_command(i, client, client->ctx.numargs, (const char **) client->ctx.arglist);
+			state_get_timestamp(&finish);
+
+			stats_netcmd((size_t)i, netcmds[i].name,
+				difftime_st_tree_timespec(finish, start));
 			return;
 		}
 	}
 
 	/* fallthrough = not matched by any entry in netcmds */
 
+	stats_netcmd_unknown();
 	send_err(client, NUT_ERR_UNKNOWN_COMMAND);
 }
 
+/* shed clients after client_inactivity_delay (or when asked to) */
+static void client_idle(void *data)
+{
+	nut_ctype_t	*client = (nut_ctype_t *)data;
+
+	upsdebugx(2, "%s: dropping client %s", __func__, client->addr);
+	client_disconnect(client);
+}
+
 /* answer incoming tcp connections */
 static void client_connect(stype_t *server)
 {
@@ -823,6 +1036,8 @@ static void client_connect(stype_t *server)
 	client->sock_fd = fd;
 
 	time(&client->last_heard);
+	upsd_timer_init(&client->idle_timer, client_idle, client);
+	upsd_timer_set(&client->idle_timer, client->last_heard + client_inactivity_delay + 1);
 
 	client->addr = xstrdup(inet_ntopSS(&csock));
 
@@ -862,7 +1077,7 @@ static void client_connect(stype_t *server)
 static void client_readline(nut_ctype_t *client)
 {
 	char	buf[SMALLBUF];
-	int	i;
+	size_t	i, used;
 	ssize_t	ret;
 
 #ifdef WITH_SSL
@@ -886,14 +1101,17 @@ static void client_readline(nut_ctype_t *client)
 		return;
 	}
 
+	client->stat_bytes_in += (uint64_t)ret;
+
 	/* fragment handling code */
-	for (i = 0; i < ret; i++) {
+	for (i = 0; i < (size_t)ret; i += used) {
 
-		/* add to the receive queue one by one */
-		switch (pconf_char(&client->ctx, buf[i]))
+		/* add to the receive queue a line at a time */
+		switch (pconf_buffer(&client->ctx, buf + i, (size_t)ret - i, &used))
 		{
 		case 1:
 			time(&client->last_heard);	/* command received */
+			upsd_timer_set(&client->idle_timer, client->last_heard + client_inactivity_delay + 1);
 			parse_net(client);
 			continue;
 
@@ -1005,6 +1223,16 @@ void server_load(void)
 		listenersLocalhostIPv6, listenersValidLocalhostIPv6
 		);
 
+	/* the metrics exporter is optional, failing it is not fatal */
+	for (server = firstmetricsaddr; server; server = server->next) {
+		setuptcp(server);
+
+		if (INVALID_FD_SOCK(server->sock_fd)) {
+			upslogx(LOG_ERR, "metrics exporter is not available on %s port %s",
+				server->addr, server->port);
+		}
+	}
+
 	/* check if we have at least 1 valid LISTEN interface */
 	if (!listenersValid) {
 		fatalx(EXIT_FAILURE, "no listening interface available");
@@ -1064,6 +1292,13 @@ void server_free(void)
 	}
 
 	firstaddr = NULL;
+
+	for (server = firstmetricsaddr; server; server = snext) {
+		snext = server->next;
+		stype_free(server);
+	}
+
+	firstmetricsaddr = NULL;
 }
 
 static void client_free(void)
@@ -1075,6 +1310,8 @@ static void client_free(void)
 		cnext = client->next;
 		client_disconnect(client);
 	}
+
+	metrics_client_free();
 }
 
 static void driver_free(void)
@@ -1097,8 +1334,10 @@ static void driver_free(void)
 			ups->sock_fd = ERROR_FD;
 		}
 
+		upsd_timer_cancel(&ups->check_timer);
 		sstate_infofree(ups);
 		sstate_cmdfree(ups);
+		metrics_ups_free(ups);
 
 		pconf_finish(&ups->sock_ctx);
 
@@ -1107,6 +1346,12 @@ static void driver_free(void)
 		free(ups->desc);
 		free(ups);
 	}
+
+	firstups = NULL;
+
+	free(ups_hash);
+	ups_hash = NULL;
+	ups_hash_size = ups_hash_count = 0;
 }
 
 static void upsd_cleanup(void)
@@ -1126,6 +1371,7 @@ static void upsd_cleanup(void)
 	client_free();
 	driver_free();
 	tracking_free();
+	stats_free();
 
 	free(statepath);
 	free(datapath);
@@ -1186,10 +1432,96 @@ static void poll_reload(void)
 
 /* instant command and setvar status tracking */
 
+/* find a status tracking entry by its (case-insensitive) id */
+static tracking_t *tracking_find(const char *id)
+{
+	tracking_t	*item;
+
+	if (!tracking_hash_size)
+		return NULL;
+
+	for (item = tracking_hash[nut_strhash(id, 1) & (tracking_hash_size - 1)]; item; item = item->hnext) {
+		if (!strcasecmp(item->id, id))
+			return item;
+	}
+
+	return NULL;
+}
+
+/* double the tracking index once it holds more entries than buckets */
+static void tracking_grow(void)
+{
+	tracking_t	**nhash, *item, *inext;
+	size_t	i, nsize, slot;
+
+	nsize = tracking_hash_size ? tracking_hash_size * 2 : 64;
+	nhash = xcalloc(nsize, sizeof(*nhash));
+
+	for (i = 0; i < tracking_hash_size; i++) {
+		for (item = tracking_hash[i]; item; item = inext) {
+			inext = item->hnext;
+			slot = nut_strhash(item->id, 1) & (nsize - 1);
+			item->hnext = nhash[slot];
+			nhash[slot] = item;
+		}
+	}
+
+	free(tracking_hash);
+	tracking_hash = nhash;
+	tracking_hash_size = nsize;
+}
+
+/* unlink and free one status tracking entry */
+static void tracking_remove(tracking_t *item)
+{
+	tracking_t	**pp;
+
+	for (pp = &tracking_hash[nut_strhash(item->id, 1) & (tracking_hash_size - 1)]; *pp; pp = &(*pp)->hnext) {
+		if (*pp == item) {
+			*pp = item->hnext;
+			tracking_hash_count--;
+			break;
+		}
+	}
+
+	if (item->prev)
+		item->prev->next = item->next;
+	else
+		/* deleting first entry */
+		tracking_list = item->next;
+
+	if (item->next)
+		item->next->prev = item->prev;
+
+	upsd_timer_cancel(&item->timer);
+
+	free(item->id);
+	free(item);
+}
+
+/* drop an entry once it is older than tracking_delay */
+static void tracking_expire(void *data)
+{
+	tracking_t	*item = (tracking_t *)data;
+	time_t	now;
+
+	time(&now);
+
+	if (difftime(now, item->request_time) > tracking_delay) {
+		upsdebugx(3, "%s: expiring id %s", __func__, item->id);
+		tracking_remove(item);
+		return;
+	}
+
+	/* tracking_delay grew with a reload */
+	upsd_timer_set(&item->timer, item->request_time + tracking_delay + 1);
+}
+
 /* allocate a new status tracking entry */
 int tracking_add(const char *id)
 {
 	tracking_t	*item;
+	size_t	slot;
 
 	if ((!tracking_enabled) || (!id))
 		return 0;
@@ -1200,6 +1532,9 @@ int tracking_add(const char *id)
 	item->status = STAT_PENDING;
 	time(&item->request_time);
 
+	upsd_timer_init(&item->timer, tracking_expire, item);
+	upsd_timer_set(&item->timer, item->request_time + tracking_delay + 1);
+
 	if (tracking_list) {
 		tracking_list->prev = item;
 		item->next = tracking_list;
@@ -1207,35 +1542,39 @@ int tracking_add(const char *id)
 
 	tracking_list = item;
 
+	if (tracking_hash_count >= tracking_hash_size)
+		tracking_grow();
+
+	slot = nut_strhash(item->id, 1) & (tracking_hash_size - 1);
+	item->hnext = tracking_hash[slot];
+	tracking_hash[slot] = item;
+	tracking_hash_count++;
+
 	return 1;
 }
 
 /* set status of a specific tracking entry */
 int tracking_set(const char *id, const char *value)
 {
-	tracking_t	*item, *next_item;
+	tracking_t	*item;
 
 	/* sanity checks */
 	if ((!tracking_list) || (!id) || (!value))
 		return 0;
 
-	for (item = tracking_list; item; item = next_item) {
-
-		next_item = item->next;
+	item = tracking_find(id);
 
-		if (!strcasecmp(item->id, id)) {
-			item->status = atoi(value);
-			return 1;
-		}
-	}
+	if (!item)
+		return 0; /* id not found! */
 
-	return 0; /* id not found! */
+	item->status = atoi(value);
+	return 1;
 }
 
 /* free a specific tracking entry */
 int tracking_del(const char *id)
 {
-	tracking_t	*item, *next_item;
+	tracking_t	*item;
 
 	/* sanity check */
 	if ((!tracking_list) || (!id))
@@ -1243,30 +1582,13 @@ int tracking_del(const char *id)
 
 	upsdebugx(3, "%s: deleting id %s", __func__, id);
 
-	for (item = tracking_list; item; item = next_item) {
-
-		next_item = item->next;
-
-		if (strcasecmp(item->id, id))
-			continue;
-
-		if (item->prev)
-			item->prev->next = item->next;
-		else
-			/* deleting first entry */
-			tracking_list = item->next;
-
-		if (item->next)
-			item->next->prev = item->prev;
+	item = tracking_find(id);
 
-		free(item->id);
-		free(item);
+	if (!item)
+		return 0; /* id not found! */
 
-		return 1;
-
-	}
-
-	return 0; /* id not found! */
+	tracking_remove(item);
+	return 1;
 }
 
 /* free all status tracking entries */
@@ -1282,50 +1604,26 @@ void tracking_free(void)
 
 	for (item = tracking_list; item; item = next_item) {
 		next_item = item->next;
-		tracking_del(item->id);
+		tracking_remove(item);
 	}
-}
-
-/* cleanup status tracking entries according to their age and tracking_delay */
-void tracking_cleanup(void)
-{
-	tracking_t	*item, *next_item;
-	time_t	now;
-
-	/* sanity check */
-	if (!tracking_list)
-		return;
-
-	time(&now);
-
-	upsdebugx(3, "%s", __func__);
-
-	for (item = tracking_list; item; item = next_item) {
-
-		next_item = item->next;
 
-		if (difftime(now, item->request_time) > tracking_delay) {
-			tracking_del(item->id);
-		}
-	}
+	free(tracking_hash);
+	tracking_hash = NULL;
+	tracking_hash_size = tracking_hash_count = 0;
 }
 
 /* get status of a specific tracking entry */
 char *tracking_get(const char *id)
 {
-	tracking_t	*item, *next_item;
+	tracking_t	*item;
 
 	/* sanity checks */
 	if ((!tracking_list) || (!id))
 		return "ERR UNKNOWN";
 
-	for (item = tracking_list; item; item = next_item) {
-
-		next_item = item->next;
-
-		if (strcasecmp(item->id, id))
-			continue;
+	item = tracking_find(id);
 
+	if (item) {
 		switch (item->status)
 		{
 		case STAT_PENDING:
@@ -1411,6 +1709,14 @@ static void set_reload_flag(int sig)
 	reload_flag = 1;
 }
 
+#ifndef WIN32
+static void set_stats_flag(int sig)
+{
+	NUT_UNUSED_VARIABLE(sig);
+	stats_flag = 1;
+}
+#endif	/* !WIN32 */
+
 /* service requests and check on new data */
 static void mainloop(void)
 {
@@ -1425,6 +1731,9 @@ static void mainloop(void)
 	nfds_t	nfds = 0;
 	upstype_t	*ups;
 	nut_ctype_t		*client, *cnext;
+#ifndef WIN32
+	metrics_ctype_t	*mclient, *mcnext;
+#endif	/* !WIN32 */
 	stype_t		*server;
 	time_t	now;
 
@@ -1437,11 +1746,22 @@ static void mainloop(void)
 		conf_reload();
 		poll_reload();
 		reload_flag = 0;
+
+		/* MAXAGE may have changed */
+		for (ups = firstups; ups; ups = ups->next) {
+			upsd_timer_set(&ups->check_timer, 0);
+		}
 		upsnotify(NOTIFY_STATE_READY, NULL);
 	}
 
-	/* cleanup instcmd/setvar status tracking entries if needed */
-	tracking_cleanup();
+	if (stats_flag) {
+		stats_dump();
+		stats_flag = 0;
+	}
+
+	/* staleness checks, inactive clients and old status tracking
+	 * entries: only whatever timers are due */
+	upsd_timers_run(now);
 
 #ifndef WIN32
 	/* scan through driver sockets */
@@ -1459,17 +1779,11 @@ static void mainloop(void)
 			} else {
 				upsdebugx(1, "%s: UPS [%s] is now connected as FD %d",
 					__func__, ups->name, ups->sock_fd);
+				upsd_timer_set(&ups->check_timer, 0);
 			}
 			continue;
 		}
 
-		/* throw some warnings if it's not feeding us data any more */
-		if (sstate_dead(ups, maxage)) {
-			ups_data_stale(ups);
-		} else {
-			ups_data_ok(ups);
-		}
-
 		fds[nfds].fd = ups->sock_fd;
 		fds[nfds].events = POLLIN;
 
@@ -1484,13 +1798,6 @@ static void mainloop(void)
 
 		cnext = client->next;
 
-		if (difftime(now, client->last_heard) > 60) {
-			/* shed clients after 1 minute of inactivity */
-			/* FIXME: create an upsd.conf parameter (CLIENT_INACTIVITY_DELAY) */
-			client_disconnect(client);
-			continue;
-		}
-
 		if (nfds >= maxconn) {
 			/* ignore clients that we are unable to handle */
 			continue;
@@ -1521,9 +1828,49 @@ static void mainloop(void)
 		nfds++;
 	}
 
+	/* scan through metrics exporter client sockets */
+	for (mclient = firstmetricsclient; mclient; mclient = mcnext) {
+
+		mcnext = mclient->next;
+
+		if (metrics_client_expired(mclient, now)) {
+			metrics_client_disconnect(mclient);
+			continue;
+		}
+
+		if (nfds >= maxconn) {
+			continue;
+		}
+
+		fds[nfds].fd = mclient->sock_fd;
+		/* once the request is in, only wait to send the answer */
+		fds[nfds].events = mclient->resp ? POLLOUT : POLLIN;
+
+		handler[nfds].type = METRICS_CLIENT;
+		handler[nfds].data = mclient;
+
+		nfds++;
+	}
+
+	/* scan through metrics exporter server sockets */
+	for (server = firstmetricsaddr; server && (nfds < maxconn); server = server->next) {
+
+		if (server->sock_fd < 0) {
+			continue;
+		}
+
+		fds[nfds].fd = server->sock_fd;
+		fds[nfds].events = POLLIN;
+
+		handler[nfds].type = METRICS_SERVER;
+		handler[nfds].data = server;
+
+		nfds++;
+	}
+
 	upsdebugx(2, "%s: polling %" PRIdMAX " filedescriptors", __func__, (intmax_t)nfds);
 
-	ret = poll(fds, nfds, 2000);
+	ret = poll(fds, nfds, upsd_timers_wait(2000));
 
 	if (ret == 0) {
 		upsdebugx(2, "%s: no data available", __func__);
@@ -1550,6 +1897,12 @@ static void mainloop(void)
 			case SERVER:
 				upsdebugx(2, "%s: server disconnected", __func__);
 				break;
+			case METRICS_CLIENT:
+				metrics_client_disconnect((metrics_ctype_t *)handler[i].data);
+				break;
+			case METRICS_SERVER:
+				upsdebugx(2, "%s: metrics server disconnected", __func__);
+				break;
 
 #if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && ( (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_COVERED_SWITCH_DEFAULT) || (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_UNREACHABLE_CODE) )
 # pragma GCC diagnostic push
@@ -1585,12 +1938,17 @@ static void mainloop(void)
 			continue;
 		}
 
+		if ((fds[i].revents & POLLOUT) && handler[i].type == METRICS_CLIENT) {
+			metrics_client_write((metrics_ctype_t *)handler[i].data);
+			continue;
+		}
+
 		if (fds[i].revents & POLLIN) {
 
 			switch(handler[i].type)
 			{
 			case DRIVER:
-				sstate_readline((upstype_t *)handler[i].data);
+				ups_readline((upstype_t *)handler[i].data);
 				break;
 			case CLIENT:
 				client_readline((nut_ctype_t *)handler[i].data);
@@ -1598,6 +1956,12 @@ static void mainloop(void)
 			case SERVER:
 				client_connect((stype_t *)handler[i].data);
 				break;
+			case METRICS_CLIENT:
+				metrics_client_readline((metrics_ctype_t *)handler[i].data);
+				break;
+			case METRICS_SERVER:
+				metrics_client_connect((stype_t *)handler[i].data);
+				break;
 
 #if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && ( (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_COVERED_SWITCH_DEFAULT) || (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_UNREACHABLE_CODE) )
 # pragma GCC diagnostic push
@@ -1648,17 +2012,11 @@ static void mainloop(void)
 			} else {
 				upsdebugx(1, "%s: UPS [%s] is now connected as FD %d",
 					__func__, ups->name, ups->sock_fd);
+				upsd_timer_set(&ups->check_timer, 0);
 			}
 			continue;
 		}
 
-		/* throw some warnings if it's not feeding us data any more */
-		if (sstate_dead(ups, maxage)) {
-			ups_data_stale(ups);
-		} else {
-			ups_data_ok(ups);
-		}
-
 		/* FIXME: Is the conditional needed? We got here... */
 		if (VALID_FD(ups->sock_fd)) {
 			fds[nfds] = ups->read_overlapped.hEvent;
@@ -1675,12 +2033,6 @@ static void mainloop(void)
 
 		cnext = client->next;
 
-		if (difftime(now, client->last_heard) > 60) {
-			/* shed clients after 1 minute of inactivity */
-			client_disconnect(client);
-			continue;
-		}
-
 		if (nfds >= maxconn) {
 			/* ignore clients that we are unable to handle */
 			continue;
@@ -1725,7 +2077,7 @@ static void mainloop(void)
 	upsdebugx(2, "%s: wait for %d filedescriptors", __func__, nfds);
 
 	/* https://docs.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-waitformultipleobjects */
-	ret = WaitForMultipleObjects(nfds,fds,FALSE,2000);
+	ret = WaitForMultipleObjects(nfds, fds, FALSE, (DWORD)upsd_timers_wait(2000));
 
 	upsdebugx(6, "%s: wait for filedescriptors done: %" PRIu64, __func__, ret);
 
@@ -1780,7 +2132,7 @@ static void mainloop(void)
 	switch(handler[ret].type) {
 		case DRIVER:
 			upsdebugx(4, "%s: calling sstate_readline() for DRIVER", __func__);
-			sstate_readline((upstype_t *)handler[ret].data);
+			ups_readline((upstype_t *)handler[ret].data);
 			break;
 		case CLIENT:
 			upsdebugx(4, "%s: calling client_readline() for CLIENT", __func__);
@@ -1889,6 +2241,10 @@ static void setup_signals(void)
 	/* handle reloading */
 	sa.sa_handler = set_reload_flag;
 	sigaction(SIGHUP, &sa, NULL);
+
+	/* log the LIST STATS counters */
+	sa.sa_handler = set_stats_flag;
+	sigaction(SIGUSR1, &sa, NULL);
 #else	/* WIN32 */
 	pipe_create(UPSD_PIPE_NAME);
 #endif	/* WIN32 */
@@ -2327,6 +2683,8 @@ int main(int argc, char **argv)
 
 	upsnotify(NOTIFY_STATE_READY_WITH_PID, NULL);
 
+	stats_init();
+
 	while (!exit_flag) {
 		/* Note: mainloop() calls upsnotify(NOTIFY_STATE_WATCHDOG, NULL); */
 		mainloop();
@@ -61,9 +61,14 @@ extern "C" {
 /* prototypes from upsd.c */
 
 upstype_t *get_ups_ptr(const char *upsname);
+void ups_index_add(upstype_t *ups);
+void ups_index_del(upstype_t *ups);
+void ups_login(upstype_t *ups, nut_ctype_t *client);
+void ups_watch(upstype_t *ups);
 int ups_available(const upstype_t *ups, nut_ctype_t *client);
 
 void listen_add(const char *addr, const char *port);
+void metrics_listen_add(const char *addr, const char *port);
 
 void kick_login_clients(const char *upsname);
 int sendback(nut_ctype_t *client, const char *fmt, ...)
@@ -91,14 +96,14 @@ int tracking_add(const char *id);
 int tracking_set(const char *id, const char *value);
 int tracking_del(const char *id);
 void tracking_free(void);
-void tracking_cleanup(void);
 char *tracking_get(const char *id);
 int tracking_enable(void);
 int tracking_disable(void);
 int tracking_is_enabled(void);
 
 /* declarations from upsd.c */
-extern int		maxage, tracking_delay, allow_no_device, allow_not_all_listeners;
+extern int		maxage, tracking_delay, client_inactivity_delay;
+extern int		allow_no_device, allow_not_all_listeners;
 extern nfds_t		maxconn;
 extern char		*statepath, *datapath;
 extern upstype_t	*firstups;
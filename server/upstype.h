@@ -24,6 +24,8 @@
 
 #include "parseconf.h"
 #include "common.h"
+#include "nut_stdint.h"
+#include "timers.h"
 
 #ifdef __cplusplus
 /* *INDENT-OFF* */
@@ -47,16 +49,33 @@ typedef struct upstype_s {
 	time_t			last_heard;
 	time_t			last_ping;
 	time_t			last_connfail;
+	upsd_timer_t		check_timer;	/* staleness checks and pings */
 	PCONF_CTX_t		sock_ctx;
 	struct st_tree_s	*inforoot;
 	struct cmdlist_s	*cmdlist;
 
 	int	numlogins;
+	struct nut_ctype_s	*logins;	/* clients logged into this UPS */
 	int	fsd;		/* forced shutdown in effect? */
 
 	int	retain;
 
+	/* bumped whenever the driver changes something in inforoot,
+	 * so that renderings of the tree can be cached (netmetrics.c) */
+	uint64_t	generation;
+	char	*metrics_cache;
+	size_t	metrics_cachesize;
+	size_t	metrics_cachelen;
+	uint64_t	metrics_cachegen;
+
+	/* driver socket accounting for LIST STATS (stats.c) */
+	uint64_t	stat_reads;
+	uint64_t	stat_bytes;
+	uint64_t	stat_lines;
+	uint64_t	stat_parse_errors;
+
 	struct upstype_s	*next;
+	struct upstype_s	*hnext;	/* get_ups_ptr() hash chain */
 
 } upstype_t;
 
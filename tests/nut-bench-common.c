@@ -0,0 +1,53 @@
+/*  nut-bench-common.c - helpers shared by nut-bench and nut-microbench
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#include "config.h"
+#include "common.h"
+
+#include "nut-bench-common.h"
+
+const char	*bench_default_data[] = {
+	"ups.status", "OL",
+	"ups.mfr", "Network UPS Tools",
+	"ups.model", "NUT benchmark synthetic device",
+	"ups.load", "25",
+	"ups.realpower.nominal", "500",
+	"battery.charge", "100",
+	"battery.runtime", "3600",
+	"battery.voltage", "27.3",
+	"input.voltage", "230.0",
+	"input.frequency", "50.0",
+	"output.voltage", "230.0",
+	"output.frequency", "50.0",
+	NULL, NULL
+};
+
+double bench_now(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(HAVE_CLOCK_MONOTONIC) && HAVE_CLOCK_GETTIME && HAVE_CLOCK_MONOTONIC
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+#else
+	struct timeval	tv;
+
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+#endif
+}
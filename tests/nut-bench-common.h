@@ -0,0 +1,29 @@
+/*  nut-bench-common.h - helpers shared by nut-bench and nut-microbench
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#ifndef NUT_BENCH_COMMON_H_SEEN
+#define NUT_BENCH_COMMON_H_SEEN 1
+
+/* name/value pairs of a synthetic device, used without a .seq file;
+ * terminated by a NULL name */
+extern const char	*bench_default_data[];
+
+/* monotonic (where available) time in seconds */
+double bench_now(void);
+
+#endif	/* NUT_BENCH_COMMON_H_SEEN */
@@ -0,0 +1,939 @@
+/*  nut-bench.c - load generator and benchmark harness for upsd
+ *
+ *  This program starts a private upsd instance against a number of
+ *  synthetic drivers emulated in-process (speaking the driver socket
+ *  protocol, with data from a dummy-ups .seq/.dev file), pushes SETINFO
+ *  updates at a configurable rate, and opens a number of concurrent
+ *  network protocol clients issuing a mix of GET VAR, LIST VAR and
+ *  "watch" (polling GET VAR ups.status, as upsmon does) requests.
+ *
+ *  It reports throughput, request latency (p50/p99/max) and the CPU
+ *  time and peak RSS of upsd, so that changes in server/ can be compared.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#include "config.h"
+#include "common.h"
+#include "nut_stdint.h"
+#include "parseconf.h"
+#include "state.h"
+#include "nut-bench-common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef WIN32
+# include <poll.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+# include <sys/wait.h>
+# include <sys/resource.h>
+# include <netinet/in.h>
+# include <arpa/inet.h>
+#endif	/* !WIN32 */
+
+#ifndef WIN32
+
+/* one variable of the synthetic device */
+typedef struct {
+	char	*name;
+	char	*value;
+	int	numeric;
+	double	num;
+} bench_var_t;
+
+/* one synthetic driver, as seen by upsd */
+typedef struct {
+	char	upsname[SMALLBUF];
+	char	sockfn[NUT_PATH_MAX + 1];
+	int	listen_fd;
+	int	fd;		/* connection from upsd */
+	char	rbuf[LARGEBUF];
+	size_t	rlen;
+	int	dumped;
+	size_t	next_var;	/* next variable to churn */
+	unsigned int	pass;
+	double	next_churn;
+} bench_drv_t;
+
+typedef enum {
+	REQ_GET = 0,
+	REQ_LIST,
+	REQ_WATCH,
+	REQ_TYPES
+} bench_reqtype_t;
+
+static const char	*reqnames[REQ_TYPES] = { "GET", "LIST", "WATCH" };
+
+/* one network protocol client */
+typedef struct {
+	int	fd;
+	char	rbuf[LARGEBUF];
+	size_t	rlen;
+	bench_reqtype_t	type;
+	int	busy;
+	double	sent;
+} bench_client_t;
+
+/* latency samples of one request type, in microseconds */
+typedef struct {
+	uint32_t	*usec;
+	size_t	count;
+	size_t	alloc;
+	uint64_t	errors;
+} bench_samples_t;
+
+static bench_var_t	*vars = NULL;
+static size_t	numvars = 0;
+
+static bench_drv_t	*drvs = NULL;
+static size_t	numdrvs = 10;
+
+static bench_client_t	*clients = NULL;
+static size_t	numclients = 10;
+
+static bench_samples_t	samples[REQ_TYPES];
+
+static double	duration = 10.0, churn_rate = 10.0;
+static unsigned int	mix[REQ_TYPES] = { 80, 10, 10 };
+static uint16_t	port = 0;
+static const char	*upsd_path = SBINDIR "/upsd";
+static const char	*seqfile = NULL;
+/* short enough for unix socket names to fit in sockaddr_un */
+static char	tmpdir[SMALLBUF];
+static int	keep_tmpdir = 0;
+static pid_t	upsd_pid = -1;
+static uint64_t	setinfo_sent = 0;
+
+static void var_add(const char *name, const char *value)
+{
+	bench_var_t	*v;
+	char	*end = NULL;
+
+	vars = xrealloc(vars, (numvars + 1) * sizeof(*vars));
+	v = &vars[numvars++];
+
+	v->name = xstrdup(name);
+	v->value = xstrdup(value);
+	v->num = strtod(value, &end);
+	v->numeric = (*value != '\0' && end && *end == '\0');
+}
+
+static void seq_err(const char *errmsg)
+{
+	upslogx(LOG_ERR, "Parse error in %s: %s", seqfile, errmsg);
+}
+
+/* read a dummy-ups .seq or .dev file; TIMER and ALARM lines, as well as
+ * the driver.* data collected with the original device, are skipped */
+static void seq_load(void)
+{
+	PCONF_CTX_t	ctx;
+	size_t	i;
+
+	if (!seqfile) {
+		for (i = 0; bench_default_data[i]; i += 2) {
+			var_add(bench_default_data[i], bench_default_data[i + 1]);
+		}
+		return;
+	}
+
+	pconf_init(&ctx, seq_err);
+
+	if (!pconf_file_begin(&ctx, seqfile)) {
+		fatalx(EXIT_FAILURE, "Can't open %s: %s", seqfile, ctx.errmsg);
+	}
+
+	while (pconf_file_next(&ctx)) {
+		char	value[ST_MAX_VALUE_LEN], *ptr;
+
+		if (pconf_parse_error(&ctx) || ctx.numargs < 2) {
+			continue;
+		}
+
+		if (!strcmp(ctx.arglist[0], "TIMER") || !strcmp(ctx.arglist[0], "ALARM")) {
+			continue;
+		}
+
+		if ((ptr = strchr(ctx.arglist[0], ':')) != NULL) {
+			*ptr = '\0';
+		}
+
+		if (!strncmp(ctx.arglist[0], "driver.", 7)) {
+			continue;
+		}
+
+		snprintf(value, sizeof(value), "%s", ctx.arglist[1]);
+		for (i = 2; i < ctx.numargs; i++) {
+			snprintfcat(value, sizeof(value), " %s", ctx.arglist[i]);
+		}
+
+		var_add(ctx.arglist[0], value);
+	}
+
+	pconf_finish(&ctx);
+
+	if (!numvars) {
+		fatalx(EXIT_FAILURE, "No usable data in %s", seqfile);
+	}
+}
+
+static void write_all(int fd, const char *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t	ret = write(fd, buf, len);
+
+		if (ret < 0) {
+			if (errno == EINTR || errno == EAGAIN) {
+				continue;
+			}
+			fatal_with_errno(EXIT_FAILURE, "write to fd %d", fd);
+		}
+
+		buf += ret;
+		len -= (size_t)ret;
+	}
+}
+
+static void drv_setinfo(bench_drv_t *drv, const char *name, const char *value)
+{
+	char	esc[ST_MAX_VALUE_LEN * 2], line[ST_MAX_VALUE_LEN * 3];
+
+	pconf_encode(value, esc, sizeof(esc));
+	snprintf(line, sizeof(line), "SETINFO %s \"%s\"\n", name, esc);
+	write_all(drv->fd, line, strlen(line));
+	setinfo_sent++;
+}
+
+static void drv_dumpall(bench_drv_t *drv)
+{
+	size_t	i;
+
+	for (i = 0; i < numvars; i++) {
+		drv_setinfo(drv, vars[i].name, vars[i].value);
+	}
+
+	write_all(drv->fd, "DATAOK\nDUMPDONE\n", 16);
+	drv->dumped = 1;
+}
+
+/* send the next update: numeric values flip by one on every other pass,
+ * so that upsd sees actual changes and not just the same values again */
+static void drv_churn(bench_drv_t *drv)
+{
+	const bench_var_t	*v = &vars[drv->next_var];
+	char	value[SMALLBUF];
+
+	if (v->numeric && (drv->pass & 1)) {
+		snprintf(value, sizeof(value), "%g", v->num + 1);
+		drv_setinfo(drv, v->name, value);
+	} else {
+		drv_setinfo(drv, v->name, v->value);
+	}
+
+	if (++drv->next_var >= numvars) {
+		drv->next_var = 0;
+		drv->pass++;
+	}
+}
+
+static void drv_read(bench_drv_t *drv)
+{
+	ssize_t	ret;
+	char	*nl;
+
+	ret = read(drv->fd, drv->rbuf + drv->rlen, sizeof(drv->rbuf) - drv->rlen - 1);
+
+	if (ret <= 0) {
+		upslogx(LOG_WARNING, "upsd disconnected from driver %s", drv->upsname);
+		close(drv->fd);
+		drv->fd = -1;
+		drv->rlen = 0;
+		return;
+	}
+
+	drv->rlen += (size_t)ret;
+	drv->rbuf[drv->rlen] = '\0';
+
+	while ((nl = strchr(drv->rbuf, '\n')) != NULL) {
+		*nl = '\0';
+
+		if (!strcmp(drv->rbuf, "DUMPALL")) {
+			drv_dumpall(drv);
+		} else if (!strcmp(drv->rbuf, "PING")) {
+			write_all(drv->fd, "PONG\n", 5);
+		} else {
+			upsdebugx(3, "driver %s ignores [%s]", drv->upsname, drv->rbuf);
+		}
+
+		drv->rlen -= (size_t)(nl + 1 - drv->rbuf);
+		memmove(drv->rbuf, nl + 1, drv->rlen + 1);
+	}
+
+	if (drv->rlen >= sizeof(drv->rbuf) - 1) {
+		drv->rlen = 0;	/* garbage, drop it */
+	}
+}
+
+static void drv_accept(bench_drv_t *drv)
+{
+	int	fd = accept(drv->listen_fd, NULL, NULL);
+
+	if (fd < 0) {
+		return;
+	}
+
+	if (drv->fd >= 0) {
+		close(drv->fd);
+	}
+
+	drv->fd = fd;
+	drv->rlen = 0;
+	upsdebugx(2, "upsd connected to driver %s", drv->upsname);
+}
+
+static void drv_listen(bench_drv_t *drv)
+{
+	struct sockaddr_un	sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	if (strlen(drv->sockfn) >= sizeof(sa.sun_path)) {
+		fatalx(EXIT_FAILURE, "Socket path too long: %s", drv->sockfn);
+	}
+	snprintf(sa.sun_path, sizeof(sa.sun_path), "%s", drv->sockfn);
+
+	if ((drv->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		fatal_with_errno(EXIT_FAILURE, "socket");
+	}
+
+	if (bind(drv->listen_fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+		fatal_with_errno(EXIT_FAILURE, "bind %s", drv->sockfn);
+	}
+
+	if (listen(drv->listen_fd, 4) < 0) {
+		fatal_with_errno(EXIT_FAILURE, "listen %s", drv->sockfn);
+	}
+
+	drv->fd = -1;
+}
+
+/* find a TCP port nobody listens on right now */
+static uint16_t free_port(void)
+{
+	struct sockaddr_in	sa;
+	socklen_t	len = sizeof(sa);
+	int	fd;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0
+	 || bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0
+	 || getsockname(fd, (struct sockaddr *)&sa, &len) < 0
+	) {
+		fatal_with_errno(EXIT_FAILURE, "Can't find a free TCP port");
+	}
+
+	close(fd);
+	return ntohs(sa.sin_port);
+}
+
+static void write_file(const char *name, const char *content)
+{
+	char	fn[NUT_PATH_MAX + 1];
+	FILE	*f;
+
+	snprintf(fn, sizeof(fn), "%s/%s", tmpdir, name);
+
+	if ((f = fopen(fn, "w")) == NULL) {
+		fatal_with_errno(EXIT_FAILURE, "fopen %s", fn);
+	}
+
+	fputs(content, f);
+	fclose(f);
+	chmod(fn, 0600);
+}
+
+static void setup_sandbox(void)
+{
+	const char	*tmp = getenv("TMPDIR");
+	char	*upsconf;
+	char	buf[LARGEBUF];
+	size_t	i, upsconfsize;
+
+	if (snprintf(tmpdir, sizeof(tmpdir), "%s/nut-bench.XXXXXX", tmp ? tmp : "/tmp") >= (int)sizeof(tmpdir)) {
+		fatalx(EXIT_FAILURE, "TMPDIR is too long: %s", tmp);
+	}
+	if (!mkdtemp(tmpdir)) {
+		fatal_with_errno(EXIT_FAILURE, "mkdtemp %s", tmpdir);
+	}
+
+	upsconfsize = numdrvs * SMALLBUF + 1;
+	upsconf = xcalloc(1, upsconfsize);
+
+	drvs = xcalloc(numdrvs, sizeof(*drvs));
+	for (i = 0; i < numdrvs; i++) {
+		bench_drv_t	*drv = &drvs[i];
+
+		snprintf(drv->upsname, sizeof(drv->upsname), "bench%" PRIuSIZE, i);
+		/* upsd looks for <statepath>/<driver>-<upsname> */
+		snprintf(drv->sockfn, sizeof(drv->sockfn), "%s/nut-bench-%s", tmpdir, drv->upsname);
+		drv_listen(drv);
+
+		snprintfcat(upsconf, upsconfsize,
+			"[%s]\n\tdriver = nut-bench\n\tport = synthetic\n", drv->upsname);
+	}
+
+	write_file("ups.conf", upsconf);
+	free(upsconf);
+
+	snprintf(buf, sizeof(buf), "LISTEN 127.0.0.1 %u\nMAXCONN %" PRIuSIZE "\n",
+		(unsigned int)port, numdrvs + numclients + 64);
+	write_file("upsd.conf", buf);
+	write_file("upsd.users", "");
+}
+
+static void cleanup_sandbox(void)
+{
+	char	fn[NUT_PATH_MAX + 1];
+	size_t	i;
+	const char	*files[] = { "ups.conf", "upsd.conf", "upsd.users", "upsd.pid", "upsd.log", NULL };
+
+	if (!*tmpdir) {
+		return;
+	}
+
+	/* not stopped by report(), e.g. after a fatal error */
+	if (upsd_pid > 0) {
+		kill(upsd_pid, SIGTERM);
+		waitpid(upsd_pid, NULL, 0);
+		upsd_pid = -1;
+	}
+
+	for (i = 0; drvs && i < numdrvs; i++) {
+		if (drvs[i].listen_fd >= 0) {
+			close(drvs[i].listen_fd);
+		}
+		unlink(drvs[i].sockfn);
+	}
+
+	if (keep_tmpdir) {
+		printf("Kept sandbox directory %s\n", tmpdir);
+		return;
+	}
+
+	for (i = 0; files[i]; i++) {
+		snprintf(fn, sizeof(fn), "%s/%s", tmpdir, files[i]);
+		unlink(fn);
+	}
+
+	rmdir(tmpdir);
+}
+
+static void start_upsd(void)
+{
+	char	logfn[NUT_PATH_MAX + 1];
+
+	snprintf(logfn, sizeof(logfn), "%s/upsd.log", tmpdir);
+
+	upsd_pid = fork();
+
+	if (upsd_pid < 0) {
+		fatal_with_errno(EXIT_FAILURE, "fork");
+	}
+
+	if (upsd_pid == 0) {
+		int	fd = open(logfn, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+		if (fd >= 0) {
+			dup2(fd, STDOUT_FILENO);
+			dup2(fd, STDERR_FILENO);
+			close(fd);
+		}
+
+		setenv("NUT_CONFPATH", tmpdir, 1);
+		setenv("NUT_STATEPATH", tmpdir, 1);
+		setenv("NUT_ALTPIDPATH", tmpdir, 1);
+
+		/* when started as root, do not let upsd drop privileges
+		 * to a user which can not reach our sandbox */
+		if (geteuid() == 0) {
+			execl(upsd_path, "upsd", "-F", "-u", "root", (char *)NULL);
+		} else {
+			execl(upsd_path, "upsd", "-F", (char *)NULL);
+		}
+
+		fprintf(stderr, "Can't run %s: %s\n", upsd_path, strerror(errno));
+		_exit(EXIT_FAILURE);
+	}
+}
+
+/* stop upsd and collect its resource usage */
+static void stop_upsd(double *cpu_user, double *cpu_sys, long *maxrss_kb)
+{
+	struct rusage	ru;
+	int	status;
+
+	*cpu_user = *cpu_sys = 0;
+	*maxrss_kb = 0;
+
+	if (upsd_pid <= 0) {
+		return;
+	}
+
+	kill(upsd_pid, SIGTERM);
+	waitpid(upsd_pid, &status, 0);
+	upsd_pid = -1;
+
+	if (getrusage(RUSAGE_CHILDREN, &ru) == 0) {
+		*cpu_user = (double)ru.ru_utime.tv_sec + (double)ru.ru_utime.tv_usec / 1000000.0;
+		*cpu_sys = (double)ru.ru_stime.tv_sec + (double)ru.ru_stime.tv_usec / 1000000.0;
+		/* kilobytes on Linux and BSD, bytes on macOS */
+		*maxrss_kb = ru.ru_maxrss;
+	}
+}
+
+static int client_connect(void)
+{
+	struct sockaddr_in	sa;
+	int	fd;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_port = htons(port);
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+		fatal_with_errno(EXIT_FAILURE, "socket");
+	}
+
+	if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static void client_send(bench_client_t *client)
+{
+	unsigned int	r = (unsigned int)random() % (mix[REQ_GET] + mix[REQ_LIST] + mix[REQ_WATCH]);
+	const bench_drv_t	*drv = &drvs[(size_t)random() % numdrvs];
+	char	line[LARGEBUF];
+
+	if (r < mix[REQ_GET]) {
+		client->type = REQ_GET;
+		snprintf(line, sizeof(line), "GET VAR %s %s\n",
+			drv->upsname, vars[(size_t)random() % numvars].name);
+	} else if (r < mix[REQ_GET] + mix[REQ_LIST]) {
+		client->type = REQ_LIST;
+		snprintf(line, sizeof(line), "LIST VAR %s\n", drv->upsname);
+	} else {
+		client->type = REQ_WATCH;
+		snprintf(line, sizeof(line), "GET VAR %s ups.status\n", drv->upsname);
+	}
+
+	client->busy = 1;
+	client->sent = bench_now();
+	write_all(client->fd, line, strlen(line));
+}
+
+static void sample_add(bench_samples_t *s, double elapsed)
+{
+	if (s->count >= s->alloc) {
+		s->alloc = s->alloc ? s->alloc * 2 : 65536;
+		s->usec = xrealloc(s->usec, s->alloc * sizeof(*s->usec));
+	}
+
+	s->usec[s->count++] = (uint32_t)(elapsed * 1000000.0);
+}
+
+/* returns 1 when a complete answer was consumed */
+static int client_read(bench_client_t *client)
+{
+	ssize_t	ret;
+	char	*line, *nl;
+	int	done = 0;
+
+	ret = read(client->fd, client->rbuf + client->rlen, sizeof(client->rbuf) - client->rlen - 1);
+
+	if (ret <= 0) {
+		keep_tmpdir = 1;
+		fatalx(EXIT_FAILURE, "upsd closed a client connection (see %s/upsd.log)", tmpdir);
+	}
+
+	client->rlen += (size_t)ret;
+	client->rbuf[client->rlen] = '\0';
+
+	line = client->rbuf;
+	while (!done && (nl = strchr(line, '\n')) != NULL) {
+		*nl = '\0';
+
+		if (!strncmp(line, "ERR ", 4)) {
+			samples[client->type].errors++;
+			done = 1;
+		} else if (client->type != REQ_LIST || !strncmp(line, "END LIST", 8)) {
+			done = 1;
+		}
+
+		line = nl + 1;
+	}
+
+	client->rlen -= (size_t)(line - client->rbuf);
+	memmove(client->rbuf, line, client->rlen + 1);
+
+	if (client->rlen >= sizeof(client->rbuf) - 1) {
+		client->rlen = 0;	/* one very long line, forget its start */
+	}
+
+	if (done) {
+		sample_add(&samples[client->type], bench_now() - client->sent);
+		client->busy = 0;
+	}
+
+	return done;
+}
+
+static int cmp_uint32(const void *a, const void *b)
+{
+	uint32_t	x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const bench_samples_t *s, unsigned int pct)
+{
+	size_t	idx;
+
+	if (!s->count) {
+		return 0;
+	}
+
+	idx = (s->count * pct + 99) / 100;
+	return s->usec[idx ? idx - 1 : 0];
+}
+
+static void report_line(const char *name, bench_samples_t *s, double elapsed)
+{
+	if (!s->count) {
+		printf("  %-6s %10s\n", name, "-");
+		return;
+	}
+
+	qsort(s->usec, s->count, sizeof(*s->usec), cmp_uint32);
+
+	printf("  %-6s %10" PRIuSIZE " %10.1f %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu64 "\n",
+		name, s->count, (double)s->count / elapsed,
+		percentile(s, 50), percentile(s, 99), s->usec[s->count - 1], s->errors);
+}
+
+static void report(double elapsed)
+{
+	bench_samples_t	all;
+	double	cpu_user, cpu_sys;
+	long	maxrss;
+	size_t	i;
+
+	stop_upsd(&cpu_user, &cpu_sys, &maxrss);
+
+	memset(&all, 0, sizeof(all));
+	for (i = 0; i < REQ_TYPES; i++) {
+		size_t	j;
+
+		for (j = 0; j < samples[i].count; j++) {
+			sample_add(&all, (double)samples[i].usec[j] / 1000000.0);
+		}
+		all.errors += samples[i].errors;
+	}
+
+	printf("nut-bench: %" PRIuSIZE " drivers x %" PRIuSIZE " variables, %" PRIuSIZE " clients, %.1f sec, mix GET:LIST:WATCH %u:%u:%u\n",
+		numdrvs, numvars, numclients, elapsed, mix[REQ_GET], mix[REQ_LIST], mix[REQ_WATCH]);
+	printf("  %-6s %10s %10s %8s %8s %8s %8s\n",
+		"", "requests", "req/s", "p50(us)", "p99(us)", "max(us)", "errors");
+
+	for (i = 0; i < REQ_TYPES; i++) {
+		report_line(reqnames[i], &samples[i], elapsed);
+	}
+	report_line("all", &all, elapsed);
+
+	printf("  driver updates: %" PRIu64 " SETINFO (%.1f/s)\n",
+		setinfo_sent, (double)setinfo_sent / elapsed);
+	printf("  upsd: CPU user %.2fs + system %.2fs (%.1f%% of one core), max RSS %ld KiB\n",
+		cpu_user, cpu_sys, 100.0 * (cpu_user + cpu_sys) / elapsed, maxrss);
+
+	free(all.usec);
+}
+
+static void run(void)
+{
+	struct pollfd	*fds;
+	size_t	nfds = 2 * numdrvs + numclients, i;
+	double	start, now, deadline, churn_step;
+	int	fd = -1;
+
+	fds = xcalloc(nfds, sizeof(*fds));
+
+	/* wait for upsd to listen, then for it to connect to all drivers */
+	deadline = bench_now() + 15;
+	for (;;) {
+		size_t	dumped = 0;
+		int	status;
+
+		if (waitpid(upsd_pid, &status, WNOHANG) == upsd_pid) {
+			upsd_pid = -1;
+			keep_tmpdir = 1;
+			fatalx(EXIT_FAILURE, "upsd exited early (see %s/upsd.log)", tmpdir);
+		}
+
+		for (i = 0; i < numdrvs; i++) {
+			fds[2 * i].fd = drvs[i].listen_fd;
+			fds[2 * i].events = POLLIN;
+			fds[2 * i + 1].fd = drvs[i].fd;
+			fds[2 * i + 1].events = POLLIN;
+		}
+
+		if (poll(fds, 2 * numdrvs, 100) > 0) {
+			for (i = 0; i < numdrvs; i++) {
+				if (fds[2 * i].revents & POLLIN)
+					drv_accept(&drvs[i]);
+				if (fds[2 * i + 1].fd >= 0 && (fds[2 * i + 1].revents & (POLLIN | POLLHUP)))
+					drv_read(&drvs[i]);
+			}
+		}
+
+		for (i = 0; i < numdrvs; i++) {
+			dumped += drvs[i].dumped;
+		}
+
+		if (fd < 0) {
+			fd = client_connect();
+		}
+
+		if (fd >= 0 && dumped == numdrvs) {
+			close(fd);
+			break;
+		}
+
+		if (bench_now() > deadline) {
+			keep_tmpdir = 1;
+			fatalx(EXIT_FAILURE, "upsd did not get ready in time: %" PRIuSIZE " of %" PRIuSIZE
+				" drivers dumped (see %s/upsd.log)", dumped, numdrvs, tmpdir);
+		}
+	}
+
+	clients = xcalloc(numclients, sizeof(*clients));
+	for (i = 0; i < numclients; i++) {
+		if ((clients[i].fd = client_connect()) < 0) {
+			fatal_with_errno(EXIT_FAILURE, "client %" PRIuSIZE " can't connect to upsd", i);
+		}
+	}
+
+	memset(samples, 0, sizeof(samples));
+	setinfo_sent = 0;
+
+	start = now = bench_now();
+	deadline = start + duration;
+	churn_step = (churn_rate > 0) ? 1.0 / churn_rate : 0;
+
+	for (i = 0; i < numdrvs; i++) {
+		/* spread the driver updates over the period */
+		drvs[i].next_churn = start + churn_step * (double)i / (double)numdrvs;
+	}
+
+	for (i = 0; i < numclients; i++) {
+		client_send(&clients[i]);
+	}
+
+	while (now < deadline) {
+		double	next = deadline;
+		int	timeout;
+
+		for (i = 0; i < numdrvs; i++) {
+			bench_drv_t	*drv = &drvs[i];
+
+			if (churn_step > 0 && drv->fd >= 0 && drv->dumped) {
+				/* catch up, but do not flood after a stall */
+				if (now - drv->next_churn > 1.0)
+					drv->next_churn = now;
+
+				while (drv->next_churn <= now) {
+					drv_churn(drv);
+					drv->next_churn += churn_step;
+				}
+
+				if (drv->next_churn < next)
+					next = drv->next_churn;
+			}
+
+			fds[2 * i].fd = drv->listen_fd;
+			fds[2 * i].events = POLLIN;
+			fds[2 * i + 1].fd = drv->fd;
+			fds[2 * i + 1].events = POLLIN;
+		}
+
+		for (i = 0; i < numclients; i++) {
+			fds[2 * numdrvs + i].fd = clients[i].fd;
+			fds[2 * numdrvs + i].events = POLLIN;
+		}
+
+		timeout = (int)((next - now) * 1000.0);
+		if (timeout < 0)
+			timeout = 0;
+
+		if (poll(fds, nfds, timeout) > 0) {
+			for (i = 0; i < numdrvs; i++) {
+				if (fds[2 * i].revents & POLLIN)
+					drv_accept(&drvs[i]);
+				if (fds[2 * i + 1].fd >= 0 && (fds[2 * i + 1].revents & (POLLIN | POLLHUP)))
+					drv_read(&drvs[i]);
+			}
+
+			for (i = 0; i < numclients; i++) {
+				if (!(fds[2 * numdrvs + i].revents & (POLLIN | POLLHUP)))
+					continue;
+
+				if (client_read(&clients[i]))
+					client_send(&clients[i]);
+			}
+		}
+
+		now = bench_now();
+	}
+
+	for (i = 0; i < numclients; i++) {
+		close(clients[i].fd);
+	}
+
+	free(fds);
+	report(now - start);
+}
+
+static void usage(const char *prog)
+{
+	printf("Load generator and benchmark harness for upsd.\n\n");
+	printf("usage: %s [OPTIONS]\n\n", prog);
+	printf("  -u <path>     upsd binary to test (default: %s)\n", upsd_path);
+	printf("  -s <file>     dummy-ups .seq/.dev file with device data\n");
+	printf("                (default: a small built-in data set)\n");
+	printf("  -n <num>      synthetic drivers (default: %" PRIuSIZE ")\n", numdrvs);
+	printf("  -c <num>      concurrent clients (default: %" PRIuSIZE ")\n", numclients);
+	printf("  -t <sec>      measurement duration (default: %.0f)\n", duration);
+	printf("  -r <rate>     SETINFO updates per second per driver (default: %.0f)\n", churn_rate);
+	printf("  -m <g:l:w>    weights of GET VAR, LIST VAR and watch (polling\n");
+	printf("                GET VAR ups.status) requests (default: %u:%u:%u)\n",
+		mix[REQ_GET], mix[REQ_LIST], mix[REQ_WATCH]);
+	printf("  -p <port>     TCP port for upsd (default: pick a free one)\n");
+	printf("  -S <seed>     random seed (default: 1)\n");
+	printf("  -k            keep the sandbox directory (with upsd.log)\n");
+	printf("  -D            raise debugging level\n");
+	printf("  -h            display this help\n");
+}
+
+int main(int argc, char **argv)
+{
+	int	i;
+	unsigned int	seed = 1;
+	unsigned long	ul;
+
+	while ((i = getopt(argc, argv, "+u:s:n:c:t:r:m:p:S:kDh")) != -1) {
+		switch (i) {
+			case 'u':
+				upsd_path = optarg;
+				break;
+			case 's':
+				seqfile = optarg;
+				break;
+			case 'n':
+				if (!str_to_ulong(optarg, &ul, 10) || ul < 1)
+					fatalx(EXIT_FAILURE, "Invalid number of drivers: %s", optarg);
+				numdrvs = (size_t)ul;
+				break;
+			case 'c':
+				if (!str_to_ulong(optarg, &ul, 10) || ul < 1)
+					fatalx(EXIT_FAILURE, "Invalid number of clients: %s", optarg);
+				numclients = (size_t)ul;
+				break;
+			case 't':
+				if (!str_to_double(optarg, &duration, 10) || duration <= 0)
+					fatalx(EXIT_FAILURE, "Invalid duration: %s", optarg);
+				break;
+			case 'r':
+				if (!str_to_double(optarg, &churn_rate, 10) || churn_rate < 0)
+					fatalx(EXIT_FAILURE, "Invalid update rate: %s", optarg);
+				break;
+			case 'm':
+				if (sscanf(optarg, "%u:%u:%u", &mix[REQ_GET], &mix[REQ_LIST], &mix[REQ_WATCH]) != 3
+				 || !(mix[REQ_GET] + mix[REQ_LIST] + mix[REQ_WATCH]))
+					fatalx(EXIT_FAILURE, "Invalid request mix: %s", optarg);
+				break;
+			case 'p':
+				if (!str_to_ulong(optarg, &ul, 10) || ul < 1 || ul > 65535)
+					fatalx(EXIT_FAILURE, "Invalid port: %s", optarg);
+				port = (uint16_t)ul;
+				break;
+			case 'S':
+				if (!str_to_ulong(optarg, &ul, 10))
+					fatalx(EXIT_FAILURE, "Invalid seed: %s", optarg);
+				seed = (unsigned int)ul;
+				break;
+			case 'k':
+				keep_tmpdir = 1;
+				break;
+			case 'D':
+				nut_debug_level++;
+				break;
+			case 'h':
+				usage(argv[0]);
+				exit(EXIT_SUCCESS);
+			default:
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+		}
+	}
+
+	srandom(seed);
+	signal(SIGPIPE, SIG_IGN);
+
+	seq_load();
+
+	if (!port) {
+		port = free_port();
+	}
+
+	setup_sandbox();
+	atexit(cleanup_sandbox);
+
+	start_upsd();
+	run();
+
+	return EXIT_SUCCESS;
+}
+
+#else	/* WIN32 */
+
+int main(int argc, char **argv)
+{
+	NUT_UNUSED_VARIABLE(argc);
+	NUT_UNUSED_VARIABLE(argv);
+
+	fprintf(stderr, "nut-bench is not implemented for Windows builds\n");
+	return EXIT_FAILURE;
+}
+
+#endif	/* WIN32 */
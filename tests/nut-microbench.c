@@ -0,0 +1,735 @@
+/*  nut-microbench.c - micro-benchmarks of hot shared code paths
+ *
+ *  Measures the state tree (common/state.c), the configuration and
+ *  protocol parser (common/parseconf.c) and, when built with USB support,
+ *  the HID report parser (drivers/hidparser.c) on realistic fixtures:
+ *  a large device state tree, a driver socket stream (synthesized from
+ *  a dummy-ups data file or replayed from a recording), and a UPS report
+ *  descriptor laid out like those handled by usbhid-ups subdrivers.
+ *
+ *  For each case it prints the time per operation and, where the C
+ *  library allows to count them (glibc), heap allocations per operation,
+ *  so that data structure changes can be compared objectively.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#include "config.h"
+#include "common.h"
+#include "nut_stdint.h"
+#include "state.h"
+#include "parseconf.h"
+#include "nut-bench-common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef NUT_MICROBENCH_HIDPARSER
+# include "hidparser.h"
+#endif
+
+/* Counting allocations: glibc lets a program interpose malloc() and
+ * friends and still reach the original implementation, which also
+ * covers allocations made inside the C library (e.g. by strdup()).
+ * Elsewhere (and under sanitizers) the counts are reported as n/a. */
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(WIN32)
+# define NUT_MICROBENCH_COUNT_ALLOCS 1
+
+static uint64_t	alloc_count = 0;
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+	alloc_count++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	alloc_count++;
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	alloc_count++;
+	return __libc_realloc(ptr, size);
+}
+#endif	/* __GLIBC__ */
+
+typedef struct {
+	const char	*name;
+	void	(*setup)(void);
+	void	(*run)(size_t iterations);
+	void	(*teardown)(void);
+} bench_t;
+
+/* fixtures */
+static char	**names = NULL, **values = NULL;
+static size_t	numnames = 0, tree_size = 500;
+
+static char	*stream = NULL;
+static size_t	streamlen = 0, streamlines = 0;
+
+static st_tree_t	*tree = NULL;
+static PCONF_CTX_t	ctx;
+
+/* keeps results alive, so the compiler can not drop the calls */
+static volatile size_t	sink;
+
+static double	target_time = 0.2;
+static const char	*seqfile = NULL, *recfile = NULL;
+
+/* data points of each synthetic outlet (as in an ePDU) */
+static const char	*outlet_data[] = {
+	"id", "desc", "status", "switchable", "current", "realpower",
+	"power", "powerfactor", "voltage", "delay.shutdown", "delay.start",
+	NULL
+};
+
+static void name_add(const char *name, const char *value)
+{
+	size_t	i;
+
+	/* data files list the same variable once per TIMER section */
+	for (i = 0; i < numnames; i++) {
+		if (!strcasecmp(names[i], name))
+			return;
+	}
+
+	names = xrealloc(names, (numnames + 1) * sizeof(*names));
+	values = xrealloc(values, (numnames + 1) * sizeof(*values));
+	names[numnames] = xstrdup(name);
+	values[numnames] = xstrdup(value);
+	numnames++;
+}
+
+static void seq_err(const char *errmsg)
+{
+	upslogx(LOG_ERR, "Parse error in %s: %s", seqfile, errmsg);
+}
+
+/* device data from a dummy-ups file, in its order (as a driver would
+ * publish it), padded with outlet data points up to tree_size */
+static void load_names(void)
+{
+	size_t	i, outlet;
+
+	if (seqfile) {
+		PCONF_CTX_t	sctx;
+
+		pconf_init(&sctx, seq_err);
+		if (!pconf_file_begin(&sctx, seqfile)) {
+			fatalx(EXIT_FAILURE, "Can't open %s: %s", seqfile, sctx.errmsg);
+		}
+
+		while (pconf_file_next(&sctx)) {
+			char	*ptr;
+
+			if (pconf_parse_error(&sctx) || sctx.numargs < 2
+			 || !strcmp(sctx.arglist[0], "TIMER") || !strcmp(sctx.arglist[0], "ALARM")) {
+				continue;
+			}
+
+			if ((ptr = strchr(sctx.arglist[0], ':')) != NULL) {
+				*ptr = '\0';
+			}
+
+			name_add(sctx.arglist[0], sctx.arglist[1]);
+		}
+
+		pconf_finish(&sctx);
+	} else {
+		for (i = 0; bench_default_data[i]; i += 2) {
+			name_add(bench_default_data[i], bench_default_data[i + 1]);
+		}
+	}
+
+	for (outlet = 1; numnames < tree_size; outlet++) {
+		for (i = 0; outlet_data[i] && numnames < tree_size; i++) {
+			char	name[SMALLBUF], value[SMALLBUF];
+
+			snprintf(name, sizeof(name), "outlet.%" PRIuSIZE ".%s", outlet, outlet_data[i]);
+			snprintf(value, sizeof(value), "%" PRIuSIZE, outlet * 10 + i);
+			name_add(name, value);
+		}
+	}
+}
+
+/* what a driver sends upsd in reply to DUMPALL */
+static void load_stream(void)
+{
+	size_t	i, alloc = 0;
+
+	if (recfile) {
+		FILE	*f = fopen(recfile, "rb");
+		char	buf[LARGEBUF];
+		size_t	len;
+
+		if (!f) {
+			fatal_with_errno(EXIT_FAILURE, "Can't open %s", recfile);
+		}
+
+		while ((len = fread(buf, 1, sizeof(buf), f)) > 0) {
+			stream = xrealloc(stream, streamlen + len);
+			memcpy(stream + streamlen, buf, len);
+			streamlen += len;
+		}
+
+		fclose(f);
+	} else {
+		for (i = 0; i < numnames; i++) {
+			char	esc[ST_MAX_VALUE_LEN * 2], line[ST_MAX_VALUE_LEN * 3];
+			size_t	len;
+
+			pconf_encode(values[i], esc, sizeof(esc));
+			len = (size_t)snprintf(line, sizeof(line), "SETINFO %s \"%s\"\n", names[i], esc);
+
+			if (streamlen + len > alloc) {
+				alloc = (alloc + len) * 2;
+				stream = xrealloc(stream, alloc);
+			}
+
+			memcpy(stream + streamlen, line, len);
+			streamlen += len;
+		}
+	}
+
+	for (i = 0; i < streamlen; i++) {
+		if (stream[i] == '\n')
+			streamlines++;
+	}
+
+	if (!streamlines) {
+		fatalx(EXIT_FAILURE, "No complete lines in the driver stream");
+	}
+}
+
+/* state tree */
+
+static void tree_fill(void)
+{
+	size_t	i;
+
+	for (i = 0; i < numnames; i++) {
+		state_setinfo(&tree, names[i], values[i]);
+	}
+}
+
+static void tree_free(void)
+{
+	state_infofree(tree);
+	tree = NULL;
+}
+
+static void run_setinfo_new(size_t n)
+{
+	size_t	i;
+
+	for (i = 0; i < n; i++) {
+		size_t	idx = i % numnames;
+
+		if (!idx && tree) {
+			tree_free();
+		}
+
+		sink += (size_t)state_setinfo(&tree, names[idx], values[idx]);
+	}
+}
+
+static void run_setinfo_same(size_t n)
+{
+	size_t	i;
+
+	for (i = 0; i < n; i++) {
+		size_t	idx = i % numnames;
+
+		sink += (size_t)state_setinfo(&tree, names[idx], values[idx]);
+	}
+}
+
+/* every update changes the value, as with live measurements */
+static void run_setinfo_change(size_t n)
+{
+	size_t	i;
+
+	for (i = 0; i < n; i++) {
+		size_t	idx = i % numnames;
+
+		sink += (size_t)state_setinfo(&tree, names[idx],
+			((i / numnames) & 1) ? "231.5" : values[idx]);
+	}
+}
+
+/* values which need escaping on their way to clients */
+static void run_setinfo_escape(size_t n)
+{
+	size_t	i;
+
+	for (i = 0; i < n; i++) {
+		size_t	idx = i % numnames;
+
+		sink += (size_t)state_setinfo(&tree, names[idx],
+			((i / numnames) & 1) ? "say \"hi\" \\ bye" : "say \"bye\" \\ hi");
+	}
+}
+
+static void run_getinfo(size_t n)
+{
+	size_t	i;
+
+	for (i = 0; i < n; i++) {
+		sink += (size_t)state_getinfo(tree, names[i % numnames]);
+	}
+}
+
+static void run_getinfo_miss(size_t n)
+{
+	size_t	i;
+
+	for (i = 0; i < n; i++) {
+		sink += (size_t)state_getinfo(tree, (i & 1) ? "ups.nonexistent" : "zzz.last");
+	}
+}
+
+/* parseconf */
+
+static void parse_err(const char *errmsg)
+{
+	upslogx(LOG_ERR, "Parse error: %s", errmsg);
+}
+
+static void ctx_init(void)
+{
+	pconf_init(&ctx, parse_err);
+}
+
+static void ctx_free(void)
+{
+	pconf_finish(&ctx);
+}
+
+/* one operation is one line, fed byte by byte as sstate_readline() does */
+static void run_pconf_char(size_t n)
+{
+	size_t	lines = 0, pos = 0;
+
+	while (lines < n) {
+		if (pconf_char(&ctx, stream[pos]) == 1) {
+			sink += ctx.numargs;
+			lines++;
+		}
+
+		if (++pos >= streamlen)
+			pos = 0;
+	}
+}
+
+/* same, but handed over in SMALLBUF-sized reads as the servers now do */
+static void run_pconf_buffer(size_t n)
+{
+	size_t	lines = 0, pos = 0, end = 0, used;
+
+	while (lines < n) {
+		if (pos >= end) {
+			if (pos >= streamlen)
+				pos = 0;
+			end = pos + SMALLBUF;
+			if (end > streamlen)
+				end = streamlen;
+		}
+
+		if (pconf_buffer(&ctx, stream + pos, end - pos, &used) == 1) {
+			sink += ctx.numargs;
+			lines++;
+		}
+
+		pos += used;
+	}
+}
+
+static void run_pconf_encode(size_t n)
+{
+	char	dest[ST_MAX_VALUE_LEN];
+	size_t	i;
+
+	for (i = 0; i < n; i++) {
+		sink += (size_t)pconf_encode((i & 1) ? values[i % numnames] : "say \"hi\" \\ bye",
+			dest, sizeof(dest))[0];
+	}
+}
+
+#ifdef NUT_MICROBENCH_HIDPARSER
+
+/* Report descriptor of a typical HID Power Device UPS: a summary with
+ * battery capacity, runtime and status bits (input and feature), input
+ * and output measurements, and the shutdown/startup delays (which the
+ * drivers also write).  Usages follow the paths mapped in subdrivers
+ * like apc-hid.c, cps-hid.c and mge-hid.c. */
+static unsigned char	report_desc[] = {
+	0x05, 0x84,		/* Usage Page (Power Device) */
+	0x09, 0x04,		/* Usage (UPS) */
+	0xA1, 0x01,		/* Collection (Application) */
+	 0x09, 0x24,		/*  Usage (PowerSummary) */
+	 0xA1, 0x02,		/*  Collection (Logical) */
+	  0x75, 0x08,		/*   Report Size (8) */
+	  0x95, 0x01,		/*   Report Count (1) */
+	  0x15, 0x00,		/*   Logical Minimum (0) */
+	  0x26, 0xFF, 0x00,	/*   Logical Maximum (255) */
+	  0x85, 0x06,		/*   Report ID (6) */
+	  0x05, 0x85,		/*   Usage Page (Battery System) */
+	  0x09, 0x66,		/*   Usage (RemainingCapacity) */
+	  0xB1, 0x02,		/*   Feature (Data,Var,Abs) */
+	  0x09, 0x66,		/*   Usage (RemainingCapacity) */
+	  0x81, 0x02,		/*   Input (Data,Var,Abs) */
+	  0x09, 0x29,		/*   Usage (RemainingCapacityLimit) */
+	  0xB1, 0x02,		/*   Feature (Data,Var,Abs) */
+	  0x85, 0x07,		/*   Report ID (7) */
+	  0x75, 0x10,		/*   Report Size (16) */
+	  0x27, 0xFE, 0xFF, 0x00, 0x00,	/*   Logical Maximum (65534) */
+	  0x66, 0x01, 0x10,	/*   Unit (Seconds) */
+	  0x09, 0x68,		/*   Usage (RunTimeToEmpty) */
+	  0xB1, 0x02,		/*   Feature (Data,Var,Abs) */
+	  0x09, 0x68,		/*   Usage (RunTimeToEmpty) */
+	  0x81, 0x02,		/*   Input (Data,Var,Abs) */
+	  0x65, 0x00,		/*   Unit (None) */
+	  0x85, 0x08,		/*   Report ID (8) */
+	  0x05, 0x84,		/*   Usage Page (Power Device) */
+	  0x09, 0x02,		/*   Usage (PresentStatus) */
+	  0xA1, 0x02,		/*   Collection (Logical) */
+	   0x05, 0x85,		/*    Usage Page (Battery System) */
+	   0x09, 0x44,		/*    Usage (Charging) */
+	   0x09, 0x45,		/*    Usage (Discharging) */
+	   0x09, 0xD0,		/*    Usage (ACPresent) */
+	   0x09, 0x42,		/*    Usage (BelowRemainingCapacityLimit) */
+	   0x09, 0x4B,		/*    Usage (NeedReplacement) */
+	   0x05, 0x84,		/*    Usage Page (Power Device) */
+	   0x09, 0x69,		/*    Usage (ShutdownImminent) */
+	   0x09, 0x65,		/*    Usage (Overload) */
+	   0x09, 0x62,		/*    Usage (CommunicationLost) */
+	   0x75, 0x01,		/*    Report Size (1) */
+	   0x95, 0x08,		/*    Report Count (8) */
+	   0x25, 0x01,		/*    Logical Maximum (1) */
+	   0xB1, 0x02,		/*    Feature (Data,Var,Abs) */
+	  0xC0,			/*   End Collection */
+	  0x85, 0x09,		/*   Report ID (9) */
+	  0x09, 0x02,		/*   Usage (PresentStatus) */
+	  0xA1, 0x02,		/*   Collection (Logical) */
+	   0x05, 0x85,		/*    Usage Page (Battery System) */
+	   0x09, 0x44,		/*    Usage (Charging) */
+	   0x09, 0x45,		/*    Usage (Discharging) */
+	   0x09, 0xD0,		/*    Usage (ACPresent) */
+	   0x09, 0x42,		/*    Usage (BelowRemainingCapacityLimit) */
+	   0x81, 0x02,		/*    Input (Data,Var,Abs) */
+	   0x95, 0x04,		/*    Report Count (4) */
+	   0x81, 0x03,		/*    Input (Const,Var,Abs) */
+	  0xC0,			/*   End Collection */
+	 0xC0,			/*  End Collection */
+	 0x05, 0x84,		/*  Usage Page (Power Device) */
+	 0x75, 0x10,		/*  Report Size (16) */
+	 0x95, 0x01,		/*  Report Count (1) */
+	 0x15, 0x00,		/*  Logical Minimum (0) */
+	 0x26, 0xFF, 0x7F,	/*  Logical Maximum (32767) */
+	 0x55, 0x0F,		/*  Unit Exponent (-1) */
+	 0x09, 0x1A,		/*  Usage (Input) */
+	 0xA1, 0x02,		/*  Collection (Logical) */
+	  0x85, 0x10,		/*   Report ID (16) */
+	  0x67, 0x21, 0xD1, 0xF0, 0x00,	/*   Unit (Volts) */
+	  0x09, 0x30,		/*   Usage (Voltage) */
+	  0xB1, 0x02,		/*   Feature (Data,Var,Abs) */
+	  0x09, 0x53,		/*   Usage (LowVoltageTransfer) */
+	  0xB1, 0x02,		/*   Feature (Data,Var,Abs) */
+	  0x09, 0x54,		/*   Usage (HighVoltageTransfer) */
+	  0xB1, 0x02,		/*   Feature (Data,Var,Abs) */
+	  0x85, 0x11,		/*   Report ID (17) */
+	  0x66, 0x01, 0xF0,	/*   Unit (Hertz) */
+	  0x09, 0x32,		/*   Usage (Frequency) */
+	  0xB1, 0x02,		/*   Feature (Data,Var,Abs) */
+	 0xC0,			/*  End Collection */
+	 0x09, 0x1C,		/*  Usage (Output) */
+	 0xA1, 0x02,		/*  Collection (Logical) */
+	  0x85, 0x12,		/*   Report ID (18) */
+	  0x67, 0x21, 0xD1, 0xF0, 0x00,	/*   Unit (Volts) */
+	  0x09, 0x30,		/*   Usage (Voltage) */
+	  0xB1, 0x02,		/*   Feature (Data,Var,Abs) */
+	  0x67, 0x01, 0x00, 0x10, 0x00,	/*   Unit (Amperes) */
+	  0x09, 0x31,		/*   Usage (Current) */
+	  0xB1, 0x02,		/*   Feature (Data,Var,Abs) */
+	  0x65, 0x00,		/*   Unit (None) */
+	  0x55, 0x00,		/*   Unit Exponent (0) */
+	  0x75, 0x08,		/*   Report Size (8) */
+	  0x26, 0xFF, 0x00,	/*   Logical Maximum (255) */
+	  0x09, 0x35,		/*   Usage (PercentLoad) */
+	  0xB1, 0x02,		/*   Feature (Data,Var,Abs) */
+	  0x09, 0x35,		/*   Usage (PercentLoad) */
+	  0x81, 0x02,		/*   Input (Data,Var,Abs) */
+	 0xC0,			/*  End Collection */
+	 0x75, 0x10,		/*  Report Size (16) */
+	 0x15, 0xFF,		/*  Logical Minimum (-1) */
+	 0x26, 0xFF, 0x7F,	/*  Logical Maximum (32767) */
+	 0x66, 0x01, 0x10,	/*  Unit (Seconds) */
+	 0x85, 0x13,		/*  Report ID (19) */
+	 0x09, 0x57,		/*  Usage (DelayBeforeShutdown) */
+	 0xB1, 0x02,		/*  Feature (Data,Var,Abs) */
+	 0x85, 0x14,		/*  Report ID (20) */
+	 0x09, 0x56,		/*  Usage (DelayBeforeStartup) */
+	 0xB1, 0x02,		/*  Feature (Data,Var,Abs) */
+	 0x85, 0x15,		/*  Report ID (21) */
+	 0x09, 0x55,		/*  Usage (DelayBeforeReboot) */
+	 0xB1, 0x02,		/*  Feature (Data,Var,Abs) */
+	0xC0			/* End Collection */
+};
+
+static HIDDesc_t	*hid_desc = NULL;
+
+/* report buffers, starting with the report ID as received from the device */
+static unsigned char	hid_reports[256][64];
+
+static void hid_parse(void)
+{
+	size_t	i;
+
+	hid_desc = Parse_ReportDesc(report_desc, (usb_ctrl_charbufsize)sizeof(report_desc));
+	if (!hid_desc || !hid_desc->nitems) {
+		fatalx(EXIT_FAILURE, "Can't parse the built-in report descriptor");
+	}
+
+	for (i = 0; i < 256; i++) {
+		size_t	j;
+
+		hid_reports[i][0] = (unsigned char)i;
+		for (j = 1; j < sizeof(hid_reports[i]); j++) {
+			hid_reports[i][j] = (unsigned char)(i * 7 + j * 13);
+		}
+	}
+}
+
+static void hid_free(void)
+{
+	Free_ReportDesc(hid_desc);
+	hid_desc = NULL;
+}
+
+static void run_hid_parse(size_t n)
+{
+	size_t	i;
+
+	for (i = 0; i < n; i++) {
+		HIDDesc_t	*desc = Parse_ReportDesc(report_desc, (usb_ctrl_charbufsize)sizeof(report_desc));
+
+		sink += desc->nitems;
+		Free_ReportDesc(desc);
+	}
+}
+
+/* what libhid does to locate the item mapped to a subdriver path */
+static void run_hid_find(size_t n)
+{
+	size_t	i;
+
+	for (i = 0; i < n; i++) {
+		HIDData_t	*item = &hid_desc->item[i % hid_desc->nitems];
+
+		sink += (size_t)FindObject_with_Path(hid_desc, &item->Path, item->Type);
+	}
+}
+
+static void run_hid_getvalue(size_t n)
+{
+	size_t	i;
+
+	for (i = 0; i < n; i++) {
+		HIDData_t	*item = &hid_desc->item[i % hid_desc->nitems];
+		long	value;
+
+		GetValue(hid_reports[item->ReportID], item, &value);
+		sink += (size_t)value;
+	}
+}
+
+static void run_hid_setvalue(size_t n)
+{
+	size_t	i;
+
+	for (i = 0; i < n; i++) {
+		HIDData_t	*item = &hid_desc->item[i % hid_desc->nitems];
+
+		SetValue(item, hid_reports[item->ReportID], (long)(i & 0x7f));
+	}
+}
+
+#endif	/* NUT_MICROBENCH_HIDPARSER */
+
+static bench_t	benches[] = {
+	{ "state_setinfo/new",		NULL,		run_setinfo_new,	tree_free },
+	{ "state_setinfo/same",		tree_fill,	run_setinfo_same,	tree_free },
+	{ "state_setinfo/change",	tree_fill,	run_setinfo_change,	tree_free },
+	{ "state_setinfo/escape",	tree_fill,	run_setinfo_escape,	tree_free },
+	{ "state_getinfo/hit",		tree_fill,	run_getinfo,		tree_free },
+	{ "state_getinfo/miss",		tree_fill,	run_getinfo_miss,	tree_free },
+	{ "pconf_char/line",		ctx_init,	run_pconf_char,		ctx_free },
+	{ "pconf_buffer/line",		ctx_init,	run_pconf_buffer,	ctx_free },
+	{ "pconf_encode",		NULL,		run_pconf_encode,	NULL },
+#ifdef NUT_MICROBENCH_HIDPARSER
+	{ "Parse_ReportDesc",		NULL,		run_hid_parse,		NULL },
+	{ "FindObject_with_Path",	hid_parse,	run_hid_find,		hid_free },
+	{ "GetValue",			hid_parse,	run_hid_getvalue,	hid_free },
+	{ "SetValue",			hid_parse,	run_hid_setvalue,	hid_free },
+#endif
+	{ NULL, NULL, NULL, NULL }
+};
+
+/* run with growing iteration counts until one run takes target_time */
+static void bench_run(const bench_t *b)
+{
+	size_t	n = 1;
+	double	elapsed;
+	uint64_t	allocs = 0;
+
+	if (b->setup)
+		b->setup();
+
+	for (;;) {
+		double	start;
+#ifdef NUT_MICROBENCH_COUNT_ALLOCS
+		uint64_t	allocs_start = alloc_count;
+#endif
+
+		start = bench_now();
+		b->run(n);
+		elapsed = bench_now() - start;
+
+#ifdef NUT_MICROBENCH_COUNT_ALLOCS
+		allocs = alloc_count - allocs_start;
+#endif
+
+		if (elapsed >= target_time || n >= SIZE_MAX / 16)
+			break;
+
+		/* aim a bit past the target, but grow at most 100x per step */
+		if (elapsed <= 0) {
+			n *= 100;
+		} else {
+			double	next = (double)n * target_time * 1.2 / elapsed;
+
+			n = (next > (double)n * 100) ? n * 100 : (size_t)next + 1;
+		}
+	}
+
+	if (b->teardown)
+		b->teardown();
+
+#ifdef NUT_MICROBENCH_COUNT_ALLOCS
+	printf("%-24s %12" PRIuSIZE " %12.1f %12.3f\n",
+		b->name, n, elapsed * 1000000000.0 / (double)n, (double)allocs / (double)n);
+#else
+	NUT_UNUSED_VARIABLE(allocs);
+	printf("%-24s %12" PRIuSIZE " %12.1f %12s\n",
+		b->name, n, elapsed * 1000000000.0 / (double)n, "n/a");
+#endif
+}
+
+static void usage(const char *prog)
+{
+	printf("Micro-benchmarks of NUT state tree, parser and HID code.\n\n");
+	printf("usage: %s [OPTIONS] [filter...]\n\n", prog);
+	printf("  -s <file>     dummy-ups .seq/.dev file with device data\n");
+	printf("                (default: a small built-in data set)\n");
+	printf("  -n <num>      variables in the state tree, padded with outlet\n");
+	printf("                data points (default: %" PRIuSIZE ")\n", tree_size);
+	printf("  -r <file>     replay a recorded driver socket stream in the\n");
+	printf("                parser benchmark (default: SETINFO for the data)\n");
+	printf("  -t <sec>      minimal time per benchmark (default: %.1f)\n", target_time);
+	printf("  -l            list benchmarks and exit\n");
+	printf("  -h            display this help\n");
+	printf("\nWith filter arguments, only benchmarks with matching names are run.\n");
+}
+
+int main(int argc, char **argv)
+{
+	int	i, list = 0;
+	unsigned long	ul;
+	const bench_t	*b;
+
+	while ((i = getopt(argc, argv, "+s:n:r:t:lh")) != -1) {
+		switch (i) {
+			case 's':
+				seqfile = optarg;
+				break;
+			case 'n':
+				if (!str_to_ulong(optarg, &ul, 10) || ul < 1)
+					fatalx(EXIT_FAILURE, "Invalid tree size: %s", optarg);
+				tree_size = (size_t)ul;
+				break;
+			case 'r':
+				recfile = optarg;
+				break;
+			case 't':
+				if (!str_to_double(optarg, &target_time, 10) || target_time <= 0)
+					fatalx(EXIT_FAILURE, "Invalid time: %s", optarg);
+				break;
+			case 'l':
+				list = 1;
+				break;
+			case 'h':
+				usage(argv[0]);
+				exit(EXIT_SUCCESS);
+			default:
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+		}
+	}
+
+	if (list) {
+		for (b = benches; b->name; b++) {
+			printf("%s\n", b->name);
+		}
+		exit(EXIT_SUCCESS);
+	}
+
+	load_names();
+	load_stream();
+
+	printf("nut-microbench: %" PRIuSIZE " variables, %" PRIuSIZE " stream lines (%" PRIuSIZE " bytes)\n",
+		numnames, streamlines, streamlen);
+#ifdef NUT_MICROBENCH_HIDPARSER
+	hid_parse();
+	printf("HID report descriptor: %" PRIuSIZE " bytes, %" PRIuSIZE " items\n",
+		sizeof(report_desc), hid_desc->nitems);
+	hid_free();
+#endif
+	printf("%-24s %12s %12s %12s\n", "benchmark", "iterations", "ns/op", "allocs/op");
+
+	for (b = benches; b->name; b++) {
+		if (optind < argc) {
+			int	j, match = 0;
+
+			for (j = optind; j < argc && !match; j++) {
+				match = (strstr(b->name, argv[j]) != NULL);
+			}
+
+			if (!match)
+				continue;
+		}
+
+		bench_run(b);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,613 @@
+/* nutclientasynctest - CppUnit nut::AsyncClient unit test
+
+   Copyright (C)
+	2026	Network UPS Tools developers
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "common.h"
+
+/* Current CPPUnit offends the honor of C++98 and maybe later versions */
+#if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_EXIT_TIME_DESTRUCTORS || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_GLOBAL_CONSTRUCTORS || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_DEPRECATED_DECLARATIONS || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_SUGGEST_OVERRIDE_BESIDEFUNC || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_SUGGEST_DESTRUCTOR_OVERRIDE_BESIDEFUNC || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_WEAK_VTABLES_BESIDEFUNC || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_DEPRECATED_DYNAMIC_EXCEPTION_SPEC_BESIDEFUNC || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_EXTRA_SEMI_BESIDEFUNC || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_OLD_STYLE_CAST_BESIDEFUNC)
+#pragma GCC diagnostic push
+# ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_GLOBAL_CONSTRUCTORS
+#  pragma GCC diagnostic ignored "-Wglobal-constructors"
+# endif
+# ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_EXIT_TIME_DESTRUCTORS
+#  pragma GCC diagnostic ignored "-Wexit-time-destructors"
+# endif
+# ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_DEPRECATED_DECLARATIONS
+#  pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+# endif
+# ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_SUGGEST_OVERRIDE_BESIDEFUNC
+#  pragma GCC diagnostic ignored "-Wsuggest-override"
+# endif
+# ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_SUGGEST_DESTRUCTOR_OVERRIDE_BESIDEFUNC
+#  pragma GCC diagnostic ignored "-Wsuggest-destructor-override"
+# endif
+# ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_WEAK_VTABLES_BESIDEFUNC
+#  pragma GCC diagnostic ignored "-Wweak-vtables"
+# endif
+# ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_DEPRECATED_DYNAMIC_EXCEPTION_SPEC_BESIDEFUNC
+#  pragma GCC diagnostic ignored "-Wdeprecated-dynamic-exception-spec"
+# endif
+# ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_EXTRA_SEMI_BESIDEFUNC
+#  pragma GCC diagnostic ignored "-Wextra-semi"
+# endif
+# ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_OLD_STYLE_CAST_BESIDEFUNC
+#  pragma GCC diagnostic ignored "-Wold-style-cast"
+# endif
+#endif
+#if (defined __clang__) && (defined HAVE_PRAGMA_CLANG_DIAGNOSTIC_IGNORED_DEPRECATED_DECLARATIONS)
+# ifdef HAVE_PRAGMA_CLANG_DIAGNOSTIC_IGNORED_DEPRECATED_DECLARATIONS
+#  pragma clang diagnostic push "-Wdeprecated-declarations"
+# endif
+#endif
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace nut {
+
+class NutClientAsyncTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( NutClientAsyncTest );
+		CPPUNIT_TEST( test_async_pipeline );
+		CPPUNIT_TEST( test_async_list );
+		CPPUNIT_TEST( test_async_timeout_reconnect );
+		CPPUNIT_TEST( test_async_cancel );
+		CPPUNIT_TEST( test_async_login_failure );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp() override {}
+	void tearDown() override {}
+
+	void test_async_pipeline();
+	void test_async_list();
+	void test_async_timeout_reconnect();
+	void test_async_cancel();
+	void test_async_login_failure();
+};
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( NutClientAsyncTest );
+
+} // namespace nut {}
+
+#include "../clients/nutclient.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#ifndef WIN32
+# include <sys/types.h>
+# include <sys/socket.h>
+# include <netinet/in.h>
+# include <arpa/inet.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif	/* !WIN32 */
+
+namespace nut {
+
+#ifndef WIN32
+
+/**
+ * Scripted NUT server on a loopback port, serviced from the test thread
+ * in between AsyncClient::poll() calls.
+ */
+class FakeUpsd
+{
+public:
+	/* Answer to one request line, sent right away; an empty string
+	 * sends nothing. Set "drop" to close the connection instead. */
+	typedef std::function<std::string(const std::string& line, bool& drop)> Handler;
+
+	FakeUpsd():
+		port(0), connections(0), hold(false), answered(0), received(),
+		_listen(-1), _conn(-1), _in(), _handler()
+	{
+		struct sockaddr_in sa;
+		socklen_t salen = sizeof(sa);
+
+		_listen = ::socket(AF_INET, SOCK_STREAM, 0);
+		CPPUNIT_ASSERT_MESSAGE("FakeUpsd: socket()", _listen >= 0);
+
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family = AF_INET;
+		sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		sa.sin_port = 0;
+
+		CPPUNIT_ASSERT_MESSAGE("FakeUpsd: bind()",
+			::bind(_listen, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa)) == 0);
+		CPPUNIT_ASSERT_MESSAGE("FakeUpsd: listen()",
+			::listen(_listen, 4) == 0);
+		CPPUNIT_ASSERT_MESSAGE("FakeUpsd: getsockname()",
+			::getsockname(_listen, reinterpret_cast<struct sockaddr*>(&sa), &salen) == 0);
+
+		fcntl(_listen, F_SETFL, fcntl(_listen, F_GETFL) | O_NONBLOCK);
+		port = ntohs(sa.sin_port);
+	}
+
+	~FakeUpsd()
+	{
+		drop();
+		::close(_listen);
+	}
+
+	void setHandler(const Handler& handler) {_handler = handler;}
+
+	/* Close the current client connection */
+	void drop()
+	{
+		if(_conn >= 0)
+		{
+			::close(_conn);
+			_conn = -1;
+		}
+		_in.clear();
+	}
+
+	/* Accept, read and answer whatever is there, without blocking */
+	void service()
+	{
+		int fd = ::accept(_listen, nullptr, nullptr);
+		if(fd >= 0)
+		{
+			drop();
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+			_conn = fd;
+			connections++;
+		}
+
+		if(_conn < 0)
+		{
+			return;
+		}
+
+		char buf[4096];
+		ssize_t res;
+		while((res = ::recv(_conn, buf, sizeof(buf), 0)) > 0)
+		{
+			_in.append(buf, static_cast<size_t>(res));
+		}
+		if(res == 0)
+		{
+			drop();
+			return;
+		}
+
+		size_t nl;
+		while((nl = _in.find('\n')) != std::string::npos)
+		{
+			std::string line = _in.substr(0, nl);
+			_in.erase(0, nl + 1);
+			received.push_back(line);
+		}
+
+		/* While held, requests only pile up (to check pipelining) */
+		while(!hold && answered < received.size())
+		{
+			bool dropIt = false;
+			std::string reply = _handler ? _handler(received[answered++], dropIt) : std::string();
+
+			if(dropIt)
+			{
+				drop();
+				return;
+			}
+			if(!reply.empty())
+			{
+				CPPUNIT_ASSERT_MESSAGE("FakeUpsd: send()",
+					::send(_conn, reply.data(), reply.size(), 0) == static_cast<ssize_t>(reply.size()));
+			}
+		}
+	}
+
+	uint16_t port;
+	int connections;
+	bool hold;
+	size_t answered;
+	std::vector<std::string> received;
+
+private:
+	int _listen, _conn;
+	std::string _in;
+	Handler _handler;
+};
+
+/* Drive both ends until the condition holds or about 5 seconds pass */
+static bool pump(AsyncClient& c, FakeUpsd& srv, const std::function<bool()>& until)
+{
+	for(int n = 0; n < 500; ++n)
+	{
+		srv.service();
+		if(until())
+		{
+			return true;
+		}
+		c.poll(10);
+	}
+	return until();
+}
+
+/* A server which answers GET VAR with the variable name reversed */
+static std::string answerGetVar(const std::string& line, bool&)
+{
+	if(line.compare(0, 8, "GET VAR ") != 0)
+	{
+		return "ERR UNKNOWN-COMMAND\n";
+	}
+
+	std::string req = line.substr(4);
+	std::string name = req.substr(req.rfind(' ') + 1);
+	return req + " \"" + std::string(name.rbegin(), name.rend()) + "\"\n";
+}
+
+#endif	/* !WIN32 */
+
+void NutClientAsyncTest::test_async_pipeline() {
+#ifndef WIN32
+	FakeUpsd srv;
+	AsyncClient c;
+	AsyncClient::HostID id = c.addHost("127.0.0.1", srv.port);
+	std::vector<std::string> order;
+
+	srv.setHandler(answerGetVar);
+	srv.hold = true;
+
+	const char* names[] = { "ups.status", "battery.charge", "input.voltage" };
+	for(size_t n = 0; n < 3; ++n)
+	{
+		c.getDeviceVariableValue(id, "dummy", names[n],
+			[&order](const AsyncResult<std::vector<std::string> >& res)
+		{
+			CPPUNIT_ASSERT_MESSAGE(
+				"Failed async pipeline: request status",
+				res.ok());
+			CPPUNIT_ASSERT_EQUAL_MESSAGE(
+				"Failed async pipeline: value count",
+				static_cast<size_t>(1), res.value.size());
+			order.push_back(res.value[0]);
+		});
+	}
+
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed async pipeline: pending count",
+		static_cast<size_t>(3), c.pending());
+
+	// All requests go out on one connection before any reply comes back
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async pipeline: requests not all sent ahead of replies",
+		pump(c, srv, [&srv]() { return srv.received.size() == 3; }));
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async pipeline: completed before any reply",
+		order.empty());
+
+	srv.hold = false;
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async pipeline: replies not delivered",
+		pump(c, srv, [&c]() { return c.pending() == 0; }));
+
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed async pipeline: connection count",
+		1, srv.connections);
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed async pipeline: completion count",
+		static_cast<size_t>(3), order.size());
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed async pipeline: first reply",
+		std::string("sutats.spu"), order[0]);
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed async pipeline: second reply",
+		std::string("egrahc.yrettab"), order[1]);
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed async pipeline: third reply",
+		std::string("egatlov.tupni"), order[2]);
+#endif	/* !WIN32 */
+}
+
+void NutClientAsyncTest::test_async_list() {
+#ifndef WIN32
+	FakeUpsd srv;
+	AsyncClient c;
+	AsyncClient::HostID id = c.addHost("127.0.0.1", srv.port);
+
+	srv.setHandler([](const std::string& line, bool&) -> std::string
+	{
+		if(line == "LIST UPS")
+		{
+			return "BEGIN LIST UPS\n"
+				"UPS ups_1 \"First UPS\"\n"
+				"UPS ups_2 \"Second \\\"UPS\\\"\"\n"
+				"END LIST UPS\n";
+		}
+		if(line == "LIST VAR ups_1")
+		{
+			return "BEGIN LIST VAR ups_1\n"
+				"VAR ups_1 ups.status \"OL CHRG\"\n"
+				"VAR ups_1 ups.mfr \"Some \\\"quoted\\\" \\\\ text\"\n"
+				"VAR ups_1 battery.charge \"100\"\n"
+				"END LIST VAR ups_1\n";
+		}
+		if(line == "LIST CMD ups_1")
+		{
+			return "BEGIN LIST CMD ups_1\n"
+				"CMD ups_1 beeper.on\n"
+				"CMD ups_1 load.off\n"
+				"END LIST CMD ups_1\n";
+		}
+		return "ERR UNKNOWN-UPS\n";
+	});
+
+	std::set<std::string> devices, commands;
+	std::map<std::string, std::vector<std::string> > vars;
+	AsyncStatus missing = AsyncStatus::OK;
+	std::string missingError;
+
+	c.getDeviceNames(id, [&devices](const AsyncResult<std::set<std::string> >& res)
+	{
+		if(res.ok()) devices = res.value;
+	});
+	c.getDeviceVariableValues(id, "ups_1", [&vars](const AsyncResult<std::map<std::string, std::vector<std::string> > >& res)
+	{
+		if(res.ok()) vars = res.value;
+	});
+	c.getDeviceCommandNames(id, "ups_1", [&commands](const AsyncResult<std::set<std::string> >& res)
+	{
+		if(res.ok()) commands = res.value;
+	});
+	c.getDeviceVariableValues(id, "ups_9", [&missing, &missingError](const AsyncResult<std::map<std::string, std::vector<std::string> > >& res)
+	{
+		missing = res.status;
+		missingError = res.error;
+	});
+
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async LIST: replies not delivered",
+		pump(c, srv, [&c]() { return c.pending() == 0; }));
+
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed async LIST UPS: device count",
+		static_cast<size_t>(2), devices.size());
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async LIST UPS: device names",
+		devices.count("ups_1") == 1 && devices.count("ups_2") == 1);
+
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed async LIST VAR: variable count",
+		static_cast<size_t>(3), vars.size());
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async LIST VAR: quoted value with a space",
+		vars["ups.status"].size() == 1 && vars["ups.status"][0] == "OL CHRG");
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async LIST VAR: unescaped value",
+		vars["ups.mfr"].size() == 1 && vars["ups.mfr"][0] == "Some \"quoted\" \\ text");
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async LIST VAR: plain value",
+		vars["battery.charge"].size() == 1 && vars["battery.charge"][0] == "100");
+
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed async LIST CMD: command count",
+		static_cast<size_t>(2), commands.size());
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async LIST CMD: command names",
+		commands.count("beeper.on") == 1 && commands.count("load.off") == 1);
+
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async LIST VAR: error reply status",
+		missing == AsyncStatus::SERVER_ERROR);
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed async LIST VAR: error reply code",
+		std::string("UNKNOWN-UPS"), missingError);
+#endif	/* !WIN32 */
+}
+
+void NutClientAsyncTest::test_async_timeout_reconnect() {
+#ifndef WIN32
+	FakeUpsd srv;
+	AsyncClient c;
+	AsyncClient::HostID id = c.addHost("127.0.0.1", srv.port);
+	AsyncStatus first = AsyncStatus::OK, second = AsyncStatus::TIMEOUT, third = AsyncStatus::OK;
+	bool silent = true, hangUp = false;
+
+	c.setReconnectDelay(0, 0);
+
+	// Ignore the first request, answer the rest
+	srv.setHandler([&silent, &hangUp](const std::string& line, bool& drop) -> std::string
+	{
+		if(silent)
+		{
+			silent = false;
+			return std::string();
+		}
+		if(hangUp)
+		{
+			drop = true;
+			return std::string();
+		}
+		return answerGetVar(line, drop);
+	});
+
+	c.getDeviceVariableValue(id, "dummy", "ups.status",
+		[&first](const AsyncResult<std::vector<std::string> >& res) { first = res.status; }, 0.3);
+
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async timeout: request did not expire",
+		pump(c, srv, [&c]() { return c.pending() == 0; }));
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async timeout: status of the unanswered request",
+		first == AsyncStatus::TIMEOUT);
+
+	// The connection was reset (a late reply would be out of sync),
+	// so the next request goes out on a new one
+	c.getDeviceVariableValue(id, "dummy", "ups.status",
+		[&second](const AsyncResult<std::vector<std::string> >& res) { second = res.status; });
+
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async reconnect: request not answered",
+		pump(c, srv, [&c]() { return c.pending() == 0; }));
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async reconnect: status after reconnection",
+		second == AsyncStatus::OK);
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed async reconnect: connection count",
+		2, srv.connections);
+
+	// A connection lost with a request in flight fails that request...
+	hangUp = true;
+	c.getDeviceVariableValue(id, "dummy", "ups.status",
+		[&third](const AsyncResult<std::vector<std::string> >& res) { third = res.status; });
+
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async disconnect: request not completed",
+		pump(c, srv, [&c]() { return c.pending() == 0; }));
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async disconnect: status of the request in flight",
+		third == AsyncStatus::IO_ERROR);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async disconnect: still marked as connected",
+		!c.isConnected(id));
+
+	// ...and the following ones reconnect
+	hangUp = false;
+	second = AsyncStatus::TIMEOUT;
+	c.getDeviceVariableValue(id, "dummy", "ups.status",
+		[&second](const AsyncResult<std::vector<std::string> >& res) { second = res.status; });
+
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async reconnect after loss: request not answered",
+		pump(c, srv, [&c]() { return c.pending() == 0; }));
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async reconnect after loss: status",
+		second == AsyncStatus::OK);
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed async reconnect after loss: connection count",
+		3, srv.connections);
+#endif	/* !WIN32 */
+}
+
+void NutClientAsyncTest::test_async_cancel() {
+#ifndef WIN32
+	FakeUpsd srv;
+	int cancelled = 0;
+
+	srv.hold = true;
+
+	{
+		AsyncClient c;
+		AsyncClient::HostID id1 = c.addHost("127.0.0.1", srv.port);
+		AsyncClient::HostID id2 = c.addHost("127.0.0.1", srv.port);
+		auto countCancel = [&cancelled](const AsyncResult<std::vector<std::string> >& res)
+		{
+			if(res.status == AsyncStatus::CANCELLED) cancelled++;
+		};
+
+		// Sent but not answered yet, and not sent at all
+		c.getDeviceVariableValue(id1, "dummy", "ups.status", countCancel);
+		c.getDeviceVariableValue(id1, "dummy", "ups.load", countCancel);
+		CPPUNIT_ASSERT_MESSAGE(
+			"Failed async cancel: requests not sent",
+			pump(c, srv, [&srv]() { return srv.received.size() == 2; }));
+
+		c.removeHost(id1);
+		CPPUNIT_ASSERT_EQUAL_MESSAGE(
+			"Failed async cancel: pending count after removeHost()",
+			static_cast<size_t>(0), c.pending());
+		CPPUNIT_ASSERT_EQUAL_MESSAGE(
+			"Failed async cancel: callbacks run before poll()",
+			0, cancelled);
+
+		c.poll(0);
+		CPPUNIT_ASSERT_EQUAL_MESSAGE(
+			"Failed async cancel: removeHost() completions",
+			2, cancelled);
+
+		bool threw = false;
+		try {
+			c.getDeviceVariableValue(id1, "dummy", "ups.status", countCancel);
+		}
+		catch(NutException&) {
+			threw = true;
+		}
+		CPPUNIT_ASSERT_MESSAGE(
+			"Failed async cancel: request accepted for a removed host",
+			threw);
+
+		// Whatever is still queued completes when the client goes away
+		c.getDeviceVariableValue(id2, "dummy", "ups.status", countCancel);
+	}
+
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed async cancel: completions on destruction",
+		3, cancelled);
+#endif	/* !WIN32 */
+}
+
+void NutClientAsyncTest::test_async_login_failure() {
+#ifndef WIN32
+	FakeUpsd srv;
+	AsyncClient c;
+	AsyncClient::HostID id = c.addHost("127.0.0.1", srv.port);
+	AsyncStatus status = AsyncStatus::OK;
+	std::string error;
+
+	c.setHostCredentials(id, "monuser", "wrong");
+
+	srv.setHandler([](const std::string& line, bool& drop) -> std::string
+	{
+		if(line.compare(0, 9, "USERNAME ") == 0)
+		{
+			return "OK\n";
+		}
+		if(line.compare(0, 9, "PASSWORD ") == 0)
+		{
+			return "ERR ACCESS-DENIED\n";
+		}
+		return answerGetVar(line, drop);
+	});
+
+	c.getDeviceVariableValue(id, "dummy", "ups.status",
+		[&status, &error](const AsyncResult<std::vector<std::string> >& res)
+	{
+		status = res.status;
+		error = res.error;
+	});
+
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async login: request not completed",
+		pump(c, srv, [&c]() { return c.pending() == 0; }));
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async login: refused PASSWORD not reported",
+		status == AsyncStatus::LOGIN_FAILED);
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed async login: error description",
+		std::string("PASSWORD failed: ERR ACCESS-DENIED"), error);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed async login: connection kept after a refused login",
+		!c.isConnected(id));
+#endif	/* !WIN32 */
+}
+
+} // namespace nut {}
+
+#if (defined __clang__) && (defined HAVE_PRAGMA_CLANG_DIAGNOSTIC_IGNORED_DEPRECATED_DECLARATIONS)
+# pragma clang diagnostic pop
+#endif
+#if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_EXIT_TIME_DESTRUCTORS || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_GLOBAL_CONSTRUCTORS || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_DEPRECATED_DECLARATIONS || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_SUGGEST_OVERRIDE_BESIDEFUNC || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_SUGGEST_DESTRUCTOR_OVERRIDE_BESIDEFUNC || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_WEAK_VTABLES_BESIDEFUNC || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_DEPRECATED_DYNAMIC_EXCEPTION_SPEC_BESIDEFUNC || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_EXTRA_SEMI_BESIDEFUNC || defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_OLD_STYLE_CAST_BESIDEFUNC)
+# pragma GCC diagnostic pop
+#endif
@@ -79,6 +79,10 @@ class NutClientTest : public CppUnit::TestFixture
 		CPPUNIT_TEST( test_copy_assignment_var );
 
 		CPPUNIT_TEST( test_nutclientstub_dev );
+
+		CPPUNIT_TEST( test_tcpclient_explode );
+
+		CPPUNIT_TEST( test_cachingclient );
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -99,6 +103,10 @@ public:
 	void test_copy_assignment_var();
 
 	void test_nutclientstub_dev();
+
+	void test_tcpclient_explode();
+
+	void test_cachingclient();
 };
 
 // Registers the fixture into the 'registry'
@@ -545,6 +553,102 @@ void NutClientTest::test_nutclientstub_dev() {
 		!noException);
 }
 
+void NutClientTest::test_tcpclient_explode() {
+	std::vector<std::string> res;
+
+	res = TcpClient::explode("VAR ups1 ups.mfr \"Some \\\"quoted\\\" \\\\ text\"", 8);
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed to explode a LIST VAR row: word count",
+		static_cast<size_t>(2), res.size());
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed to explode a LIST VAR row: variable name",
+		std::string("ups.mfr"), res[0]);
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed to explode a LIST VAR row: unescaped value",
+		std::string("Some \"quoted\" \\ text"), res[1]);
+
+	res = TcpClient::explode("a\\ b\"c d\" \"\" e");
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed to explode mixed words: word count",
+		static_cast<size_t>(4), res.size());
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed to explode mixed words: escaped space",
+		std::string("a b"), res[0]);
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed to explode mixed words: quoted word after a simple one",
+		std::string("c d"), res[1]);
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed to explode mixed words: empty quoted word",
+		std::string(""), res[2]);
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed to explode mixed words: last word",
+		std::string("e"), res[3]);
+}
+
+void NutClientTest::test_cachingclient() {
+	nut::MemClientStub mem;
+	nut::CachingClient c(&mem, 3600);
+
+	mem.setDeviceVariable("ups_1", "name_1", "value_1");
+
+	ListValue values = c.getDeviceVariableValue("ups_1", "name_1");
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed caching client: first read",
+		values.size() == 1 && values[0] == std::string("value_1"));
+
+	// A change behind the cache is not seen before the TTL expires...
+	mem.setDeviceVariable("ups_1", "name_1", "value_2");
+	values = c.getDeviceVariableValue("ups_1", "name_1");
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed caching client: read not served from the snapshot",
+		values.size() == 1 && values[0] == std::string("value_1"));
+
+	nut::CachingClient::Stats stats = c.getStats();
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed caching client: hit count",
+		static_cast<uint64_t>(1), stats.hits);
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed caching client: miss count",
+		static_cast<uint64_t>(1), stats.misses);
+
+	// ...unless the device is invalidated
+	c.invalidate("ups_1");
+	values = c.getDeviceVariableValue("ups_1", "name_1");
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed caching client: read after invalidation",
+		values.size() == 1 && values[0] == std::string("value_2"));
+
+	// Writes through the cache invalidate the device
+	c.setDeviceVariable("ups_1", "name_1", "value_3");
+	values = c.getDeviceVariableValue("ups_1", "name_1");
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed caching client: read after write",
+		values.size() == 1 && values[0] == std::string("value_3"));
+
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed caching client: variable listed in the snapshot",
+		c.hasDeviceVariable("ups_1", "name_1"));
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed caching client: variable not listed in the snapshot",
+		!c.hasDeviceVariable("ups_1", "name_2"));
+
+	stats = c.getStats();
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed caching client: refresh count",
+		static_cast<uint64_t>(3), stats.refreshes);
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Failed caching client: invalidation count",
+		static_cast<uint64_t>(2), stats.invalidations);
+
+	// Without a TTL, every read goes to the wrapped client
+	c.setTTL(0);
+	mem.setDeviceVariable("ups_1", "name_1", "value_4");
+	values = c.getDeviceVariableValue("ups_1", "name_1");
+	CPPUNIT_ASSERT_MESSAGE(
+		"Failed caching client: read with caching disabled",
+		values.size() == 1 && values[0] == std::string("value_4"));
+}
+
 } // namespace nut {}
 
 #if (defined __clang__) && (defined HAVE_PRAGMA_CLANG_DIAGNOSTIC_IGNORED_DEPRECATED_DECLARATIONS)
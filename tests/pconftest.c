@@ -0,0 +1,215 @@
+/*  pconftest.c - check that pconf_buffer() splits input into the same
+ *  tokens as feeding it character by character to pconf_char()
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#include "config.h"
+#include "common.h"
+#include "parseconf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* growing text record of the lines (and errors) seen by a parser */
+typedef struct {
+	char	*buf;
+	size_t	len, size;
+} record_t;
+
+static void record_add(record_t *rec, const char *s, size_t len)
+{
+	if (rec->len + len + 1 > rec->size) {
+		rec->size = (rec->len + len + 1) * 2;
+		rec->buf = xrealloc(rec->buf, rec->size);
+	}
+
+	memcpy(rec->buf + rec->len, s, len);
+	rec->len += len;
+	rec->buf[rec->len] = '\0';
+}
+
+static void record_result(record_t *rec, PCONF_CTX_t *ctx, int ret)
+{
+	char	tmp[SMALLBUF];
+	size_t	i;
+
+	if (ret < 0) {
+		snprintf(tmp, sizeof(tmp), "error: %s\n", ctx->errmsg);
+		record_add(rec, tmp, strlen(tmp));
+		return;
+	}
+
+	snprintf(tmp, sizeof(tmp), "%" PRIuSIZE ":", ctx->numargs);
+	record_add(rec, tmp, strlen(tmp));
+
+	for (i = 0; i < ctx->numargs; i++) {
+		record_add(rec, " [", 2);
+		record_add(rec, ctx->arglist[i], strlen(ctx->arglist[i]));
+		record_add(rec, "]", 1);
+	}
+
+	record_add(rec, "\n", 1);
+}
+
+static void parse_by_char(record_t *rec, const char *input, size_t len)
+{
+	PCONF_CTX_t	ctx;
+	size_t	i;
+	int	ret;
+
+	pconf_init(&ctx, NULL);
+
+	for (i = 0; i < len; i++) {
+		if ((ret = pconf_char(&ctx, input[i])) != 0)
+			record_result(rec, &ctx, ret);
+	}
+
+	pconf_finish(&ctx);
+}
+
+/* as read() would hand the data over, in chunks of at most chunk bytes */
+static void parse_by_buffer(record_t *rec, const char *input, size_t len, size_t chunk)
+{
+	PCONF_CTX_t	ctx;
+	size_t	pos, end, used;
+	int	ret;
+
+	pconf_init(&ctx, NULL);
+
+	for (pos = 0; pos < len; pos = end) {
+		end = (len - pos > chunk) ? pos + chunk : len;
+
+		while (pos < end) {
+			ret = pconf_buffer(&ctx, input + pos, end - pos, &used);
+			pos += used;
+
+			if (ret != 0)
+				record_result(rec, &ctx, ret);
+		}
+	}
+
+	pconf_finish(&ctx);
+}
+
+static int check_input(const char *name, const char *input)
+{
+	static const size_t	chunks[] = { 1, 2, 3, 7, 64, 4096 };
+	record_t	expected = { NULL, 0, 0 }, got;
+	size_t	len = strlen(input), i;
+	int	res = 0;
+
+	printf("=== %s:", name);
+
+	parse_by_char(&expected, input, len);
+	if (!expected.len) {
+		printf(" no line parsed (FAIL)\n");
+		return 1;
+	}
+
+	for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+		got.buf = NULL;
+		got.len = got.size = 0;
+
+		parse_by_buffer(&got, input, len, chunks[i]);
+
+		if (!got.buf || strcmp(got.buf, expected.buf)) {
+			printf("\n  chunks of %" PRIuSIZE ": FAIL\n  pconf_char():\n%s  pconf_buffer():\n%s",
+				chunks[i], expected.buf, NUT_STRARG(got.buf));
+			res++;
+		}
+
+		free(got.buf);
+	}
+
+	if (!res)
+		printf(" %" PRIuSIZE " bytes (OK)\n", len);
+
+	free(expected.buf);
+	return res;
+}
+
+int main(void)
+{
+	char	*longword, *longline;
+	size_t	i;
+	int	ret = 0;
+
+	ret += check_input("plain lines",
+		"VER\n"
+		"SET VAR myups ups.delay.shutdown 120\n"
+		"  \tLIST   VAR  myups  \n"
+		"\n"
+		"BEGIN LIST UPS\n");
+
+	ret += check_input("quotes",
+		"VAR myups ups.mfr \"Some Vendor\"\n"
+		"UPS myups \"\"\n"
+		"desc = \"two  spaces\" tail\n"
+		"half\"quoted\" \"adjacent\"\"words\"\n");
+
+	ret += check_input("escapes",
+		"a\\ b c\\\\d \"e\\\"f\" \"g\\\\h\"\n"
+		"\"trailing backslash \\\\\"\n"
+		"mid\\\"dle\n");
+
+	ret += check_input("line continuation",
+		"MONITOR myups@localhost 1 \\\n"
+		"\tmonuser secret primary\n"
+		"\"quoted \\\n"
+		"continued\"\n");
+
+	ret += check_input("comments",
+		"# a full line comment\n"
+		"key = value # trailing comment\n"
+		"quoted = \"not # a comment\"\n"
+		"   # indented comment\n"
+		"word#glued\n");
+
+	ret += check_input("equal signs and control characters",
+		"key=value\n"
+		"a =b= c\n"
+		"crlf line\r\n"
+		"tab\tseparated\twords\n");
+
+	/* longer than the word length and argument limits, which both
+	 * parsers must truncate the same way */
+	longword = xcalloc(PCONF_DEFAULT_WORDLEN_LIMIT * 2 + 64, 1);
+	snprintf(longword, 64, "long ");
+	for (i = strlen(longword); i < PCONF_DEFAULT_WORDLEN_LIMIT * 2; i++)
+		longword[i] = (char)('a' + i % 26);
+	snprintf(longword + i, 64, " \"%s\"\nshort line\n", "quoted");
+	ret += check_input("over-long word", longword);
+	free(longword);
+
+	longline = xcalloc((PCONF_DEFAULT_ARG_LIMIT * 2) * 8 + 16, 1);
+	for (i = 0; i < PCONF_DEFAULT_ARG_LIMIT * 2; i++)
+		snprintf(longline + strlen(longline), 8, "w%" PRIuSIZE " ", i);
+	snprintf(longline + strlen(longline), 16, "\nnext line\n");
+	ret += check_input("too many words", longline);
+	free(longline);
+
+	ret += check_input("parse errors",
+		"good line\n"
+		"bad \"unterminated\n"
+		"after \\\n"
+		"error\n");
+
+	printf("%s: %d failure(s)\n", __FILE__, ret);
+
+	return (ret != 0);
+}
@@ -0,0 +1,240 @@
+/*  upsdtimerstest.c - test the upsd housekeeping timer wheel (server/timers.c)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#include "config.h"
+#include "common.h"
+#include "timers.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NTIMERS	8
+
+typedef struct {
+	upsd_timer_t	timer;
+	int	fired;
+	time_t	fired_at;
+	time_t	rearm;	/* re-arm this far ahead from the callback, if non-zero */
+} test_timer_t;
+
+static test_timer_t	timers[NTIMERS];
+
+/* the second being processed, as the callbacks see it */
+static time_t	now;
+
+static void test_callback(void *data)
+{
+	test_timer_t	*t = data;
+
+	t->fired++;
+	t->fired_at = now;
+
+	if (t->rearm)
+		upsd_timer_set(&t->timer, now + t->rearm);
+}
+
+static void reset_timers(void)
+{
+	size_t	i;
+
+	for (i = 0; i < NTIMERS; i++) {
+		upsd_timer_cancel(&timers[i].timer);
+		upsd_timer_init(&timers[i].timer, test_callback, &timers[i]);
+		timers[i].fired = 0;
+		timers[i].fired_at = 0;
+		timers[i].rearm = 0;
+	}
+}
+
+/* run the wheel one second at a time up to "until" */
+static void run_until(time_t until)
+{
+	while (now < until) {
+		now++;
+		upsd_timers_run(now);
+	}
+}
+
+static int check(int cond, const char *what)
+{
+	printf("  %s: %s\n", what, cond ? "OK" : "FAIL");
+	return cond ? 0 : 1;
+}
+
+static int check_insert(void)
+{
+	time_t	start = now;
+	int	res = 0;
+
+	printf("=== %s:\n", __func__);
+	reset_timers();
+
+	upsd_timer_set(&timers[0].timer, start + 5);
+	upsd_timer_set(&timers[1].timer, start + 1);
+	upsd_timer_set(&timers[2].timer, start);	/* due right away */
+
+	res += check(upsd_timers_wait(60000) == 0, "wait is 0 with a timer due");
+
+	upsd_timers_run(now);
+	res += check(timers[2].fired == 1, "timer due now fires on the next run");
+	res += check(upsd_timers_wait(60000) == 1000, "wait is 1 s for the next timer");
+
+	run_until(start + 4);
+	res += check(timers[1].fired == 1 && timers[1].fired_at == start + 1, "timer fires at its second");
+	res += check(timers[0].fired == 0, "later timer does not fire early");
+
+	run_until(start + 5);
+	res += check(timers[0].fired == 1 && timers[0].fired_at == start + 5, "later timer fires at its second");
+
+	run_until(start + 10);
+	res += check(timers[0].fired == 1 && timers[1].fired == 1 && timers[2].fired == 1, "each timer fired once");
+
+	return res;
+}
+
+static int check_cancel(void)
+{
+	time_t	start = now;
+	int	res = 0;
+
+	printf("=== %s:\n", __func__);
+	reset_timers();
+
+	upsd_timer_set(&timers[0].timer, start + 3);
+	upsd_timer_set(&timers[1].timer, start + 3);
+	upsd_timer_set(&timers[2].timer, start + 3);
+	upsd_timer_set(&timers[3].timer, start + 500);
+
+	/* unlink from the head, the middle and the outer level */
+	upsd_timer_cancel(&timers[2].timer);
+	upsd_timer_cancel(&timers[3].timer);
+	/* cancelling a disarmed timer is harmless */
+	upsd_timer_cancel(&timers[3].timer);
+	upsd_timer_cancel(&timers[4].timer);
+
+	run_until(start + 600);
+	res += check(timers[0].fired == 1 && timers[1].fired == 1, "timers left armed fire");
+	res += check(timers[2].fired == 0, "cancelled timer does not fire");
+	res += check(timers[3].fired == 0, "cancelled far timer does not fire");
+	res += check(timers[4].fired == 0, "never armed timer does not fire");
+
+	return res;
+}
+
+static int check_rearm(void)
+{
+	time_t	start = now;
+	int	res = 0;
+
+	printf("=== %s:\n", __func__);
+	reset_timers();
+
+	/* moved earlier, and later */
+	upsd_timer_set(&timers[0].timer, start + 10);
+	upsd_timer_set(&timers[0].timer, start + 3);
+	upsd_timer_set(&timers[1].timer, start + 3);
+	upsd_timer_set(&timers[1].timer, start + 200);
+
+	/* re-arms itself from the callback every 7 seconds */
+	timers[2].rearm = 7;
+	upsd_timer_set(&timers[2].timer, start + 7);
+
+	run_until(start + 199);
+	res += check(timers[0].fired == 1 && timers[0].fired_at == start + 3, "timer moved earlier fires once at the new time");
+	res += check(timers[1].fired == 0, "timer moved later does not fire at the old time");
+	res += check(timers[2].fired == 199 / 7 && timers[2].fired_at == start + 199 / 7 * 7, "timer re-armed by its callback keeps firing");
+
+	run_until(start + 200);
+	res += check(timers[1].fired == 1 && timers[1].fired_at == start + 200, "timer moved later fires at the new time");
+
+	timers[2].rearm = 0;
+	upsd_timer_cancel(&timers[2].timer);
+
+	return res;
+}
+
+static int check_wraparound(void)
+{
+	time_t	start = now;
+	int	res = 0, i;
+	/* within the inner level but past the end of its slot array, in the
+	 * outer level (cascaded, also right at a span boundary), and beyond
+	 * both levels (parked, then looked at again) */
+	static const time_t	delta[] = { 40, 63, 64, 130, 64 * 64 - 1, 64 * 64 + 5, 3 * 64 * 64 + 17 };
+	const int	count = (int)(sizeof(delta) / sizeof(delta[0]));
+
+	printf("=== %s:\n", __func__);
+	reset_timers();
+
+	for (i = 0; i < count; i++)
+		upsd_timer_set(&timers[i].timer, start + delta[i]);
+
+	run_until(start + delta[count - 1] + 64);
+
+	for (i = 0; i < count; i++) {
+		char	what[64];
+
+		snprintf(what, sizeof(what), "timer %" PRIiMAX " s ahead fires on time", (intmax_t)delta[i]);
+		res += check(timers[i].fired == 1 && timers[i].fired_at == start + delta[i], what);
+	}
+
+	/* the same in a single run after a long sleep (shorter than what
+	 * is taken for a clock jump): what is due fires, the rest waits */
+	reset_timers();
+	start = now;
+	for (i = 0; i < count; i++)
+		upsd_timer_set(&timers[i].timer, start + delta[i]);
+
+	now = start + 64 * 64 - 1;
+	upsd_timers_run(now);
+
+	for (i = 0; i < count; i++) {
+		if (timers[i].fired != (delta[i] <= 64 * 64 - 1))
+			break;
+	}
+	res += check(i == count, "only timers due fire in one long run");
+
+	run_until(start + delta[count - 1]);
+
+	for (i = 0; i < count; i++) {
+		if (timers[i].fired != 1)
+			break;
+	}
+	res += check(i == count, "the rest fire later");
+
+	return res;
+}
+
+int main(void)
+{
+	int	ret = 0;
+
+	/* start a few seconds before the inner slots wrap around */
+	now = (time_t)1700000000 | 60;
+	upsd_timers_run(now);
+
+	ret += check_insert();
+	ret += check_cancel();
+	ret += check_rearm();
+	ret += check_wraparound();
+
+	printf("%s: %d failure(s)\n", __FILE__, ret);
+
+	return (ret != 0);
+}
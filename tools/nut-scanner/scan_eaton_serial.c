@@ -95,6 +95,30 @@ TYPE_FD   upsfd;
 int   exit_flag = 0;
 int   do_lock_port;
 
+/* Fake driver.stats.* accounting called from drivers/serial.c */
+void dstate_stats_io(double elapsed, ssize_t result)
+{
+	NUT_UNUSED_VARIABLE(elapsed);
+	NUT_UNUSED_VARIABLE(result);
+}
+
+#ifndef WIN32
+/* No driver socket clients to serve here, just wait for the device */
+int dstate_wait_fd(TYPE_FD fd, time_t d_sec, suseconds_t d_usec)
+{
+	fd_set	fds;
+	struct timeval	tv;
+
+	FD_ZERO(&fds);
+	FD_SET(fd, &fds);
+
+	tv.tv_sec = d_sec;
+	tv.tv_usec = d_usec;
+
+	return select(fd + 1, &fds, NULL, NULL, &tv);
+}
+#endif	/* !WIN32 */
+
 /* Functions extracted from drivers/bcmxcp.c, to avoid pulling too many things
  * lightweight function to calculate the 8-bit
  * two's complement checksum of buf, using XCP data length (including header)